@@ -0,0 +1,169 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#include "logger/logger.h"
+
+#include "calibration.h"
+
+void calibration::initialize(const uint8_t index) {
+    this->index = index;
+    this->load();
+}
+
+int calibration::address() const {
+    if (this->index == 0) {
+        return CALIBRATION_EEPROM_ADDRESS;
+    }
+    return CALIBRATION_EEPROM_NEXT_ADDRESS + (this->index - 1) * sizeof(calibration_eeprom_t);
+}
+
+void calibration::load() {
+    calibration_eeprom_t stored;
+
+    this->running = false;
+    this->count = 0;
+
+    EEPROM.get(this->address(), stored);
+
+    // an erased EEPROM, an older layout or a partial write are not applied
+    if (stored.version != CALIBRATION_VERSION || stored.count < 2 || stored.count > CALIBRATION_POINTS
+            || stored.checksum != calibration::checksum(stored)) {
+        return;
+    }
+
+    memcpy(this->measured, stored.measured, sizeof(this->measured));
+    this->count = stored.count;
+    LOG_INFO(CALIBRATION_LOADED, this->count);
+}
+
+deciamps_t calibration::point(const uint8_t index) {
+    return VIRIDIAN_MIN_RANGE_CURRENT + index * CALIBRATION_POINT_STEP;
+}
+
+bool calibration::calibrated() const {
+    return !this->running && this->count >= 2;
+}
+
+deciamps_t calibration::correct(const deciamps_t current) const {
+    if (!this->calibrated()) {
+        return current;
+    }
+
+    // segment of the measured currents around the current, the first or last one outside of them
+    uint8_t i = 0;
+    while (i + 2 < this->count && current > this->measured[i + 1]) {
+        i++;
+    }
+
+    // outside of the measured points, the offset of the closest one is kept
+    int32_t command;
+    if (current <= this->measured[0]) {
+        command = current + calibration::point(0) - this->measured[0];
+    } else if (current >= this->measured[this->count - 1]) {
+        command = current + calibration::point(this->count - 1) - this->measured[this->count - 1];
+    } else {
+        command = calibration::point(i) + (int32_t)(current - this->measured[i]) * CALIBRATION_POINT_STEP
+            / (this->measured[i + 1] - this->measured[i]);
+    }
+
+    if (command < VIRIDIAN_MIN_RANGE_CURRENT) {
+        return VIRIDIAN_MIN_RANGE_CURRENT;
+    }
+    if (command > VIRIDIAN_MAX_RANGE_CURRENT) {
+        return VIRIDIAN_MAX_RANGE_CURRENT;
+    }
+    return command;
+}
+
+void calibration::start() {
+    LOG_INFO(CALIBRATION_START);
+
+    this->running = true;
+    this->count = 0;
+    this->step = 0;
+    this->house = 0;
+    this->sum = 0;
+    this->frames = 0;
+}
+
+deciamps_t calibration::command() const {
+    return this->step == 0 ? 0 : calibration::point(this->step - 1);
+}
+
+bool calibration::measure(const deciamps_t current) {
+    this->sum += current;
+    this->frames++;
+
+    if (this->frames < CALIBRATION_FRAMES) {
+        return false;
+    }
+
+    deciamps_t average = this->sum / CALIBRATION_FRAMES;
+    this->sum = 0;
+    this->frames = 0;
+
+    if (this->step == 0) {
+        this->house = average;
+    } else {
+        this->measured[this->step - 1] = average - this->house;
+        this->count = this->step;
+    }
+
+    LOG_INFO(CALIBRATION_POINT, this->command(), average);
+    return true;
+}
+
+bool calibration::next() {
+    if (this->step >= CALIBRATION_POINTS) {
+        return false;
+    }
+
+    this->step++;
+    return true;
+}
+
+void calibration::finish() {
+    this->running = false;
+
+    // the car must draw more current at each point, otherwise the curve can not be inverted
+    bool valid = this->count >= 2;
+    for (uint8_t i = 1; i < this->count; i++) {
+        valid &= this->measured[i] > this->measured[i - 1];
+    }
+
+    if (!valid) {
+        LOG_WARNING(CALIBRATION_INVALID, this->count);
+        this->load();
+        return;
+    }
+
+    calibration_eeprom_t stored;
+    memset(&stored, 0, sizeof(stored));
+    stored.version = CALIBRATION_VERSION;
+    stored.count = this->count;
+    memcpy(stored.measured, this->measured, sizeof(stored.measured));
+    stored.checksum = calibration::checksum(stored);
+    EEPROM.put(this->address(), stored);
+
+    LOG_INFO(CALIBRATION_STORED, this->count);
+}
+
+void calibration::abort() {
+    if (!this->running) {
+        return;
+    }
+
+    LOG_WARNING(CALIBRATION_ABORTED, this->step);
+    this->load();
+}
+
+uint8_t calibration::checksum(const calibration_eeprom_t &stored) {
+    const uint8_t* bytes = (const uint8_t*)&stored;
+    uint8_t sum = 0;
+
+    // all the bytes but the checksum, complemented so an erased EEPROM does not match
+    for (uint8_t i = 0; i < offsetof(calibration_eeprom_t, checksum); i++) {
+        sum += bytes[i];
+    }
+    return ~sum;
+}
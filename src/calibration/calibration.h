@@ -0,0 +1,84 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "viridian/viridian.h"
+
+// Calibration of the current drawn by the car against the charging current sent to the Viridian
+// while a car is charging, the charge is stopped to measure the load of the house, then the charging
+// current is stepped through the range, and the current of the charger phase is measured at each step
+// the measured currents are stored in EEPROM and used by correct() to find the charging current to send
+// for the current the car should draw (piecewise linear between the points)
+// each charger has its own calibration
+
+// EEPROM address of the calibration of the first charger, the ones of the next chargers follow the restart counters
+static const int CALIBRATION_EEPROM_ADDRESS = 0;
+static const int CALIBRATION_EEPROM_NEXT_ADDRESS = 48;
+
+// version of the stored calibration, to be changed with its layout or its points
+static const uint8_t CALIBRATION_VERSION = 1;
+
+// charging currents of the points, across the working range of the Viridian
+static const uint8_t CALIBRATION_POINTS = 6;
+static const deciamps_t CALIBRATION_POINT_STEP = (VIRIDIAN_MAX_RANGE_CURRENT - VIRIDIAN_MIN_RANGE_CURRENT) / (CALIBRATION_POINTS - 1);
+
+// delay after each step before measuring (ms), long enough for the car to start again after the stop
+static const uint32_t CALIBRATION_SETTLE_DELAY = 15000;
+
+// number of meter frames averaged at each step
+static const uint8_t CALIBRATION_FRAMES = 5;
+
+typedef struct calibration_eeprom_t calibration_eeprom_t;
+struct calibration_eeprom_t {
+    uint8_t version;
+    // number of measured points, from the first one
+    uint8_t count;
+    // current drawn by the car at each point
+    deciamps_t measured[CALIBRATION_POINTS];
+    uint8_t checksum;
+};
+
+// end of the calibrations in EEPROM, with the most chargers, so the next records do not move with their number
+static const int CALIBRATION_EEPROM_END = CALIBRATION_EEPROM_NEXT_ADDRESS + (DAC_MCP4725_I2C_ADDRESSES - 1) * sizeof(calibration_eeprom_t);
+
+class calibration {
+    public:
+        // load the stored calibration of the charger
+        void initialize(const uint8_t index);
+
+        // charging current to send for the car to draw the current, unchanged without calibration
+        deciamps_t correct(const deciamps_t current) const;
+        bool calibrated() const;
+
+        // start a calibration, the correction is disabled until its end
+        void start();
+        // charging current of the running step: 0 to measure the house, then the points
+        deciamps_t command() const;
+        // add a measure of the charger phase current for the step, returns true once the step is measured
+        bool measure(const deciamps_t current);
+        // move to the next step, returns false after the last one
+        bool next();
+        // store the measured points if they make a valid calibration, and apply them
+        void finish();
+        // stop without storing, the previous calibration is applied again
+        void abort();
+
+    private:
+        void load();
+        int address() const;
+        static deciamps_t point(const uint8_t index);
+        static uint8_t checksum(const calibration_eeprom_t &stored);
+
+        uint8_t index;
+
+        // points of the applied calibration, or of the running one
+        deciamps_t measured[CALIBRATION_POINTS];
+        uint8_t count;
+        bool running;
+
+        // step 0 is the house, then the points
+        uint8_t step;
+        deciamps_t house;
+        int16_t sum;
+        uint8_t frames;
+};
@@ -0,0 +1,221 @@
+#include <Arduino.h>
+
+#include "logger/logger.h"
+
+#include "chargers.h"
+
+viridian chargers::list[VIRIDIAN_CHARGERS];
+calibration chargers::calibrations[VIRIDIAN_CHARGERS];
+uint8_t chargers::_active;
+deciamps_t chargers::offer;
+chargers_share_t chargers::policy;
+
+void chargers::initialize(const deciamps_t* currents, const deciamps_t offer) {
+    chargers::offer = offer;
+    chargers::policy = CHARGERS_SHARE;
+
+    // load the calibration of each charger, then initialize its viridian interface
+    for (uint8_t i = 0; i < VIRIDIAN_CHARGERS; i++) {
+        chargers::calibrations[i].initialize(i);
+        chargers::list[i].initialize(i, chargers::calibrations[i], currents != NULL ? currents[i] : 0);
+    }
+
+    chargers::refresh();
+}
+
+void chargers::update() {
+    for (uint8_t i = 0; i < VIRIDIAN_CHARGERS; i++) {
+        chargers::list[i].update();
+    }
+}
+
+bool chargers::refresh() {
+    uint8_t active = 0;
+
+    for (uint8_t i = 0; i < VIRIDIAN_CHARGERS; i++) {
+        if (chargers::list[i].carCharging()) {
+            active |= _BV(i);
+        }
+    }
+
+    bool changed = active != chargers::_active;
+    chargers::_active = active;
+    return changed;
+}
+
+uint8_t chargers::active() {
+    return chargers::_active;
+}
+
+bool chargers::carCharging() {
+    return chargers::_active != 0;
+}
+
+bool chargers::calibrated() {
+    bool calibrated = chargers::_active != 0;
+
+    for (uint8_t i = 0; i < VIRIDIAN_CHARGERS; i++) {
+        if (chargers::_active & _BV(i)) {
+            calibrated &= chargers::calibrations[i].calibrated();
+        }
+    }
+    return calibrated;
+}
+
+void chargers::setChargingCurrent(const deciamps_t current) {
+    deciamps_t shares[VIRIDIAN_CHARGERS];
+
+    chargers::split(current, shares);
+
+    // the decreases first, so the chargers never draw more than the current in between
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        for (uint8_t i = 0; i < VIRIDIAN_CHARGERS; i++) {
+            bool active = chargers::_active & _BV(i);
+            deciamps_t share = active ? shares[i] : chargers::offer;
+            deciamps_t previous = chargers::list[i].getChargingCurrent();
+
+            if ((share < previous) != (pass == 0)) {
+                continue;
+            }
+
+            if (VIRIDIAN_CHARGERS > 1 && active && share != previous) {
+                LOG_INFO(CHARGERS_SHARE, i, share);
+            }
+            chargers::list[i].setChargingCurrent(share);
+        }
+    }
+}
+
+deciamps_t chargers::getChargingCurrent() {
+    deciamps_t current = 0;
+
+    for (uint8_t i = 0; i < VIRIDIAN_CHARGERS; i++) {
+        if (chargers::_active & _BV(i)) {
+            current += chargers::list[i].getChargingCurrent();
+        }
+    }
+    return current;
+}
+
+void chargers::setShare(const chargers_share_t share) {
+    chargers::policy = share;
+}
+
+void chargers::resetChange() {
+    for (uint8_t i = 0; i < VIRIDIAN_CHARGERS; i++) {
+        chargers::list[i].resetChange();
+    }
+}
+
+bool chargers::currentChanged() {
+    bool changed = false;
+
+    for (uint8_t i = 0; i < VIRIDIAN_CHARGERS; i++) {
+        changed |= chargers::list[i].currentChanged();
+    }
+    return changed;
+}
+
+viridian &chargers::get(const uint8_t index) {
+    return chargers::list[index];
+}
+
+calibration &chargers::getCalibration(const uint8_t index) {
+    return chargers::calibrations[index];
+}
+
+void chargers::split(const deciamps_t current, deciamps_t* shares) {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < VIRIDIAN_CHARGERS; i++) {
+        count += (chargers::_active >> i) & 1;
+    }
+
+    // the last chargers are stopped until the others get the minimum
+    // the last one left gets what remains, the viridian stops it below the minimum
+    chargers::share(count, current, shares);
+    while (count > 1) {
+        deciamps_t minimum = VIRIDIAN_MAX_RANGE_CURRENT;
+        uint8_t rank = 0;
+
+        for (uint8_t i = 0; i < VIRIDIAN_CHARGERS && rank < count; i++) {
+            if (chargers::_active & _BV(i)) {
+                rank++;
+                if (shares[i] < minimum) {
+                    minimum = shares[i];
+                }
+            }
+        }
+
+        if (minimum >= VIRIDIAN_MIN_RANGE_CURRENT) {
+            break;
+        }
+
+        count--;
+        chargers::share(count, current, shares);
+    }
+}
+
+// share the current between the first count chargers with a car, the others get 0
+void chargers::share(const uint8_t count, const deciamps_t current, deciamps_t* shares) {
+    // chargers taking part in the share
+    uint8_t sharing = 0;
+    uint8_t rank = 0;
+    for (uint8_t i = 0; i < VIRIDIAN_CHARGERS && rank < count; i++) {
+        if (chargers::_active & _BV(i)) {
+            sharing |= _BV(i);
+            rank++;
+        }
+    }
+
+    memset(shares, 0, VIRIDIAN_CHARGERS * sizeof(deciamps_t));
+    if (count == 0) {
+        return;
+    }
+
+    int16_t remaining = current;
+
+    switch (chargers::policy) {
+        case CHARGERS_SHARE_EQUAL:
+            for (uint8_t i = 0; i < VIRIDIAN_CHARGERS; i++) {
+                if (sharing & _BV(i)) {
+                    shares[i] = current / count < CHARGERS_MAX_CURRENT[i] ? current / count : CHARGERS_MAX_CURRENT[i];
+                }
+            }
+            break;
+        case CHARGERS_SHARE_PRIORITY:
+            for (uint8_t i = 0; i < VIRIDIAN_CHARGERS; i++) {
+                if (sharing & _BV(i)) {
+                    shares[i] = remaining < CHARGERS_MAX_CURRENT[i] ? remaining : CHARGERS_MAX_CURRENT[i];
+                    if (shares[i] < 0) {
+                        shares[i] = 0;
+                    }
+                    remaining -= shares[i];
+                }
+            }
+            break;
+        case CHARGERS_SHARE_MAX_MIN: {
+            // water filling: the chargers whose maximum is below the level get it, the level rises for the others
+            uint8_t unfixed = count;
+            bool fixed;
+            do {
+                fixed = false;
+                for (uint8_t i = 0; i < VIRIDIAN_CHARGERS && unfixed > 0; i++) {
+                    if ((sharing & _BV(i)) && CHARGERS_MAX_CURRENT[i] <= remaining / unfixed) {
+                        shares[i] = CHARGERS_MAX_CURRENT[i];
+                        remaining -= shares[i];
+                        sharing &= ~_BV(i);
+                        unfixed--;
+                        fixed = true;
+                    }
+                }
+            } while (fixed && unfixed > 0);
+
+            for (uint8_t i = 0; i < VIRIDIAN_CHARGERS; i++) {
+                if (sharing & _BV(i)) {
+                    shares[i] = remaining / unfixed;
+                }
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "calibration/calibration.h"
+#include "viridian/viridian.h"
+
+// Chargers behind the meter
+// the charging current of the site is split between the chargers with a car charging, with the share
+// policy, each of them gets at least the minimum of the working range or nothing: when the current is
+// too low for all of them, the last chargers are stopped
+// the chargers without a car are offered a current for a car to start charging
+
+enum chargers_share_t : uint8_t {
+    // the same current for each charger, up to its maximum
+    CHARGERS_SHARE_EQUAL,
+    // in the order of the chargers, each one takes all it can before the next one
+    CHARGERS_SHARE_PRIORITY,
+    // max-min fairness: the same current for each charger, what the ones at their maximum can not take goes to the others
+    CHARGERS_SHARE_MAX_MIN
+};
+
+// share policy, can be changed with -D CHARGERS_SHARE=CHARGERS_SHARE_EQUAL
+#ifndef CHARGERS_SHARE
+#define CHARGERS_SHARE CHARGERS_SHARE_MAX_MIN
+#endif
+
+// maximum charging current of each charger, for its wiring or the car usually plugged on it
+static const deciamps_t CHARGERS_MAX_CURRENT[DAC_MCP4725_I2C_ADDRESSES] = {
+    VIRIDIAN_MAX_RANGE_CURRENT, VIRIDIAN_MAX_RANGE_CURRENT, VIRIDIAN_MAX_RANGE_CURRENT, VIRIDIAN_MAX_RANGE_CURRENT,
+    VIRIDIAN_MAX_RANGE_CURRENT, VIRIDIAN_MAX_RANGE_CURRENT, VIRIDIAN_MAX_RANGE_CURRENT, VIRIDIAN_MAX_RANGE_CURRENT
+};
+
+class chargers {
+    public:
+        // start each charger with the current kept by a warm restart, or stopped without them
+        // the offer is sent to the chargers without a car by the next calls to setChargingCurrent()
+        static void initialize(const deciamps_t* currents, const deciamps_t offer);
+        // move the DAC outputs toward the charging currents, to be called often
+        static void update();
+
+        // read the charging signals, returns true if the chargers with a car changed
+        static bool refresh();
+        // bit i is set if a car is charging on charger i
+        static uint8_t active();
+        static bool carCharging();
+        // the chargers with a car are all calibrated
+        static bool calibrated();
+
+        // split the charging current between the chargers with a car
+        static void setChargingCurrent(const deciamps_t current);
+        // sum of the charging currents of the chargers with a car
+        static deciamps_t getChargingCurrent();
+        static void setShare(const chargers_share_t share);
+
+        static void resetChange();
+        static bool currentChanged();
+
+        static viridian &get(const uint8_t index);
+        static calibration &getCalibration(const uint8_t index);
+
+    private:
+        static void split(const deciamps_t current, deciamps_t* shares);
+        static void share(const uint8_t count, const deciamps_t current, deciamps_t* shares);
+
+        static viridian list[VIRIDIAN_CHARGERS];
+        static calibration calibrations[VIRIDIAN_CHARGERS];
+        static uint8_t _active;
+        static deciamps_t offer;
+        static chargers_share_t policy;
+};
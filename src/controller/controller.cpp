@@ -0,0 +1,90 @@
+#include <Arduino.h>
+
+#include "controller.h"
+
+int32_t controller::command;
+deciamps_t controller::lastHeadroom;
+uint32_t controller::lastUpdate;
+uint32_t controller::lastIncrease;
+
+void controller::start(const deciamps_t current) {
+    controller::command = (int32_t)current << CONTROLLER_GAIN_SHIFT;
+    controller::lastHeadroom = 0;
+    controller::lastUpdate = millis();
+    // the first increase waits for the car to take the starting current
+    controller::lastIncrease = controller::lastUpdate;
+}
+
+deciamps_t controller::update(const deciamps_t current, deciamps_t headroom, const bool adps) {
+    uint32_t now = millis();
+    uint32_t interval = now - controller::lastUpdate;
+    controller::lastUpdate = now;
+
+    if (adps && headroom >= 0) {
+        headroom = -CONTROLLER_ADPS_DECREASE;
+    }
+
+    // fast back-off: the whole excess is removed at once, and the integral restarts from there
+    if (headroom < 0) {
+        deciamps_t backOff = current + headroom;
+        if (backOff < VIRIDIAN_MIN_RANGE_CURRENT) {
+            backOff = 0;
+        }
+
+        controller::command = (int32_t)backOff << CONTROLLER_GAIN_SHIFT;
+        controller::lastHeadroom = headroom;
+        return backOff;
+    }
+
+    if (interval > CONTROLLER_MAX_UPDATE_INTERVAL) {
+        interval = CONTROLLER_MAX_UPDATE_INTERVAL;
+    }
+
+    // incremental PI: proportional on the change of the headroom, integral on the headroom
+    controller::command += (int32_t)CONTROLLER_KP * (headroom - controller::lastHeadroom)
+        + (int32_t)CONTROLLER_KI * headroom * (int32_t)interval / 1000;
+    controller::lastHeadroom = headroom;
+
+    // anti-windup: the command stays in the range the car can be sent
+    int32_t maxCommand = (int32_t)VIRIDIAN_MAX_RANGE_CURRENT << CONTROLLER_GAIN_SHIFT;
+    // nor further than the next allowed increase, or than the restart at the minimum when stopped
+    deciamps_t increaseLimit = current < VIRIDIAN_MIN_RANGE_CURRENT ? VIRIDIAN_MIN_RANGE_CURRENT : current + CONTROLLER_MAX_INCREASE;
+    int32_t maxIncrease = (int32_t)increaseLimit << CONTROLLER_GAIN_SHIFT;
+    if (maxIncrease < maxCommand) {
+        maxCommand = maxIncrease;
+    }
+    if (controller::command > maxCommand) {
+        controller::command = maxCommand;
+    } else if (controller::command < 0) {
+        controller::command = 0;
+    }
+
+    deciamps_t newCurrent = controller::command >> CONTROLLER_GAIN_SHIFT;
+
+    // below the working range the car is stopped
+    if (newCurrent < VIRIDIAN_MIN_RANGE_CURRENT) {
+        newCurrent = 0;
+    }
+
+    // it restarts once the headroom allows the minimum current, not to stop again right away
+    if (current == 0 && headroom < VIRIDIAN_MIN_RANGE_CURRENT) {
+        return 0;
+    }
+
+    deciamps_t change = newCurrent - current;
+
+    if (newCurrent != 0 && current != 0 && change > -CONTROLLER_MIN_CHANGE && change < CONTROLLER_MIN_CHANGE) {
+        // not worth a command
+        return current;
+    }
+
+    if (change > 0) {
+        // slew limit: the car is not commanded up too often
+        if (now - controller::lastIncrease < CONTROLLER_INCREASE_INTERVAL) {
+            return current;
+        }
+        controller::lastIncrease = now;
+    }
+
+    return newCurrent;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "viridian/viridian.h"
+
+// PI controller of the charging current, on the headroom: ISOUSC * k - IINST - margin
+// the controller is incremental: its state is the command, so it cannot wind up past the
+// viridian limits, and the integral starts from the current actually sent to the car
+// all the values are in deciamps, the gains in 1/16
+static const uint8_t CONTROLLER_GAIN_SHIFT = 4;
+
+// proportional gain, on the change of the headroom (0.25)
+static const int16_t CONTROLLER_KP = 4;
+// integral gain per second (0.125/s: a constant headroom is taken in about 8s)
+static const int16_t CONTROLLER_KI = 2;
+
+// slew limits of the increases: minimum time between two increases in ms,
+// maximum increase per command, and minimum change worth a command
+static const uint32_t CONTROLLER_INCREASE_INTERVAL = 30000;
+static const deciamps_t CONTROLLER_MAX_INCREASE = 30;
+static const deciamps_t CONTROLLER_MIN_CHANGE = 5;
+
+// additional decrease when an ADPS is received while the headroom is still positive
+// (e.g. with the greater ISOUSC option)
+static const deciamps_t CONTROLLER_ADPS_DECREASE = 20;
+
+// maximum time between two updates taken in the integral in ms, after a loss of the teleinfo
+static const uint32_t CONTROLLER_MAX_UPDATE_INTERVAL = 5000;
+
+class controller {
+    public:
+        // start the controller from the current sent to the car
+        static void start(const deciamps_t current);
+
+        // new charging current for the headroom, the current sent to the car if there is nothing to change
+        // a negative headroom, or an ADPS, is backed off at once, whatever the slew limits
+        static deciamps_t update(const deciamps_t current, deciamps_t headroom, const bool adps);
+
+    private:
+        // command with the fractional part of the integral, in 1/16 deciamps
+        static int32_t command;
+        static deciamps_t lastHeadroom;
+        static uint32_t lastUpdate;
+        static uint32_t lastIncrease;
+};
@@ -1,32 +1,187 @@
 #include <Arduino.h>
 #include <Wire.h>
 
-#include "debug/debug.h"
+#include "logger/logger.h"
+#include "profiler/profiler.h"
+#include "telemetry/telemetry.h"
 
 #include "dac_MCP4725.h"
 
-void dac_MCP4725::initialize() {
-    // initialze the wire interface
+void dac_MCP4725::initialize(const uint8_t index) {
+    // initialze the wire interface, in fast mode, it is shared by the DACs
     Wire.begin();
+    Wire.setClock(DAC_MCP4725_I2C_CLOCK);
+
+    this->address = DAC_MCP4725_I2C_ADDRESS + index % DAC_MCP4725_I2C_ADDRESSES;
+    this->setSlewRate(DAC_MCP4725_DEFAULT_SLEW_RATE);
+
+    // the ramp starts from the power-on value of the DAC
+    int16_t value = this->read();
+    this->value = value >= 0 ? value : 0;
+    this->target = this->value;
+    this->lastStep = millis();
+    this->failed = false;
 }
 
-void dac_MCP4725::write(int value) {
+uint8_t dac_MCP4725::transmit(const uint16_t value) {
     // begin the transmission to the DAC
-    Wire.beginTransmission(DAC_MCP4725_I2C_ADDRESS);
+    Wire.beginTransmission(this->address);
 
-    // send the first command word: standard speed write with no EEPROM
-    Wire.write(0b01000000);
+    // fast write: command and power down bits to 0, then the 12 bits of the value
+    Wire.write((value >> 8) & 0x0F);
+    Wire.write(value & 0xFF);
 
-    // send the first part of the value
-    Wire.write((value & 0xFF0) >> 4);
+    // end the transmission
+    return Wire.endTransmission();
+}
+
+uint8_t dac_MCP4725::write(const uint16_t value) {
+    PROFILE(DAC);
+    PROFILE_DAC_WRITE();
+
+    uint8_t status = 0;
+    uint8_t attempt;
+
+    for (attempt = 1; attempt <= DAC_MCP4725_ATTEMPTS; attempt++) {
+        status = this->transmit(value);
+
+#if DAC_MCP4725_VERIFY
+        // the DAC may have missed the value even if it acknowledged it
+        if (status == 0 && this->read() != (int16_t)value) {
+            status = DAC_MCP4725_VERIFY_FAILED;
+        }
+#endif
+
+        if (status == 0) {
+            break;
+        }
+    }
+
+    if (status == 0) {
+        this->value = value;
+        this->failed = false;
+    } else if (!this->failed) {
+        // only the first failure is logged, the retries would flood the log
+        if (status == DAC_MCP4725_VERIFY_FAILED) {
+            LOG_ERROR(DAC_VERIFY_ERROR, value);
+        } else {
+            LOG_ERROR(DAC_I2C_ERROR, status);
+        }
+        this->failed = true;
+    }
+
+    telemetry::dac(this->address, value, this->target, status, attempt > DAC_MCP4725_ATTEMPTS ? DAC_MCP4725_ATTEMPTS : attempt);
+    return status;
+}
+
+int16_t dac_MCP4725::read() {
+    // status, then the DAC register: bits 11 to 4, and bits 3 to 0 in the high nibble
+    if (Wire.requestFrom(this->address, (uint8_t)3) != 3) {
+        return -1;
+    }
+
+    Wire.read();
+    uint8_t high = Wire.read();
+    uint8_t low = Wire.read();
+
+    return ((uint16_t)high << 4) | (low >> 4);
+}
+
+int16_t dac_MCP4725::readPowerOnValue() {
+    // status, DAC register, then the EEPROM: power down bits and bits 11 to 8, then bits 7 to 0
+    if (Wire.requestFrom(this->address, (uint8_t)5) != 5) {
+        return -1;
+    }
+
+    for (uint8_t i = 0; i < 3; i++) {
+        Wire.read();
+    }
+    uint8_t high = Wire.read();
+    uint8_t low = Wire.read();
+
+    return ((uint16_t)(high & 0x0F) << 8) | low;
+}
+
+uint8_t dac_MCP4725::writePowerOnValue(const uint16_t value) {
+    // the EEPROM endurance is limited, it is only written when needed
+    if (this->readPowerOnValue() == (int16_t)value) {
+        return 0;
+    }
 
-    // send the last part of the value
+    LOG_INFO(DAC_POWER_ON_VALUE, value);
+
+    // write DAC register and EEPROM: the value is sent as in the standard write
+    Wire.beginTransmission(this->address);
+    Wire.write(DAC_MCP4725_WRITE_EEPROM);
+    Wire.write((value & 0xFF0) >> 4);
     Wire.write((value & 0xF) << 4);
+    uint8_t status = Wire.endTransmission();
 
-    // end the transmission
-    byte endTransmission = Wire.endTransmission(); 
-    if (endTransmission!= 0) {
-        debug::logNoLine(F("dac_MCP4725: Error during I2C transmission - "));
-        debug::log(String(endTransmission));
+    if (status != 0) {
+        LOG_ERROR(DAC_I2C_ERROR, status);
+        return status;
+    }
+
+    // the output is set too, and the DAC ignores the next writes until the EEPROM is written
+    this->value = value;
+    this->target = value;
+    delay(DAC_MCP4725_EEPROM_WRITE_TIME);
+    return 0;
+}
+
+void dac_MCP4725::rampTo(const uint16_t value) {
+    this->target = value > DAC_MCP4725_MAX_VALUE ? DAC_MCP4725_MAX_VALUE : value;
+
+    // a decrease may be needed to avoid an overcurrent, it is never delayed
+    if (this->target < this->value || (this->target > this->value && this->rampStep == 0)) {
+        this->write(this->target);
+        this->lastStep = millis();
+    }
+}
+
+void dac_MCP4725::update() {
+    // a failed DAC is written again, even at its target, but less often
+    if (this->failed) {
+        if (millis() - this->lastStep < DAC_MCP4725_RETRY_PERIOD) {
+            return;
+        }
+    } else if (this->value == this->target || millis() - this->lastStep < DAC_MCP4725_RAMP_PERIOD) {
+        return;
+    }
+
+    this->lastStep = millis();
+
+    // a failed decrease is written again as is
+    uint16_t next = this->target;
+    if (this->target > this->value && this->rampStep > 0
+            && this->target - this->value > this->rampStep) {
+        next = this->value + this->rampStep;
     }
-}
\ No newline at end of file
+
+    this->write(next);
+}
+
+void dac_MCP4725::setSlewRate(const uint16_t rate) {
+    this->rampStep = (uint32_t)rate * DAC_MCP4725_RAMP_PERIOD / 1000;
+
+    // at least one value per step, so a slow ramp still ends
+    if (rate > 0 && this->rampStep == 0) {
+        this->rampStep = 1;
+    }
+}
+
+uint16_t dac_MCP4725::getValue() const {
+    return this->value;
+}
+
+uint16_t dac_MCP4725::getTarget() const {
+    return this->target;
+}
+
+uint8_t dac_MCP4725::getAddress() const {
+    return this->address;
+}
+
+boolean dac_MCP4725::hasFailed() const {
+    return this->failed;
+}
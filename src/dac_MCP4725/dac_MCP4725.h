@@ -2,11 +2,85 @@
 
 #include <Arduino.h>
 
-// I2C address of the DAC
+// Driver of the MCP4725 DAC
+// the value is written with the 2 bytes fast write command on a 400 kHz bus, read back to check it
+// was applied and written again on failure
+// the increases of the output are ramped at the slew rate by update(), the decreases are immediate,
+// so the charge controller of the car is never asked for more current than it was before
+// each instance drives one DAC, up to 8 of them share the bus with the addresses set by their A0-A2 pins
+// a DAC still failing after all the attempts is latched as failed: the error is logged once, and the
+// value is written again once per retry period only, until the DAC answers again
+
+// I2C address of the first DAC, with its address pins low, and the number of addresses
 static const uint8_t DAC_MCP4725_I2C_ADDRESS = 0b1100000;
+static const uint8_t DAC_MCP4725_I2C_ADDRESSES = 8;
+
+// I2C clock, the MCP4725 supports the fast mode
+static const uint32_t DAC_MCP4725_I2C_CLOCK = 400000;
+
+// read back the DAC register after each write, can be disabled with -D DAC_MCP4725_VERIFY=0
+#ifndef DAC_MCP4725_VERIFY
+#define DAC_MCP4725_VERIFY 1
+#endif
+
+// number of attempts of a write before giving up
+static const uint8_t DAC_MCP4725_ATTEMPTS = 3;
+
+// status of a write whose read back value differs, after the I2C errors (1 to 5)
+static const uint8_t DAC_MCP4725_VERIFY_FAILED = 0x10;
+
+// command writing the DAC register and the EEPROM, and the time the EEPROM takes to be written (ms)
+static const uint8_t DAC_MCP4725_WRITE_EEPROM = 0b01100000;
+static const uint32_t DAC_MCP4725_EEPROM_WRITE_TIME = 50;
+
+// maximum value of the 12 bits DAC
+static const uint16_t DAC_MCP4725_MAX_VALUE = 4095;
+
+// period of the steps of the ramp in ms
+static const uint32_t DAC_MCP4725_RAMP_PERIOD = 50;
+
+// period of the writes of a failed DAC in ms
+static const uint32_t DAC_MCP4725_RETRY_PERIOD = 1000;
+
+// default slew rate of the ramp in DAC values per second, about 5.5 A/s of charging current
+static const uint16_t DAC_MCP4725_DEFAULT_SLEW_RATE = 640;
 
 class dac_MCP4725 {
     public:
-        static void initialize();
-        static void write(int value);
-};
\ No newline at end of file
+        // the address is the one of the first DAC plus the index of the DAC
+        void initialize(const uint8_t index);
+
+        // write the value now, returns the result of the last attempt, 0 on success
+        uint8_t write(const uint16_t value);
+        // read the DAC register, returns -1 if the DAC does not answer
+        int16_t read();
+
+        // value output by the DAC at power-on, before the firmware sets it, kept in its EEPROM
+        // the EEPROM is only written if the value changed, it also sets the output
+        int16_t readPowerOnValue();
+        uint8_t writePowerOnValue(const uint16_t value);
+
+        // move the output to the value: now if it is a decrease, with the ramp otherwise
+        void rampTo(const uint16_t value);
+        // step the ramp, to be called often
+        void update();
+        // slew rate of the ramp in DAC values per second, 0 to disable the ramp
+        void setSlewRate(const uint16_t rate);
+
+        uint16_t getValue() const;
+        uint16_t getTarget() const;
+        uint8_t getAddress() const;
+        // the last write failed after all its attempts
+        boolean hasFailed() const;
+
+    private:
+        uint8_t transmit(const uint16_t value);
+
+        uint8_t address;
+        // last value written successfully
+        uint16_t value;
+        uint16_t target;
+        uint16_t rampStep;
+        uint32_t lastStep;
+        boolean failed;
+};
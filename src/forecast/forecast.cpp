@@ -0,0 +1,210 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#include "logger/logger.h"
+
+#include "forecast.h"
+
+forecast_series_t forecast::current;
+forecast_series_t forecast::power;
+
+bool forecast::clockSet;
+uint16_t forecast::minutes;
+uint32_t forecast::minuteStart;
+
+uint8_t forecast::learningSlot;
+deciamps_t forecast::slotPeak;
+
+void forecast::initialize() {
+    memset(&forecast::current, 0, sizeof(forecast::current));
+    memset(&forecast::power, 0, sizeof(forecast::power));
+    forecast::clockSet = false;
+
+    // the baselines of an erased EEPROM or of an older layout are unknown
+    if (EEPROM.read(FORECAST_EEPROM_ADDRESS) != FORECAST_VERSION) {
+        for (uint8_t i = 0; i < FORECAST_SLOTS; i++) {
+            EEPROM.update(FORECAST_EEPROM_ADDRESS + 1 + i, FORECAST_BASELINE_UNKNOWN);
+        }
+        EEPROM.update(FORECAST_EEPROM_ADDRESS, FORECAST_VERSION);
+    }
+}
+
+void forecast::addFrame(const deciamps_t current, const uint32_t power) {
+    forecast::updateClock();
+    forecast::learn(current);
+
+    uint32_t scaledPower = power / FORECAST_POWER_UNIT;
+    forecast::add(forecast::current, current, forecast::baseline());
+    forecast::add(forecast::power, scaledPower < 0x7FFF ? scaledPower : 0x7FFF, 0);
+}
+
+void forecast::add(forecast_series_t &series, const int16_t value, const int16_t baseline) {
+    // the forecast made a horizon ago is checked against the measure
+    if (series.frames >= FORECAST_HORIZON && series.count < 0xFFFF) {
+        int16_t difference = value - series.forecasts[series.index];
+        int16_t persistence = value - series.values[series.index];
+
+        series.count++;
+        series.error += difference;
+        series.absoluteError += difference >= 0 ? difference : -difference;
+        series.persistenceError += persistence >= 0 ? persistence : -persistence;
+        series.misses += difference > FORECAST_MISS;
+        series.persistenceMisses += persistence > FORECAST_MISS;
+    }
+
+    int32_t scaled = (int32_t)value * (1 << FORECAST_SHIFT);
+    if (series.frames == 0) {
+        series.level = scaled;
+        series.trend = 0;
+    } else {
+        int32_t previous = series.level;
+        int32_t predicted = series.level + series.trend;
+        series.level = predicted + (scaled - predicted) / FORECAST_LEVEL_DIVISOR;
+        series.trend += (series.level - previous - series.trend) / FORECAST_TREND_DIVISOR;
+    }
+
+    int16_t peak = forecast::peak(series);
+    series.forecasts[series.index] = peak > baseline ? peak : baseline;
+    series.values[series.index] = value;
+    series.index = (series.index + 1) % FORECAST_HORIZON;
+    if (series.frames < FORECAST_HORIZON) {
+        series.frames++;
+    }
+}
+
+int16_t forecast::peak(const forecast_series_t &series) {
+    // a falling trend does not lower the peak below the level
+    int32_t peak = series.level + (series.trend > 0 ? series.trend * FORECAST_HORIZON : 0);
+    return peak / (1 << FORECAST_SHIFT);
+}
+
+deciamps_t forecast::margin() {
+    if (forecast::current.frames == 0) {
+        return 0;
+    }
+
+    deciamps_t last = forecast::current.values[(forecast::current.index + FORECAST_HORIZON - 1) % FORECAST_HORIZON];
+    deciamps_t increase = forecast::currentPeak() - last;
+
+    if (increase < 0) {
+        return 0;
+    }
+    return increase < FORECAST_MAX_MARGIN ? increase : FORECAST_MAX_MARGIN;
+}
+
+deciamps_t forecast::currentPeak() {
+    deciamps_t peak = forecast::peak(forecast::current);
+    deciamps_t baseline = forecast::baseline();
+    return peak > baseline ? peak : baseline;
+}
+
+uint32_t forecast::powerPeak() {
+    int16_t peak = forecast::peak(forecast::power);
+    return peak > 0 ? (uint32_t)peak * FORECAST_POWER_UNIT : 0;
+}
+
+void forecast::setTime(const uint16_t minutes) {
+    forecast::minutes = minutes % (24 * 60);
+    forecast::minuteStart = millis();
+
+    // the slot is learned from now on
+    forecast::clockSet = true;
+    forecast::learningSlot = forecast::slot();
+    forecast::slotPeak = -1;
+
+    LOG_INFO(FORECAST_TIME_SET, forecast::minutes / 60, forecast::minutes % 60);
+}
+
+bool forecast::timeSet() {
+    return forecast::clockSet;
+}
+
+void forecast::report() {
+    forecast::reportSeries(forecast::current, "current (dA)");
+    forecast::reportSeries(forecast::power, "power (10 VA)");
+}
+
+void forecast::reportSeries(forecast_series_t &series, const char* name) {
+    uint16_t count = series.count > 0 ? series.count : 1;
+
+    LOG_INFO(FORECAST_ERRORS, name, series.count, (int16_t)(series.error / count),
+        (uint16_t)(series.absoluteError / count), (uint16_t)(series.persistenceError / count),
+        series.misses, series.persistenceMisses);
+
+    series.count = 0;
+    series.error = 0;
+    series.absoluteError = 0;
+    series.persistenceError = 0;
+    series.misses = 0;
+    series.persistenceMisses = 0;
+}
+
+void forecast::updateClock() {
+    if (!forecast::clockSet) {
+        return;
+    }
+
+    // the minutes are counted from the last one, so the clock does not drift with the frames
+    while (millis() - forecast::minuteStart >= 60000) {
+        forecast::minuteStart += 60000;
+        forecast::minutes = (forecast::minutes + 1) % (24 * 60);
+    }
+}
+
+uint8_t forecast::slot() {
+    return forecast::minutes / FORECAST_SLOT_MINUTES;
+}
+
+// the highest baseline of the slot and of the next one, 0 if they are unknown
+int16_t forecast::baseline() {
+    if (!forecast::clockSet) {
+        return 0;
+    }
+
+    int16_t baseline = 0;
+    for (uint8_t i = 0; i < 2; i++) {
+        uint8_t stored = EEPROM.read(FORECAST_EEPROM_ADDRESS + 1 + (forecast::slot() + i) % FORECAST_SLOTS);
+        if (stored != FORECAST_BASELINE_UNKNOWN && stored * FORECAST_BASELINE_UNIT > baseline) {
+            baseline = stored * FORECAST_BASELINE_UNIT;
+        }
+    }
+    return baseline;
+}
+
+void forecast::learn(const deciamps_t current) {
+    if (!forecast::clockSet) {
+        return;
+    }
+
+    if (forecast::slot() == forecast::learningSlot) {
+        if (current > forecast::slotPeak) {
+            forecast::slotPeak = current;
+        }
+        return;
+    }
+
+    // end of the slot: its baseline moves toward the peak of the day
+    if (forecast::slotPeak >= 0) {
+        int address = FORECAST_EEPROM_ADDRESS + 1 + forecast::learningSlot;
+        int16_t peak = (forecast::slotPeak + FORECAST_BASELINE_UNIT / 2) / FORECAST_BASELINE_UNIT;
+        int16_t stored = EEPROM.read(address);
+
+        if (peak >= FORECAST_BASELINE_UNKNOWN) {
+            peak = FORECAST_BASELINE_UNKNOWN - 1;
+        }
+
+        if (stored == FORECAST_BASELINE_UNKNOWN) {
+            stored = peak;
+        } else if (peak != stored) {
+            // at least one step, so the baseline reaches the peak
+            int16_t step = (peak - stored) / FORECAST_BASELINE_DIVISOR;
+            stored += step != 0 ? step : (peak > stored ? 1 : -1);
+        }
+
+        EEPROM.update(address, stored);
+        LOG_DEBUG(FORECAST_BASELINE, forecast::learningSlot, stored * FORECAST_BASELINE_UNIT);
+    }
+
+    forecast::learningSlot = forecast::slot();
+    forecast::slotPeak = current;
+}
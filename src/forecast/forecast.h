@@ -0,0 +1,113 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "calibration/calibration.h"
+#include "viridian/viridian.h"
+
+// Short horizon forecast of the load of the house, the charge excluded
+// the current and the apparent power of each frame are smoothed with a level and a trend (Holt's double
+// exponential smoothing), the peak over the horizon is the level, plus the trend when it is rising
+// the current also has a baseline for each quarter of an hour of the day: the usual peak of the quarter,
+// learned in EEPROM, so the charge can be lowered ahead of the oven or the heat pump starting at their usual time
+// the board has no clock: the baselines are only learned and used once the time of the day is set
+// each forecast is checked against the value measured at the horizon, with the persistence forecast
+// (the value does not change) as a reference, to tell if the forecast helps
+
+// values are in 1/16 of their unit
+static const uint8_t FORECAST_SHIFT = 4;
+
+// smoothing of the level (1/4) and of the trend (1/8), as divisors
+static const int32_t FORECAST_LEVEL_DIVISOR = 4;
+static const int32_t FORECAST_TREND_DIVISOR = 8;
+
+// horizon of the forecast in frames, about 12s in historic mode
+static const uint8_t FORECAST_HORIZON = 8;
+
+// maximum current kept free for a forecast increase, the ADPS handles the rest
+static const deciamps_t FORECAST_MAX_MARGIN = 60;
+
+// a measure above the forecast by more than this is a miss
+static const deciamps_t FORECAST_MISS = 10;
+
+// unit of the power in the forecast, so it fits in 16 bits (VA)
+static const uint8_t FORECAST_POWER_UNIT = 10;
+
+// baselines: one per quarter of an hour, the usual peak of the house current in half amps, 0xFF when unknown
+static const uint8_t FORECAST_SLOT_MINUTES = 15;
+static const uint8_t FORECAST_SLOTS = 24 * 60 / FORECAST_SLOT_MINUTES;
+static const deciamps_t FORECAST_BASELINE_UNIT = 5;
+static const uint8_t FORECAST_BASELINE_UNKNOWN = 0xFF;
+// the baseline moves by 1/4 of the difference with the peak of the day
+static const int16_t FORECAST_BASELINE_DIVISOR = 4;
+
+// EEPROM address of the baselines, after the calibrations, with a version byte first
+static const int FORECAST_EEPROM_ADDRESS = 160;
+static const uint8_t FORECAST_VERSION = 1;
+
+static_assert(CALIBRATION_EEPROM_END <= FORECAST_EEPROM_ADDRESS, "the baselines overlap the calibrations");
+
+// smoothed value and the checks of its forecasts
+typedef struct forecast_series_t forecast_series_t;
+struct forecast_series_t {
+    // in 1/16
+    int32_t level;
+    int32_t trend;
+    // peak forecast and measure of the last frames, to check them at the horizon
+    int16_t forecasts[FORECAST_HORIZON];
+    int16_t values[FORECAST_HORIZON];
+    // next entry of the history, and the number of entries, up to the horizon
+    uint8_t index;
+    uint8_t frames;
+
+    // errors of the forecasts: measure - forecast, and of the persistence
+    uint16_t count;
+    int32_t error;
+    uint32_t absoluteError;
+    uint32_t persistenceError;
+    uint16_t misses;
+    uint16_t persistenceMisses;
+};
+
+class forecast {
+    public:
+        static void initialize();
+
+        // add the load of the house in a frame: the current in deciamps and the apparent power in VA
+        static void addFrame(const deciamps_t current, const uint32_t power);
+
+        // expected increase of the house current over the horizon, to keep free, up to FORECAST_MAX_MARGIN
+        static deciamps_t margin();
+        // peak of the house current (dA) and power (VA) expected over the horizon
+        static deciamps_t currentPeak();
+        static uint32_t powerPeak();
+
+        // time of the day in minutes, the clock then follows millis()
+        static void setTime(const uint16_t minutes);
+        static bool timeSet();
+
+        // log the errors of the forecasts since the last report, then restart them
+        static void report();
+
+    private:
+        static void add(forecast_series_t &series, const int16_t value, const int16_t baseline);
+        static int16_t peak(const forecast_series_t &series);
+        static void reportSeries(forecast_series_t &series, const char* name);
+
+        static void updateClock();
+        static uint8_t slot();
+        static int16_t baseline();
+        static void learn(const deciamps_t current);
+
+        static forecast_series_t current;
+        static forecast_series_t power;
+
+        // time of the day in minutes, and millis() at the start of the minute
+        static bool clockSet;
+        static uint16_t minutes;
+        static uint32_t minuteStart;
+
+        // slot being learned and the peak of the house current in it
+        static uint8_t learningSlot;
+        static deciamps_t slotPeak;
+};
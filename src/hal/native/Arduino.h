@@ -0,0 +1,90 @@
+#pragma once
+
+// Minimal Arduino API for the native (host) build
+// only C headers are included, as the Arduino core does
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define _BV(bit) (1 << (bit))
+
+// reset flags of the MCU status register, set by hal_native::reset()
+#define PORF 0
+#define EXTRF 1
+#define BORF 2
+#define WDRF 3
+extern uint8_t MCUSR;
+
+// no separate program memory on the host
+#define PROGMEM
+#define F(string) (string)
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define pgm_read_word(address) (*(const uint16_t*)(address))
+#define pgm_read_dword(address) (*(const uint32_t*)(address))
+#define strcmp_P(a, b) strcmp((a), (b))
+#define memcpy_P(a, b, n) memcpy((a), (b), (n))
+
+// called while waiting in delay(), as on the AVR core
+extern "C" void yield(void);
+
+// time, driven by the virtual clock of hal_native
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(unsigned int us);
+
+// pins, driven by the scriptable pins of hal_native
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+int analogRead(uint8_t pin);
+
+// fixed size replacement for the Arduino String, only used to format log messages
+static const uint8_t HAL_NATIVE_STRING_SIZE = 128;
+
+class String {
+    public:
+        String(const char* value = "");
+        String(char value);
+        String(unsigned char value);
+        String(int value);
+        String(unsigned int value);
+        String(long value);
+        String(unsigned long value);
+        String(float value, unsigned char decimals = 2);
+        String(double value, unsigned char decimals = 2);
+
+        const char* c_str() const;
+    private:
+        char buffer[HAL_NATIVE_STRING_SIZE];
+};
+
+// serial port, written to the standard output and read from hal_native::feedSerial()
+class HardwareSerial {
+    public:
+        void begin(unsigned long speed);
+        operator bool() const;
+
+        int available();
+        int read();
+
+        size_t write(uint8_t c);
+        int availableForWrite();
+        size_t print(const String &message);
+        size_t println(const String &message);
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Arduino.h>
+
+// EEPROM of the native build: kept in memory, across hal_native::reset() as on the board
+// erased bytes read 0xFF
+static const uint16_t HAL_NATIVE_EEPROM_SIZE = 1024;
+
+class EEPROMClass {
+    public:
+        EEPROMClass() {
+            memset(this->memory, 0xFF, sizeof(this->memory));
+        }
+
+        uint8_t read(int address) {
+            return address >= 0 && address < HAL_NATIVE_EEPROM_SIZE ? this->memory[address] : 0;
+        }
+        void write(int address, uint8_t value) {
+            if (address >= 0 && address < HAL_NATIVE_EEPROM_SIZE) {
+                this->memory[address] = value;
+            }
+        }
+        void update(int address, uint8_t value) {
+            this->write(address, value);
+        }
+        uint16_t length() {
+            return HAL_NATIVE_EEPROM_SIZE;
+        }
+
+        template <typename T>
+        T &get(int address, T &value) {
+            uint8_t* bytes = (uint8_t*)&value;
+            for (size_t i = 0; i < sizeof(T); i++) {
+                bytes[i] = this->read(address + i);
+            }
+            return value;
+        }
+        template <typename T>
+        const T &put(int address, const T &value) {
+            const uint8_t* bytes = (const uint8_t*)&value;
+            for (size_t i = 0; i < sizeof(T); i++) {
+                this->update(address + i, bytes[i]);
+            }
+            return value;
+        }
+
+    private:
+        uint8_t memory[HAL_NATIVE_EEPROM_SIZE];
+};
+
+extern EEPROMClass EEPROM;
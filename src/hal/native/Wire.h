@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Arduino.h>
+
+// I2C bus of the native build: transmissions are recorded by hal_native
+static const uint8_t HAL_NATIVE_WIRE_BUFFER_SIZE = 32;
+
+class TwoWire {
+    public:
+        void begin();
+        void setClock(uint32_t frequency);
+
+        void beginTransmission(uint8_t address);
+        size_t write(uint8_t value);
+        uint8_t endTransmission(bool stop = true);
+
+        uint8_t requestFrom(uint8_t address, uint8_t quantity);
+        int available();
+        int read();
+    private:
+        uint8_t address;
+        uint8_t buffer[HAL_NATIVE_WIRE_BUFFER_SIZE];
+        uint8_t length;
+        uint8_t index;
+};
+
+extern TwoWire Wire;
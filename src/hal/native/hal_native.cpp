@@ -0,0 +1,444 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <Wire.h>
+#include <avr/wdt.h>
+
+#include "hal_native.h"
+
+uint64_t hal_native::nowUs;
+uint32_t hal_native::delayStep = 1;
+void (*hal_native::advanceCallback)(const uint64_t nowUs);
+
+int hal_native::pins[HAL_NATIVE_PINS];
+uint8_t hal_native::pinModes[HAL_NATIVE_PINS];
+
+char hal_native::meter[HAL_NATIVE_METER_BUFFER_SIZE];
+size_t hal_native::meterHead;
+size_t hal_native::meterTail;
+
+uint8_t hal_native::dacs = 1;
+uint16_t hal_native::dac[HAL_NATIVE_DACS];
+uint16_t hal_native::eeprom[HAL_NATIVE_DACS];
+uint32_t hal_native::writes[HAL_NATIVE_DACS];
+uint8_t hal_native::i2cError;
+
+bool hal_native::quiet;
+int32_t hal_native::watchdogTimeout;
+uint64_t hal_native::watchdogReset;
+char hal_native::serial[HAL_NATIVE_SERIAL_BUFFER_SIZE];
+uint8_t hal_native::serialHead;
+uint8_t hal_native::serialTail;
+
+uint8_t MCUSR;
+HardwareSerial Serial;
+TwoWire Wire;
+EEPROMClass EEPROM;
+
+void hal_native::reset(const uint8_t flags) {
+    hal_native::nowUs = 0;
+    hal_native::delayStep = 1;
+    hal_native::advanceCallback = NULL;
+
+    // unconnected inputs with pull-up read high
+    for (uint8_t i = 0; i < HAL_NATIVE_PINS; i++) {
+        hal_native::pins[i] = HIGH;
+        hal_native::pinModes[i] = INPUT;
+    }
+
+    hal_native::meterHead = 0;
+    hal_native::meterTail = 0;
+    hal_native::serialHead = 0;
+    hal_native::serialTail = 0;
+
+    // the DACs power up with their EEPROM value, they keep their output on a reset of the MCU alone
+    if (flags & (_BV(PORF) | _BV(BORF))) {
+        memcpy(hal_native::dac, hal_native::eeprom, sizeof(hal_native::dac));
+    }
+
+    MCUSR = flags;
+
+    // the watchdog stays enabled after a watchdog reset
+    if (!(flags & _BV(WDRF))) {
+        hal_native::watchdogTimeout = -1;
+    }
+    hal_native::watchdogReset = 0;
+    memset(hal_native::writes, 0, sizeof(hal_native::writes));
+    hal_native::i2cError = 0;
+}
+
+uint64_t hal_native::now() {
+    return hal_native::nowUs;
+}
+
+void hal_native::advance(const uint32_t us) {
+    hal_native::nowUs += us;
+
+    if (hal_native::advanceCallback != NULL) {
+        hal_native::advanceCallback(hal_native::nowUs);
+    }
+}
+
+void hal_native::onAdvance(void (*callback)(const uint64_t nowUs)) {
+    hal_native::advanceCallback = callback;
+}
+
+void hal_native::setDelayStep(const uint32_t ms) {
+    hal_native::delayStep = ms > 0 ? ms : 1;
+}
+
+void hal_native::setPin(const uint8_t pin, const int level) {
+    if (pin < HAL_NATIVE_PINS) {
+        hal_native::pins[pin] = level;
+    }
+}
+
+void hal_native::setAnalog(const uint8_t pin, const int value) {
+    // analog inputs are addressed as A0 = 14 or as channel 0
+    hal_native::setPin(pin < 14 ? pin + 14 : pin, value);
+}
+
+uint8_t hal_native::getPinMode(const uint8_t pin) {
+    return pin < HAL_NATIVE_PINS ? hal_native::pinModes[pin] : INPUT;
+}
+
+bool hal_native::feedMeter(const char* bytes, const size_t length) {
+    // compact the buffer when the new bytes do not fit at the end
+    if (hal_native::meterHead + length > HAL_NATIVE_METER_BUFFER_SIZE) {
+        memmove(hal_native::meter, hal_native::meter + hal_native::meterTail, hal_native::meterHead - hal_native::meterTail);
+        hal_native::meterHead -= hal_native::meterTail;
+        hal_native::meterTail = 0;
+    }
+
+    if (hal_native::meterHead + length > HAL_NATIVE_METER_BUFFER_SIZE) {
+        return false;
+    }
+
+    memcpy(hal_native::meter + hal_native::meterHead, bytes, length);
+    hal_native::meterHead += length;
+    return true;
+}
+
+size_t hal_native::meterPending() {
+    return hal_native::meterHead - hal_native::meterTail;
+}
+
+int hal_native::readMeter() {
+    if (hal_native::meterTail == hal_native::meterHead) {
+        return -1;
+    }
+
+    return (uint8_t)hal_native::meter[hal_native::meterTail++];
+}
+
+void hal_native::setDacs(const uint8_t count) {
+    hal_native::dacs = count < HAL_NATIVE_DACS ? count : HAL_NATIVE_DACS;
+}
+
+uint16_t hal_native::dacValue(const uint8_t index) {
+    return hal_native::dac[index % HAL_NATIVE_DACS];
+}
+
+uint16_t hal_native::dacEeprom(const uint8_t index) {
+    return hal_native::eeprom[index % HAL_NATIVE_DACS];
+}
+
+uint32_t hal_native::dacWrites(const uint8_t index) {
+    return hal_native::writes[index % HAL_NATIVE_DACS];
+}
+
+void hal_native::setI2CError(const uint8_t error) {
+    hal_native::i2cError = error;
+}
+
+void hal_native::setQuiet(const bool quiet) {
+    hal_native::quiet = quiet;
+}
+
+bool hal_native::isQuiet() {
+    return hal_native::quiet;
+}
+
+bool hal_native::watchdogExpired() {
+    return hal_native::watchdogTimeout >= 0 && hal_native::nowUs - hal_native::watchdogReset > (uint64_t)hal_native::watchdogTimeout * 1000;
+}
+
+void wdt_enable(const uint8_t timeout) {
+    // 15 ms, doubled by each step
+    hal_native::watchdogTimeout = 15 << timeout;
+    hal_native::watchdogReset = hal_native::nowUs;
+}
+
+void wdt_disable() {
+    hal_native::watchdogTimeout = -1;
+}
+
+void wdt_reset() {
+    hal_native::watchdogReset = hal_native::nowUs;
+}
+
+bool hal_native::feedSerial(const char* bytes, const uint8_t length) {
+    // compact the buffer when the new bytes do not fit at the end
+    if (hal_native::serialHead + length > HAL_NATIVE_SERIAL_BUFFER_SIZE) {
+        memmove(hal_native::serial, hal_native::serial + hal_native::serialTail, hal_native::serialHead - hal_native::serialTail);
+        hal_native::serialHead -= hal_native::serialTail;
+        hal_native::serialTail = 0;
+    }
+
+    if (hal_native::serialHead + length > HAL_NATIVE_SERIAL_BUFFER_SIZE) {
+        return false;
+    }
+
+    memcpy(hal_native::serial + hal_native::serialHead, bytes, length);
+    hal_native::serialHead += length;
+    return true;
+}
+
+int hal_native::serialPending() {
+    return hal_native::serialHead - hal_native::serialTail;
+}
+
+int hal_native::readSerial() {
+    if (hal_native::serialTail == hal_native::serialHead) {
+        return -1;
+    }
+
+    return (uint8_t)hal_native::serial[hal_native::serialTail++];
+}
+
+uint8_t hal_native::i2cTransmit(const uint8_t address, const uint8_t* data, const uint8_t length) {
+    if (hal_native::i2cError != 0) {
+        return hal_native::i2cError;
+    }
+
+    // address not acknowledged
+    uint8_t index = address - HAL_NATIVE_DAC_ADDRESS;
+    if (address < HAL_NATIVE_DAC_ADDRESS || index >= hal_native::dacs) {
+        return 2;
+    }
+
+    uint8_t i = 0;
+    while (i < length) {
+        if ((data[i] & 0xC0) == 0x00 && i + 1 < length) {
+            // fast write: 2 bytes per value
+            hal_native::dac[index] = ((data[i] & 0x0F) << 8) | data[i + 1];
+            hal_native::writes[index]++;
+            i += 2;
+        } else if ((data[i] & 0xC0) == 0x40 && i + 2 < length) {
+            // write DAC register (0x40) or DAC register and EEPROM (0x60): 3 bytes
+            hal_native::dac[index] = (data[i + 1] << 4) | (data[i + 2] >> 4);
+            if ((data[i] & 0xE0) == 0x60) {
+                hal_native::eeprom[index] = hal_native::dac[index];
+            }
+            hal_native::writes[index]++;
+            i += 3;
+        } else {
+            // data not acknowledged
+            return 3;
+        }
+    }
+
+    return 0;
+}
+
+uint8_t hal_native::i2cReceive(const uint8_t address, uint8_t* data, const uint8_t length) {
+    uint8_t index = address - HAL_NATIVE_DAC_ADDRESS;
+    if (hal_native::i2cError != 0 || address < HAL_NATIVE_DAC_ADDRESS || index >= hal_native::dacs) {
+        return 0;
+    }
+
+    // MCP4725 read: status, DAC register, EEPROM
+    uint8_t answer[5] = {
+        0x80,
+        (uint8_t)(hal_native::dac[index] >> 4),
+        (uint8_t)((hal_native::dac[index] & 0x0F) << 4),
+        (uint8_t)(hal_native::eeprom[index] >> 8),
+        (uint8_t)(hal_native::eeprom[index] & 0xFF)
+    };
+
+    uint8_t count = length < sizeof(answer) ? length : sizeof(answer);
+    memcpy(data, answer, count);
+    return count;
+}
+
+int hal_native::readPin(const uint8_t pin) {
+    return pin < HAL_NATIVE_PINS ? hal_native::pins[pin] : LOW;
+}
+
+int hal_native::readAnalog(const uint8_t pin) {
+    return hal_native::readPin(pin < 14 ? pin + 14 : pin);
+}
+
+void hal_native::setPinMode(const uint8_t pin, const uint8_t mode) {
+    if (pin < HAL_NATIVE_PINS) {
+        hal_native::pinModes[pin] = mode;
+    }
+}
+
+// default yield, the firmware defines its own
+extern "C" __attribute__((weak)) void yield(void) {}
+
+uint32_t millis() {
+    return hal_native::now() / 1000;
+}
+
+uint32_t micros() {
+    return hal_native::now();
+}
+
+void delay(uint32_t ms) {
+    // advance step by step, letting the firmware and the models run in between
+    while (ms > 0) {
+        uint32_t step = ms < hal_native::delayStep ? ms : hal_native::delayStep;
+        hal_native::advance(step * 1000);
+        yield();
+        ms -= step;
+    }
+}
+
+void delayMicroseconds(unsigned int us) {
+    hal_native::advance(us);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    hal_native::setPinMode(pin, mode);
+}
+
+int digitalRead(uint8_t pin) {
+    return hal_native::readPin(pin);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    hal_native::setPin(pin, value);
+}
+
+int analogRead(uint8_t pin) {
+    return hal_native::readAnalog(pin);
+}
+
+String::String(const char* value) {
+    snprintf(this->buffer, HAL_NATIVE_STRING_SIZE, "%s", value);
+}
+
+String::String(char value) {
+    snprintf(this->buffer, HAL_NATIVE_STRING_SIZE, "%c", value);
+}
+
+String::String(unsigned char value) {
+    snprintf(this->buffer, HAL_NATIVE_STRING_SIZE, "%u", value);
+}
+
+String::String(int value) {
+    snprintf(this->buffer, HAL_NATIVE_STRING_SIZE, "%d", value);
+}
+
+String::String(unsigned int value) {
+    snprintf(this->buffer, HAL_NATIVE_STRING_SIZE, "%u", value);
+}
+
+String::String(long value) {
+    snprintf(this->buffer, HAL_NATIVE_STRING_SIZE, "%ld", value);
+}
+
+String::String(unsigned long value) {
+    snprintf(this->buffer, HAL_NATIVE_STRING_SIZE, "%lu", value);
+}
+
+String::String(float value, unsigned char decimals) {
+    snprintf(this->buffer, HAL_NATIVE_STRING_SIZE, "%.*f", decimals, value);
+}
+
+String::String(double value, unsigned char decimals) {
+    snprintf(this->buffer, HAL_NATIVE_STRING_SIZE, "%.*f", decimals, value);
+}
+
+const char* String::c_str() const {
+    return this->buffer;
+}
+
+void HardwareSerial::begin(unsigned long speed) {
+    (void)speed;
+}
+
+HardwareSerial::operator bool() const {
+    return true;
+}
+
+int HardwareSerial::available() {
+    return hal_native::serialPending();
+}
+
+int HardwareSerial::read() {
+    return hal_native::readSerial();
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    if (!hal_native::isQuiet()) {
+        fputc(c, stdout);
+    }
+    return 1;
+}
+
+int HardwareSerial::availableForWrite() {
+    // the host never blocks
+    return 64;
+}
+
+size_t HardwareSerial::print(const String &message) {
+    if (!hal_native::isQuiet()) {
+        fputs(message.c_str(), stdout);
+    }
+    return strlen(message.c_str());
+}
+
+size_t HardwareSerial::println(const String &message) {
+    size_t length = this->print(message);
+    this->write('\r');
+    this->write('\n');
+    return length + 2;
+}
+
+void TwoWire::begin() {
+    this->length = 0;
+    this->index = 0;
+}
+
+void TwoWire::setClock(uint32_t frequency) {
+    (void)frequency;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    this->address = address;
+    this->length = 0;
+}
+
+size_t TwoWire::write(uint8_t value) {
+    if (this->length >= HAL_NATIVE_WIRE_BUFFER_SIZE) {
+        return 0;
+    }
+
+    this->buffer[this->length++] = value;
+    return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool stop) {
+    (void)stop;
+    return hal_native::i2cTransmit(this->address, this->buffer, this->length);
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity) {
+    this->index = 0;
+    this->length = hal_native::i2cReceive(address, this->buffer, quantity < HAL_NATIVE_WIRE_BUFFER_SIZE ? quantity : HAL_NATIVE_WIRE_BUFFER_SIZE);
+    return this->length;
+}
+
+int TwoWire::available() {
+    return this->length - this->index;
+}
+
+int TwoWire::read() {
+    if (this->index >= this->length) {
+        return -1;
+    }
+
+    return this->buffer[this->index++];
+}
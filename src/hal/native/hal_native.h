@@ -0,0 +1,100 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Hardware abstraction for the native build
+// replaces the board with a virtual clock, an in-memory teleinfo byte source,
+// a DAC recording the I2C writes and scriptable input pins
+
+// number of digital and analog pins of the Uno (analog pins are 14 to 19)
+static const uint8_t HAL_NATIVE_PINS = 20;
+
+// size of the in-memory teleinfo byte source
+static const uint16_t HAL_NATIVE_METER_BUFFER_SIZE = 4096;
+
+// size of the in-memory serial input
+static const uint8_t HAL_NATIVE_SERIAL_BUFFER_SIZE = 64;
+
+// I2C address answered by the first recording DAC, the next ones follow
+static const uint8_t HAL_NATIVE_DAC_ADDRESS = 0b1100000;
+static const uint8_t HAL_NATIVE_DACS = 8;
+
+class hal_native {
+    public:
+        // reset the board, with the reset flags of the cause (MCUSR)
+        // the DAC and the RAM of the firmware are only lost on a power-on or a brown-out
+        static void reset(const uint8_t flags = _BV(PORF));
+
+        // virtual clock
+        static uint64_t now();
+        static void advance(const uint32_t us);
+        // the callback is called each time the clock advances, to run the models of the environment
+        static void onAdvance(void (*callback)(const uint64_t nowUs));
+        // granularity of delay() in ms: yield() and the callback are called once per step
+        static void setDelayStep(const uint32_t ms);
+
+        // scriptable input pins
+        static void setPin(const uint8_t pin, const int level);
+        static void setAnalog(const uint8_t pin, const int value);
+        static uint8_t getPinMode(const uint8_t pin);
+
+        // in-memory teleinfo byte source, read by the tic_receiver
+        static bool feedMeter(const char* bytes, const size_t length);
+        static size_t meterPending();
+        static int readMeter();
+
+        // recording DACs, only the first one answers unless more are connected
+        static void setDacs(const uint8_t count);
+        static uint16_t dacValue(const uint8_t index = 0);
+        static uint16_t dacEeprom(const uint8_t index = 0);
+        static uint32_t dacWrites(const uint8_t index = 0);
+        // make the next I2C transmissions fail with the given error code (0 to succeed again)
+        static void setI2CError(const uint8_t error);
+
+        // watchdog: true if it was not reset within its timeout
+        static bool watchdogExpired();
+
+        // serial output, written to stdout unless quiet
+        static void setQuiet(const bool quiet);
+        // serial input, read by Serial.read()
+        static bool feedSerial(const char* bytes, const uint8_t length);
+
+        // called by the Arduino shims
+        static uint8_t i2cTransmit(const uint8_t address, const uint8_t* data, const uint8_t length);
+        static uint8_t i2cReceive(const uint8_t address, uint8_t* data, const uint8_t length);
+        static int readPin(const uint8_t pin);
+        static int readAnalog(const uint8_t pin);
+        static void setPinMode(const uint8_t pin, const uint8_t mode);
+        static bool isQuiet();
+        static int serialPending();
+        static int readSerial();
+    private:
+        static uint64_t nowUs;
+        static uint32_t delayStep;
+        static void (*advanceCallback)(const uint64_t nowUs);
+
+        static int pins[HAL_NATIVE_PINS];
+        static uint8_t pinModes[HAL_NATIVE_PINS];
+
+        static char meter[HAL_NATIVE_METER_BUFFER_SIZE];
+        static size_t meterHead;
+        static size_t meterTail;
+
+        static uint8_t dacs;
+        static uint16_t dac[HAL_NATIVE_DACS];
+        static uint16_t eeprom[HAL_NATIVE_DACS];
+        static uint32_t writes[HAL_NATIVE_DACS];
+        static uint8_t i2cError;
+
+        static bool quiet;
+        static int32_t watchdogTimeout;
+        static uint64_t watchdogReset;
+        static char serial[HAL_NATIVE_SERIAL_BUFFER_SIZE];
+        static uint8_t serialHead;
+        static uint8_t serialTail;
+
+        friend void delay(uint32_t ms);
+        friend void wdt_enable(const uint8_t timeout);
+        friend void wdt_disable();
+        friend void wdt_reset();
+};
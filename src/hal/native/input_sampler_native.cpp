@@ -0,0 +1,48 @@
+#include <Arduino.h>
+
+#include "input_sampler/input_sampler.h"
+
+#include "hal_native.h"
+
+// Native replacement of the interrupt driven sampler:
+// the levels are read from the pins of hal_native when asked, without bounces to filter
+
+// levels returned by the last call to takeChanges()
+static uint32_t inputSamplerLast;
+
+void input_sampler::begin() {
+    inputSamplerLast = input_sampler::levels();
+}
+
+uint32_t input_sampler::levels() {
+    uint32_t levels = 0;
+    for (uint8_t pin = 0; pin < 20; pin++) {
+        if (hal_native::readPin(pin) != LOW) {
+            levels |= (uint32_t)1 << pin;
+        }
+    }
+
+    return levels;
+}
+
+uint32_t input_sampler::takeChanges() {
+    uint32_t levels = input_sampler::levels();
+    uint32_t changes = levels ^ inputSamplerLast;
+    inputSamplerLast = levels;
+
+    return changes;
+}
+
+uint16_t input_sampler::analog(const uint8_t channel) {
+    if (channel >= INPUT_SAMPLER_ANALOG_CHANNELS) {
+        return 0;
+    }
+
+    return hal_native::readAnalog(channel);
+}
+
+void input_sampler::onTimer() {
+}
+
+void input_sampler::onConversion() {
+}
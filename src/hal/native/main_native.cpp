@@ -0,0 +1,63 @@
+#include <Arduino.h>
+
+#include "hal_native.h"
+
+// the unit tests have their own main()
+#ifndef PIO_UNIT_TESTING
+
+// firmware entry points, defined in main.cpp
+void setup();
+void loop();
+
+// speed of the teleinfo replayed from a capture file (historic mode: 1200 bauds, 10 bits per byte)
+static const uint32_t MAIN_NATIVE_METER_US_PER_BYTE = 8333;
+
+// duration of one call to loop() on the virtual board, loop() does not wait anymore
+static const uint32_t MAIN_NATIVE_LOOP_US = 1000;
+
+static FILE* capture;
+static uint64_t nextMeterByte;
+
+// feed the capture to the meter byte source at the speed of the teleinfo
+static void replayCapture(const uint64_t nowUs) {
+    while (capture != NULL && nextMeterByte <= nowUs) {
+        int c = fgetc(capture);
+        if (c == EOF) {
+            fclose(capture);
+            capture = NULL;
+            return;
+        }
+
+        char byte = c;
+        hal_native::feedMeter(&byte, 1);
+        nextMeterByte += MAIN_NATIVE_METER_US_PER_BYTE;
+    }
+}
+
+// Run the firmware on the virtual board
+// usage: program [number of loops] [teleinfo capture file]
+// each loop lasts MAIN_NATIVE_LOOP_US of virtual time
+int main(int argc, char** argv) {
+    long loops = argc > 1 ? atol(argv[1]) : 10;
+
+    hal_native::reset();
+
+    if (argc > 2) {
+        capture = fopen(argv[2], "rb");
+        if (capture == NULL) {
+            fprintf(stderr, "cannot open capture %s\n", argv[2]);
+            return 1;
+        }
+        hal_native::onAdvance(replayCapture);
+    }
+
+    setup();
+    for (long i = 0; i < loops; i++) {
+        loop();
+        hal_native::advance(MAIN_NATIVE_LOOP_US);
+    }
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,33 @@
+#include <Arduino.h>
+
+#include "tic_receiver/tic_receiver.h"
+
+#include "hal_native.h"
+
+// Native replacement of the interrupt driven receiver:
+// the bytes come from the in-memory byte source of hal_native, without errors
+
+void tic_receiver::begin(const uint32_t speed) {
+    (void)speed;
+}
+
+uint8_t tic_receiver::available() {
+    size_t pending = hal_native::meterPending();
+    return pending > 0xFF ? 0xFF : pending;
+}
+
+int tic_receiver::read() {
+    return hal_native::readMeter();
+}
+
+uint16_t tic_receiver::overruns() {
+    return 0;
+}
+
+uint16_t tic_receiver::parityErrors() {
+    return 0;
+}
+
+uint16_t tic_receiver::framingErrors() {
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <Arduino.h>
+
+#include "input_sampler.h"
+
+static_assert(INPUT_SAMPLER_OVERSAMPLING * 1023UL <= 0xFFFF, "the sum of the samples must fit on 16 bits");
+
+uint32_t input_sampler::counter0;
+uint32_t input_sampler::counter1;
+volatile uint32_t input_sampler::debounced;
+volatile uint32_t input_sampler::changes;
+
+uint8_t input_sampler::channel;
+uint8_t input_sampler::samples;
+uint16_t input_sampler::sum;
+volatile uint16_t input_sampler::values[INPUT_SAMPLER_ANALOG_CHANNELS];
+
+void input_sampler::begin() {
+    uint8_t oldSREG = SREG;
+    cli();
+
+    input_sampler::debounced = input_sampler::readPins();
+    input_sampler::changes = 0;
+    input_sampler::counter0 = 0;
+    input_sampler::counter1 = 0;
+
+    // ADC on the AVcc reference, as analogRead(), at 125 kHz: a conversion takes 104us
+    input_sampler::channel = 0;
+    input_sampler::samples = 0;
+    input_sampler::sum = 0;
+    ADMUX = _BV(REFS0);
+    ADCSRA = _BV(ADEN) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+
+    // timer 1 in CTC mode, prescaler 8: one compare match per period
+    TCCR1A = 0;
+    TCCR1B = _BV(WGM12) | _BV(CS11);
+    OCR1A = F_CPU / 8 / 1000000 * INPUT_SAMPLER_PERIOD_US - 1;
+    TCNT1 = 0;
+    TIFR1 = _BV(OCF1A);
+    TIMSK1 = _BV(OCIE1A);
+
+    SREG = oldSREG;
+}
+
+uint32_t input_sampler::levels() {
+    // 32 bits are not read atomically, the interrupts could update the levels in between
+    uint8_t oldSREG = SREG;
+    cli();
+    uint32_t levels = input_sampler::debounced;
+    SREG = oldSREG;
+
+    return levels;
+}
+
+uint32_t input_sampler::takeChanges() {
+    uint8_t oldSREG = SREG;
+    cli();
+    uint32_t changes = input_sampler::changes;
+    input_sampler::changes = 0;
+    SREG = oldSREG;
+
+    return changes;
+}
+
+uint16_t input_sampler::analog(const uint8_t channel) {
+    if (channel >= INPUT_SAMPLER_ANALOG_CHANNELS) {
+        return 0;
+    }
+
+    uint8_t oldSREG = SREG;
+    cli();
+    uint16_t value = input_sampler::values[channel];
+    SREG = oldSREG;
+
+    return value;
+}
+
+uint32_t input_sampler::readPins() {
+    // pins 0 to 7 are PD0-7, pins 8 to 13 are PB0-5, pins 14 to 19 (A0-A5) are PC0-5
+    return (uint32_t)PIND | (uint32_t)(PINB & 0x3F) << 8 | (uint32_t)(PINC & 0x3F) << 14;
+}
+
+void input_sampler::onTimer() {
+    // 2 bits counters for all the pins at once, counting the samples that differ from the debounced level
+    uint32_t debounced = input_sampler::debounced;
+    uint32_t delta = input_sampler::readPins() ^ debounced;
+    input_sampler::counter1 = (input_sampler::counter1 ^ input_sampler::counter0) & delta;
+    input_sampler::counter0 = ~input_sampler::counter0 & delta;
+
+    // the counters wrapped to 0 with the pin still different: 4 samples in a row
+    uint32_t toggled = delta & ~(input_sampler::counter0 | input_sampler::counter1);
+    if (toggled) {
+        input_sampler::debounced = debounced ^ toggled;
+        input_sampler::changes |= toggled;
+    }
+
+    // next sample of the analog channel, unless the last conversion is still running
+    if (!(ADCSRA & _BV(ADSC))) {
+        ADCSRA |= _BV(ADSC);
+    }
+}
+
+void input_sampler::onConversion() {
+    input_sampler::sum += ADC;
+
+    if (++input_sampler::samples < INPUT_SAMPLER_OVERSAMPLING) {
+        return;
+    }
+
+    input_sampler::values[input_sampler::channel] = input_sampler::sum / INPUT_SAMPLER_OVERSAMPLING;
+    input_sampler::samples = 0;
+    input_sampler::sum = 0;
+
+    // the next channel is set before the next conversion is started
+    input_sampler::channel = (input_sampler::channel + 1) % INPUT_SAMPLER_ANALOG_CHANNELS;
+    ADMUX = _BV(REFS0) | input_sampler::channel;
+}
+
+ISR(TIMER1_COMPA_vect) {
+    input_sampler::onTimer();
+}
+
+ISR(ADC_vect) {
+    input_sampler::onConversion();
+}
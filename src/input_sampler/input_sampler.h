@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Interrupt driven sampling of the inputs
+// the compare match interrupt of timer 1 snapshots every digital pin at once with direct port reads,
+// debounces them, and starts a conversion of the ADC, whose interrupt oversamples the analog inputs
+// the main program only reads the results, so reading an input costs neither a pin lookup nor a conversion
+
+// period of the samples in us: the levels are debounced over 4 samples (20ms)
+static const uint16_t INPUT_SAMPLER_PERIOD_US = 5000;
+
+// analog inputs sampled (A0 and A1), and number of samples averaged per value
+static const uint8_t INPUT_SAMPLER_ANALOG_CHANNELS = 2;
+static const uint8_t INPUT_SAMPLER_OVERSAMPLING = 16;
+
+class input_sampler {
+    public:
+        // start sampling, the pins must be set up before: the current levels are taken as debounced
+        static void begin();
+
+        // debounced levels of the digital pins: bit n for pin n (0 to 19, A0 = 14)
+        static uint32_t levels();
+
+        // pins whose debounced level changed since the last call
+        static uint32_t takeChanges();
+
+        // mean of the last samples of an analog channel (0 to 1023), 0 for a channel that is not sampled
+        static uint16_t analog(const uint8_t channel);
+
+        // called from the interrupts
+        static void onTimer();
+        static void onConversion();
+    private:
+        static uint32_t readPins();
+
+        // vertical counters of the debounce: a level changes after 4 samples in a row differ from it
+        static uint32_t counter0;
+        static uint32_t counter1;
+        static volatile uint32_t debounced;
+        static volatile uint32_t changes;
+
+        static uint8_t channel;
+        static uint8_t samples;
+        static uint16_t sum;
+        static volatile uint16_t values[INPUT_SAMPLER_ANALOG_CHANNELS];
+};
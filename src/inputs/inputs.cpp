@@ -2,12 +2,22 @@
 
 #include "inputs.h"
 
+#include "input_sampler/input_sampler.h"
+#include "viridian/viridian.h"
+
+static_assert(VIRIDIAN_CHARGERS <= sizeof(INPUTS_CHARGING_CAR_PINS), "one charging signal per charger");
+
 void inputs::initialize() {
     // set pins 2 to 8 in INPUT PULLUP mode
     for (uint8_t i = 2; i < 8; i++) {
         pinMode(i, INPUT_PULLUP);
     }
 
+    // and the charging signals of the other chargers
+    for (uint8_t i = 1; i < VIRIDIAN_CHARGERS; i++) {
+        pinMode(INPUTS_CHARGING_CAR_PINS[i], INPUT_PULLUP);
+    }
+
     // set digital/analog pins to INPUT
     pinMode(16, INPUT_PULLUP);
     pinMode(17, INPUT_PULLUP);
@@ -15,14 +25,26 @@ void inputs::initialize() {
     // set analog pins to INPUT
     pinMode(14, INPUT);
     pinMode(15, INPUT);
+
+    // then sample them all in the background
+    input_sampler::begin();
 }
 
 bool inputs::readOption(uint8_t pin) {
-    // return digitalread, but inverse because of PULLUP mode
-    return digitalRead(pin)==LOW;
+    // return the debounced level, but inverse because of PULLUP mode
+    return (input_sampler::levels() & ((uint32_t)1 << pin)) == 0;
 }
 
 int inputs::readVariable(uint8_t pin) {
-    // return the value for the selected pin
-    return analogRead(pin);
+    // return the last oversampled value for the selected pin, given as a channel or as a pin like analogRead()
+    return input_sampler::analog(pin < INPUTS_VARIABLE_FIRST_PIN ? pin : pin - INPUTS_VARIABLE_FIRST_PIN);
+}
+
+bool inputs::chargingChanged() {
+    uint32_t mask = 0;
+    for (uint8_t i = 0; i < VIRIDIAN_CHARGERS; i++) {
+        mask |= (uint32_t)1 << INPUTS_CHARGING_CAR_PINS[i];
+    }
+
+    return (input_sampler::takeChanges() & mask) != 0;
 }
\ No newline at end of file
@@ -9,12 +9,25 @@ static const uint8_t INPUTS_OPTION_GREATER_ISOUSC = 7;
 static const uint8_t INPUTS_OPTION_MARGIN_ADD_1A = 8;
 // pin 7 is the signal when the car is charging
 static const uint8_t INPUTS_OPTION_CHARGING_CAR = 6;
+// pin 6 is to use the PI controller instead of the charge cycle policy
+static const uint8_t INPUTS_OPTION_PI_CONTROLLER = 5;
+// pins 4 and 5 are the phase of the charger on three-phase installations (bits 0 and 1, none to detect it)
+static const uint8_t INPUTS_OPTION_CHARGER_PHASE_1 = 3;
+static const uint8_t INPUTS_OPTION_CHARGER_PHASE_2 = 4;
+// signal when the car is charging of each charger, in the order of their DAC addresses
+// the first charger uses the charging car option, the next ones the free pins, only the first VIRIDIAN_CHARGERS are used
+static const uint8_t INPUTS_CHARGING_CAR_PINS[] = { INPUTS_OPTION_CHARGING_CAR, 2, 10, 11, 12, 13, 16, 17 };
 
 // Association between variables and pins
+// A0 and A1 are sampled in the background, see input_sampler
+static const uint8_t INPUTS_VARIABLE_FIRST_PIN = 14;
 
 class inputs {
     public:
         static void initialize();
         static bool readOption(uint8_t pin);
         static int readVariable(uint8_t pin);
+
+        // the charging signal of a charger changed since the last call (debounced)
+        static bool chargingChanged();
 };
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include <Arduino.h>
+
+#include "profiler/profiler.h"
+
+#include "logger.h"
+
+ring_buffer<uint8_t, LOGGER_BUFFER_SIZE> logger::buffer;
+uint16_t logger::dropped;
+#if LOGGER_TELEMETRY
+uint8_t logger::frame[LOGGER_FRAME_MAX_SIZE];
+uint8_t logger::frameLength;
+#endif
+
+void logger::initialize() {
+    // Open Serial
+    Serial.begin(LOGGER_SERIAL_SPEED);
+    // Wait for serial to be ready
+    while (!Serial) ;
+}
+
+void logger::flush() {
+    PROFILE(LOGGER);
+    uint8_t value;
+
+    // only fill the free space of the UART buffer, never wait for it
+    int space = Serial.availableForWrite();
+    while (space > 0 && logger::buffer.pop(value)) {
+        Serial.write(value);
+        space--;
+    }
+}
+
+uint8_t logger::space() {
+    return logger::buffer.space();
+}
+
+#if LOGGER_TELEMETRY
+void logger::writeRecord(const uint8_t type, const void* data, const uint8_t length) {
+    if (!logger::reserve(LOGGER_MESSAGE_OVERHEAD + 1 + length)) {
+        return;
+    }
+
+    logger::begin(type);
+    for (uint8_t i = 0; i < length; i++) {
+        logger::putByte(((const uint8_t*)data)[i]);
+    }
+    logger::end();
+}
+#endif
+
+bool logger::reserve(const uint8_t length) {
+#if LOGGER_TELEMETRY
+    // the frame must fit with its CRC, without the COBS code and the delimiter
+    if (length - 2 > LOGGER_FRAME_MAX_SIZE) {
+        logger::dropped++;
+        return false;
+    }
+#endif
+
+    if (logger::dropped > 0) {
+        // the dropped messages are reported as soon as there is room for it (id and a 16 bits count)
+        if (logger::buffer.space() < LOGGER_MESSAGE_OVERHEAD + 4 + length) {
+            logger::dropped++;
+            return false;
+        }
+
+        uint16_t dropped = logger::dropped;
+        logger::dropped = 0;
+        logger::write(LOGGER_DROPPED, dropped);
+        return true;
+    }
+
+    if (logger::buffer.space() < length) {
+        logger::dropped++;
+        return false;
+    }
+
+    return true;
+}
+
+void logger::begin(const uint8_t id) {
+#if LOGGER_TELEMETRY
+    logger::frameLength = 0;
+#else
+    logger::buffer.push(LOGGER_SYNC);
+#endif
+    logger::putByte(id);
+}
+
+void logger::end() {
+#if LOGGER_TELEMETRY
+    uint16_t crc = LOGGER_CRC_INIT;
+    for (uint8_t i = 0; i < logger::frameLength; i++) {
+        crc = logger::crc16(crc, logger::frame[i]);
+    }
+    logger::frame[logger::frameLength++] = crc & 0xFF;
+    logger::frame[logger::frameLength++] = crc >> 8;
+
+    // COBS: each 0 is replaced by the distance to the next one, starting with a code byte
+    uint8_t start = 0;
+    while (true) {
+        uint8_t end = start;
+        while (end < logger::frameLength && logger::frame[end] != 0) {
+            end++;
+        }
+
+        logger::buffer.push(end - start + 1);
+        for (uint8_t i = start; i < end; i++) {
+            logger::buffer.push(logger::frame[i]);
+        }
+
+        if (end >= logger::frameLength) {
+            break;
+        }
+        start = end + 1;
+    }
+
+    logger::buffer.push(LOGGER_FRAME_DELIMITER);
+#endif
+}
+
+void logger::putByte(const uint8_t value) {
+#if LOGGER_TELEMETRY
+    logger::frame[logger::frameLength++] = value;
+#else
+    logger::buffer.push(value);
+#endif
+}
+
+uint8_t logger::length(const char* value) {
+    uint8_t length = strnlen(value, LOGGER_STRING_MAX_LENGTH);
+
+    return 2 + length;
+}
+
+void logger::put(const double value) {
+    // always sent as a 32 bits float, the size of a double on the AVR
+    float single = value;
+    uint8_t bytes[4];
+
+    memcpy(bytes, &single, sizeof(bytes));
+
+    logger::putByte(LOGGER_TYPE_FLOAT | sizeof(bytes));
+    for (uint8_t i = 0; i < sizeof(bytes); i++) {
+        logger::putByte(bytes[i]);
+    }
+}
+
+void logger::put(const char* value) {
+    uint8_t length = strnlen(value, LOGGER_STRING_MAX_LENGTH);
+
+    logger::putByte(LOGGER_TYPE_STRING);
+    logger::putByte(length);
+    for (uint8_t i = 0; i < length; i++) {
+        logger::putByte(value[i]);
+    }
+}
+
+void logger::putInteger(const uint8_t type, uint32_t value) {
+    logger::putByte(type);
+
+    // little endian, only the size given by the type
+    for (uint8_t i = 0; i < (type & LOGGER_SIZE_MASK); i++) {
+        logger::putByte(value & 0xFF);
+        value >>= 8;
+    }
+}
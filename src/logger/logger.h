@@ -0,0 +1,204 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "logger_messages.h"
+#include "ring_buffer/ring_buffer.h"
+
+// Tokenized logger
+// a message is its id (see logger_messages.h) followed by its typed arguments, in binary
+// it is queued in a ring buffer and sent by flush() only as much as the UART can take without blocking
+// tools/log_decoder turns the stream back into text
+//
+// in telemetry mode, selected at compile time with -D LOGGER_TELEMETRY=1, the messages and the
+// telemetry records (see telemetry/telemetry.h) are sent as frames instead: the message or record,
+// its CRC-16 (CCITT, little endian), COBS encoded and followed by a 0 delimiter
+// tools/telemetry_decoder decodes this stream
+
+#ifndef LOGGER_TELEMETRY
+#define LOGGER_TELEMETRY 0
+#endif
+
+// speed of the serial port in telemetry mode, can be changed with -D LOGGER_TELEMETRY_SPEED=...
+#ifndef LOGGER_TELEMETRY_SPEED
+#define LOGGER_TELEMETRY_SPEED 115200
+#endif
+
+#if LOGGER_TELEMETRY
+static const long LOGGER_SERIAL_SPEED = LOGGER_TELEMETRY_SPEED;
+#else
+// Standard Serial Speed
+static const long LOGGER_SERIAL_SPEED = 9600;
+#endif
+
+// size of the queue of pending bytes, messages that do not fit are dropped and counted
+static const uint8_t LOGGER_BUFFER_SIZE = 128;
+
+// first byte of each message, for the decoder to find the start of a message
+static const uint8_t LOGGER_SYNC = 0xA5;
+
+// end of a frame in telemetry mode, the only 0 of the stream
+static const uint8_t LOGGER_FRAME_DELIMITER = 0x00;
+
+// initial value of the CRC of a frame
+static const uint16_t LOGGER_CRC_INIT = 0xFFFF;
+
+// maximum size of a message or record with its CRC in telemetry mode, the larger ones are dropped
+// a frame is a single COBS block as long as it is smaller than 254 bytes
+static const uint8_t LOGGER_FRAME_MAX_SIZE = 64;
+
+// bytes added to the id and arguments of a message: sync byte, or CRC, COBS code and delimiter
+#if LOGGER_TELEMETRY
+static const uint8_t LOGGER_MESSAGE_OVERHEAD = 4;
+#else
+static const uint8_t LOGGER_MESSAGE_OVERHEAD = 1;
+#endif
+
+// strings arguments are truncated to this length
+static const uint8_t LOGGER_STRING_MAX_LENGTH = 16;
+
+// type of the arguments, sent before their value (little endian)
+// the low bits are the size of the value in bytes
+static const uint8_t LOGGER_TYPE_UNSIGNED = 0x00;
+static const uint8_t LOGGER_TYPE_SIGNED = 0x10;
+static const uint8_t LOGGER_TYPE_FLOAT = 0x20;
+static const uint8_t LOGGER_TYPE_CHAR = 0x30;
+// followed by the length and the chars
+static const uint8_t LOGGER_TYPE_STRING = 0x40;
+static const uint8_t LOGGER_TYPE_MASK = 0xF0;
+static const uint8_t LOGGER_SIZE_MASK = 0x0F;
+
+// levels, selected at compile time with -D LOGGER_LEVEL=...
+// the calls of a disabled level are removed, with their arguments
+#define LOGGER_LEVEL_NONE 0
+#define LOGGER_LEVEL_ERROR 1
+#define LOGGER_LEVEL_WARNING 2
+#define LOGGER_LEVEL_INFO 3
+#define LOGGER_LEVEL_DEBUG 4
+
+#ifndef LOGGER_LEVEL
+#define LOGGER_LEVEL LOGGER_LEVEL_INFO
+#endif
+
+#if LOGGER_LEVEL >= LOGGER_LEVEL_ERROR
+#define LOG_ERROR(id, ...) logger::write(LOGGER_##id, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(id, ...) do {} while (0)
+#endif
+
+#if LOGGER_LEVEL >= LOGGER_LEVEL_WARNING
+#define LOG_WARNING(id, ...) logger::write(LOGGER_##id, ##__VA_ARGS__)
+#else
+#define LOG_WARNING(id, ...) do {} while (0)
+#endif
+
+#if LOGGER_LEVEL >= LOGGER_LEVEL_INFO
+#define LOG_INFO(id, ...) logger::write(LOGGER_##id, ##__VA_ARGS__)
+#else
+#define LOG_INFO(id, ...) do {} while (0)
+#endif
+
+#if LOGGER_LEVEL >= LOGGER_LEVEL_DEBUG
+#define LOG_DEBUG(id, ...) logger::write(LOGGER_##id, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(id, ...) do {} while (0)
+#endif
+
+class logger {
+    public:
+        static void initialize();
+
+        // send the pending bytes the UART can take without blocking
+        static void flush();
+        // free bytes in the buffer, to pace long outputs
+        static uint8_t space();
+
+        // queue a message, the whole message or nothing
+        template <typename... Args>
+        static void write(const logger_message_t id, const Args... args) {
+            uint8_t length = LOGGER_MESSAGE_OVERHEAD + 1 + logger::argumentsLength(args...);
+
+            if (!logger::reserve(length)) {
+                return;
+            }
+
+            logger::begin(id);
+            logger::putArguments(args...);
+            logger::end();
+        }
+
+#if LOGGER_TELEMETRY
+        // queue a telemetry record: its type followed by its fixed layout data
+        static void writeRecord(const uint8_t type, const void* data, const uint8_t length);
+#endif
+
+        // CRC-16 CCITT (polynomial 0x1021) of the frames, also used by the decoder
+        static uint16_t crc16(uint16_t crc, const uint8_t value) {
+            crc ^= (uint16_t)value << 8;
+            for (uint8_t i = 0; i < 8; i++) {
+                crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+            }
+            return crc;
+        }
+
+    private:
+        // make room for a message, queuing the count of dropped messages first if needed
+        static bool reserve(const uint8_t length);
+
+        // start and end a message or record: the sync byte, or the frame
+        static void begin(const uint8_t id);
+        static void end();
+        static void putByte(const uint8_t value);
+
+        static uint8_t argumentsLength() { return 0; }
+        template <typename T, typename... Args>
+        static uint8_t argumentsLength(const T value, const Args... args) {
+            return logger::length(value) + logger::argumentsLength(args...);
+        }
+
+        static void putArguments() {}
+        template <typename T, typename... Args>
+        static void putArguments(const T value, const Args... args) {
+            logger::put(value);
+            logger::putArguments(args...);
+        }
+
+        // encoded length of each type
+        static uint8_t length(const bool value) { (void)value; return 2; }
+        static uint8_t length(const char value) { (void)value; return 2; }
+        static uint8_t length(const signed char value) { (void)value; return 2; }
+        static uint8_t length(const unsigned char value) { (void)value; return 2; }
+        static uint8_t length(const short value) { (void)value; return 1 + sizeof(short); }
+        static uint8_t length(const unsigned short value) { (void)value; return 1 + sizeof(short); }
+        static uint8_t length(const int value) { (void)value; return 1 + sizeof(int); }
+        static uint8_t length(const unsigned int value) { (void)value; return 1 + sizeof(int); }
+        static uint8_t length(const long value) { (void)value; return 5; }
+        static uint8_t length(const unsigned long value) { (void)value; return 5; }
+        static uint8_t length(const float value) { (void)value; return 5; }
+        static uint8_t length(const double value) { (void)value; return 5; }
+        static uint8_t length(const char* value);
+
+        static void put(const bool value) { logger::putInteger(LOGGER_TYPE_UNSIGNED | 1, value); }
+        static void put(const char value) { logger::putInteger(LOGGER_TYPE_CHAR | 1, value); }
+        static void put(const signed char value) { logger::putInteger(LOGGER_TYPE_SIGNED | 1, value); }
+        static void put(const unsigned char value) { logger::putInteger(LOGGER_TYPE_UNSIGNED | 1, value); }
+        static void put(const short value) { logger::putInteger(LOGGER_TYPE_SIGNED | sizeof(short), value); }
+        static void put(const unsigned short value) { logger::putInteger(LOGGER_TYPE_UNSIGNED | sizeof(short), value); }
+        static void put(const int value) { logger::putInteger(LOGGER_TYPE_SIGNED | sizeof(int), value); }
+        static void put(const unsigned int value) { logger::putInteger(LOGGER_TYPE_UNSIGNED | sizeof(int), value); }
+        // long are sent on 32 bits, even on a 64 bits host
+        static void put(const long value) { logger::putInteger(LOGGER_TYPE_SIGNED | 4, value); }
+        static void put(const unsigned long value) { logger::putInteger(LOGGER_TYPE_UNSIGNED | 4, value); }
+        static void put(const double value);
+        static void put(const char* value);
+
+        static void putInteger(const uint8_t type, uint32_t value);
+
+        static ring_buffer<uint8_t, LOGGER_BUFFER_SIZE> buffer;
+        static uint16_t dropped;
+#if LOGGER_TELEMETRY
+        // the frame is built here, COBS needs the position of the next 0 before sending a byte
+        static uint8_t frame[LOGGER_FRAME_MAX_SIZE];
+        static uint8_t frameLength;
+#endif
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+// Messages of the logger
+// only the id of a message and its arguments are sent, the text stays on the host:
+// the log decoder (tools/log_decoder) includes this file to turn the stream back into text
+// each {} is replaced by the next argument
+// new messages are added at the end, so old logs can still be decoded
+// the text of a message is never changed: a message with other arguments or units gets a new id
+#define LOGGER_MESSAGES(X) \
+    X(DROPPED, "logger: {} messages dropped, the log buffer was full") \
+    X(MAIN_STARTING, "main: Arduino starting") \
+    X(MAIN_INITIALIZED, "main: Initialization finished. Waiting before starting...") \
+    X(MAIN_SETUP_FINISHED, "main: Setup finished") \
+    X(MAIN_NO_CAR, "main: No car is charging") \
+    X(MAIN_CAR_STARTED, "main: Car just started charging, waiting for charge to start") \
+    X(MAIN_FIRST_CHARGE, "main: Now adapting charge current for first charge") \
+    X(MAIN_AVAILABLE_CURRENT, "main: available current is now {} Amps") \
+    X(MAIN_CHANGE_TOO_SMALL, "main: Change of charging current is less than one amp. Not changing.") \
+    X(MAIN_CHANGE_NOT_IMPORTANT, "main: Change of charging current is not important enough (already charging at {} Amps)") \
+    X(MAIN_ADPS, "main: ADPS received, adapting charge current") \
+    X(MAIN_CHARGE_CYCLE, "main: Nominal timer activation") \
+    X(MAIN_TELEINFO_LOST, "main: no recent teleinfo frame, teleinfo most likely failed to read data, current will not be adapted") \
+    X(TELEINFO_LISTENING_HISTORIC, "teleinfo: listening for historic mode") \
+    X(TELEINFO_LISTENING_STANDARD, "teleinfo: listening for standard mode") \
+    X(TELEINFO_FRAME_INTERRUPTED, "teleinfo: frame interrupted") \
+    X(TELEINFO_FRAME_DROPPED, "teleinfo: frame dropped - invalid lines: {} - receiver parity errors: {}, framing errors: {}, overruns: {}") \
+    X(TELEINFO_INVALID_VALUE, "teleinfo: invalid value for label {}") \
+    X(TELEINFO_CHECKSUM_ERROR, "teleinfo: checksum error for label {}") \
+    X(TELEINFO_UNKNOWN_LABEL, "teleinfo: Unknown label found - label: {} - value: {}") \
+    X(VIRIDIAN_BELOW_MINIMUM, "viridian: Not charging - new charging current is less than minimum of {} Amps") \
+    X(VIRIDIAN_STOP, "viridian: Sending stop command to Viridian") \
+    X(VIRIDIAN_CHARGE, "viridian: Sending charging command to Viridian at {}A, IC equivalent voltage: {}V, DAC Value: {}") \
+    X(DAC_I2C_ERROR, "dac_MCP4725: Error during I2C transmission - {}") \
+    X(MAIN_CONTROLLER_SELECTED, "main: PI controller selected for this charge") \
+    X(MAIN_CONTROLLER_CHANGE, "main: controller changes the charging current from {} dA to {} dA") \
+    X(MAIN_SESSION_END, "main: Charge session ended - {} Wh delivered with the {} policy") \
+    X(PHASES_CONFIGURED, "phases: charger phase configured to {} (0: detected)") \
+    X(PHASES_DETECTED, "phases: charger detected on phase {}") \
+    X(TIMESERIES_DUMP_START, "timeseries: {} samples every {} s, {} per line") \
+    X(TIMESERIES_SAMPLE, "timeseries: -{} s: {} A, {} VA, {} dA, flags {}") \
+    X(TIMESERIES_AGGREGATE, "timeseries: -{} s: {}/{}/{} A, {}/{}/{} VA (min/max/avg), {} to {} dA, {} overcurrent") \
+    X(TIMESERIES_DUMP_END, "timeseries: end of dump") \
+    X(CALIBRATION_LOADED, "calibration: {} points loaded") \
+    X(CALIBRATION_START, "calibration: starting, the charge is stopped to measure the house") \
+    X(CALIBRATION_POINT, "calibration: {} dA sent, {} dA on the charger phase") \
+    X(CALIBRATION_INVALID, "calibration: not stored, the {} points are not increasing") \
+    X(CALIBRATION_STORED, "calibration: {} points stored") \
+    X(CALIBRATION_ABORTED, "calibration: aborted at step {}") \
+    X(MAIN_CALIBRATION_LIMITED, "main: calibration stopped before {} dA, above the available current") \
+    X(DAC_POWER_ON_VALUE, "dac_MCP4725: power-on value set to {}") \
+    X(RESTART_CAUSE, "restart: reset cause {} ({} times), {} start") \
+    X(MAIN_RESUMED, "main: charge resumed at {} dA after a warm restart") \
+    X(PROFILER_STAGE, "profiler: {}: {} calls, {}/{}/{} us (min/mean/max)") \
+    X(PROFILER_HISTOGRAM, "profiler: {} (log2 us buckets): {} {} {} {} {} {} {} {} {} {} {} {} {} {} {} {}") \
+    X(PROFILER_MEMORY, "profiler: {} bytes free, {} bytes of stack never used") \
+    X(CHARGERS_SHARE, "chargers: charger {} gets {} dA") \
+    X(MAIN_CHARGERS_CHANGED, "main: the chargers with a car changed (mask {}), sharing the current again") \
+    X(FORECAST_TIME_SET, "forecast: time of the day set to {}:{}") \
+    X(FORECAST_BASELINE, "forecast: baseline of slot {} is now {} dA") \
+    X(FORECAST_ERRORS, "forecast: {}: {} checks, bias {}, mean error {} (persistence {}), {} misses (persistence {})") \
+    X(MAIN_FORECAST_PEAK, "main: house load expected to rise by {} dA, adapting charge current") \
+    X(MAIN_POWER_HEADROOM, "main: headroom computed from the apparent power, at {} V") \
+    X(OVERRUN_CUT, "overrun: {} A on phase {}, charge cut from {} to {} dA in {} us") \
+    X(DAC_VERIFY_ERROR, "dac_MCP4725: value {} not applied by the DAC") \
+    X(MAIN_AVAILABLE_DECIAMPS, "main: available current is now {} dA") \
+    X(MAIN_CHANGE_NOT_IMPORTANT_DECIAMPS, "main: Change of charging current is not important enough (already charging at {} dA)") \
+    X(VIRIDIAN_BELOW_MINIMUM_DECIAMPS, "viridian: Not charging - new charging current is less than minimum of {} dA") \
+    X(VIRIDIAN_CHARGE_DECIAMPS, "viridian: Sending charging command to Viridian at {} dA, DAC Value: {}")
+
+#define LOGGER_MESSAGE_ID(id, text) LOGGER_##id,
+enum logger_message_t : unsigned char {
+    LOGGER_MESSAGES(LOGGER_MESSAGE_ID)
+    LOGGER_MESSAGE_COUNT
+};
+#undef LOGGER_MESSAGE_ID
@@ -1,189 +1,733 @@
 #include <Arduino.h>
 
-#include "debug/debug.h"
+#include "logger/logger.h"
+#include "calibration/calibration.h"
+#include "chargers/chargers.h"
 #include "inputs/inputs.h"
 #include "viridian/viridian.h"
-#include "timer/timer.h"
+#include "controller/controller.h"
+#include "forecast/forecast.h"
+#include "overrun/overrun.h"
+#include "phases/phases.h"
+#include "power/power.h"
+#include "profiler/profiler.h"
+#include "restart/restart.h"
+#include "scheduler/scheduler.h"
 #include "teleinfo/teleinfo.h"
+#include "telemetry/telemetry.h"
+#include "timeseries/timeseries.h"
+
+// tuning constants of the charge control: constants on the board, variables on the host
+// so tools/sweep can try other values without building the firmware again
+#if defined(__AVR__)
+#define MAIN_TUNABLE const
+#else
+#define MAIN_TUNABLE
+#endif
 
 // constants for the main program
 // allowed duration in ms to change the charging current (to avoid sending new commands every cycle)
 // set to 15 mins (= 900s = 900 000 ms)
-const uint32_t MAIN_CHARGE_CYCLE = 900000;
-// initial margin for the charing current in Amps
-const uint8_t MAIN_INITIAL_MARGIN = 1;
+MAIN_TUNABLE uint32_t MAIN_CHARGE_CYCLE = 900000;
+// initial margin for the charing current in deciamps
+MAIN_TUNABLE deciamps_t MAIN_INITIAL_MARGIN = 10;
+// margin once the current drawn by the car is calibrated
+const deciamps_t MAIN_CALIBRATED_MARGIN = 5;
+// margin once calibrated when the headroom is computed from the power, without the rounding of IINST
+const deciamps_t MAIN_POWER_CALIBRATED_MARGIN = 2;
 // minimum percentage change to apply the new charging current
-const double MAIN_PERCENTAGE_CHANGE_MINIMUM = 0.1;
+MAIN_TUNABLE uint8_t MAIN_PERCENTAGE_CHANGE_MINIMUM = 10;
+// minimum change to apply the new charging current in deciamps
+const deciamps_t MAIN_CURRENT_CHANGE_MINIMUM = 10;
+// ISOUSC multiplier in percent when the option is set
+MAIN_TUNABLE uint8_t MAIN_GREATER_ISOUSC_PERCENTAGE = 120;
 // initial wait time in ms after the setup
 // set to 10s
 const uint32_t MAIN_END_SETUP_WAIT = 10000;
 // wait time between command change and Teleinfo change
 // set to 5s
-const uint32_t MAIN_CURRENT_CHANGE_DURATION = 5000;
-// main cycle duration in ms
-// set to 1s
-const uint32_t MAIN_LOOP_DURATION = 1000;
-// current to send to the Viridian when no car is charging
-const double MAIN_CURRENT_NO_CAR_CHARGING = 10.0;
+MAIN_TUNABLE uint32_t MAIN_CURRENT_CHANGE_DURATION = 5000;
+// period of the inputs and teleinfo freshness checks in ms
+// set to 100ms
+const uint32_t MAIN_POLL_PERIOD = 100;
+// current to send to the Viridian when no car is charging, in deciamps
+const deciamps_t MAIN_CURRENT_NO_CAR_CHARGING = 100;
 // Delay after the start of the charge
 // set to 15s
-const uint32_t MAIN_INITIAL_CHARGE_DELAY = 15000;
+MAIN_TUNABLE uint32_t MAIN_INITIAL_CHARGE_DELAY = 15000;
+// nominal voltage to convert the charge delivered to the car into energy
+const uint16_t MAIN_NOMINAL_VOLTAGE = POWER_NOMINAL_VOLTAGE;
+// period of the dump task, the lines are only sent when the logger has room for them
+const uint32_t MAIN_DUMP_PERIOD = 20;
+// serial commands: dump the time series as is, or aggregated by MAIN_DUMP_AGGREGATE samples (1 min)
+const char MAIN_COMMAND_DUMP = 'd';
+const char MAIN_COMMAND_DUMP_AGGREGATED = 'a';
+const uint8_t MAIN_DUMP_AGGREGATE = 6;
+// serial command: calibrate the current drawn by the car of the selected charger, while it is charging
+const char MAIN_COMMAND_CALIBRATE = 'c';
+// serial commands: '0' to '7' select the charger of the next calibration
+const char MAIN_COMMAND_SELECT_CHARGER = '0';
+// serial command: report the profiler, when it is enabled
+const char MAIN_COMMAND_PROFILE = 'p';
+// serial command: report the errors of the load forecast
+const char MAIN_COMMAND_FORECAST = 'f';
+// serial command: set the time of the day for the forecast baselines, followed by HHMM
+const char MAIN_COMMAND_TIME = 't';
+const uint8_t MAIN_TIME_DIGITS = 4;
+
+// policies to adapt the charging current, selected with an option at the start of each charge
+enum main_policy_t : uint8_t {
+  // adapt every charge cycle or on ADPS, with minimum changes
+  MAIN_POLICY_CHARGE_CYCLE,
+  // PI controller on the headroom, updated on each frame
+  MAIN_POLICY_CONTROLLER
+};
+
+// states of the charge
+enum main_state_t : uint8_t {
+  // waiting after the setup, in case we just had an overcurrent protection
+  MAIN_STATE_STARTUP,
+  // no car is charging
+  MAIN_STATE_IDLE,
+  // a car was plugged, let it start charging
+  MAIN_STATE_WAITING_FOR_CAR,
+  // waiting for a valid teleinfo frame to set the first charging current
+  MAIN_STATE_RAMPING,
+  // the charging current just changed, waiting for the teleinfo to reflect it
+  MAIN_STATE_SETTLING,
+  // charging, the current is adapted every charge cycle or on ADPS
+  MAIN_STATE_STEADY,
+  // charging, the charging current is stepped through the range to calibrate it
+  MAIN_STATE_CALIBRATING
+};
+
+static main_state_t mainState;
+static main_policy_t mainPolicy;
+
+// scheduler tasks
+static scheduler_task_t mainPollTask;
+static scheduler_task_t mainFrameTask;
+static scheduler_task_t mainStateTimeoutTask;
+static scheduler_task_t mainChargeCycleTask;
+static scheduler_task_t mainSampleTask;
+static scheduler_task_t mainDumpTask;
+
+// last teleinfo frame handled
+static uint16_t mainFrameSequence;
+// the charge cycle elapsed since the last adaptation of the current
+static boolean mainCycleElapsed;
+// the last change of the charging current was a decrease
+static boolean mainLastChangeDecrease;
+// the missing teleinfo was already logged
+static boolean mainTeleinfoLost;
+// the current of the calibration step settled, the frames are measured
+static boolean mainCalibrationMeasuring;
+// charger of the calibration
+static uint8_t mainCalibrationCharger;
+// charge sent to the car during the session, in deciamps.s, and the rest in deciamps.ms
+static uint32_t mainSessionCharge;
+static uint16_t mainSessionChargeRest;
+static uint32_t mainSessionUpdate;
+// digits of the time of the day still expected after MAIN_COMMAND_TIME, and the value received
+static uint8_t mainTimeDigits;
+static uint16_t mainTime;
+
+// called by delay() while waiting: keep consuming the teleinfo stream and sending the logs in the background
+void yield() {
+  teleinfo::process();
+  logger::flush();
+}
 
+// account the charge sent to the car since the last update
+static void updateSession() {
+  uint32_t now = millis();
+  uint32_t charge = (uint32_t)chargers::getChargingCurrent() * (now - mainSessionUpdate) + mainSessionChargeRest;
 
-void setup() {
-  // initialize debug
-  debug::initialize();
+  mainSessionCharge += charge / 1000;
+  mainSessionChargeRest = charge % 1000;
+  mainSessionUpdate = now;
+}
 
-  // start things up
-  debug::log(F("main: Arduino starting"));
+static void startCalibrationStep();
 
-  // initialize inputs
-  inputs::initialize();
+static void enterState(const main_state_t state) {
+  main_state_t previousState = mainState;
+  mainState = state;
 
-  // initialize the viridian interface
-  viridian::initialize();
+  // the timeout of the previous state is not relevant anymore
+  scheduler::cancel(mainStateTimeoutTask);
 
-  // initialize the timer
-  timer::setTimerDuration(MAIN_CHARGE_CYCLE);
+  // a calibration that did not finish keeps the previous one
+  if (previousState == MAIN_STATE_CALIBRATING && state != MAIN_STATE_CALIBRATING) {
+    chargers::getCalibration(mainCalibrationCharger).abort();
+  }
 
-  // initialize the teleinfo interface
-  teleinfo::initialize();
+  switch (state) {
+    case MAIN_STATE_STARTUP:
+      scheduler::runIn(mainStateTimeoutTask, MAIN_END_SETUP_WAIT);
+      break;
+    case MAIN_STATE_IDLE:
+      // end of the charge session, if there was one
+      if (previousState >= MAIN_STATE_RAMPING) {
+        updateSession();
+        // deciamps.s * V / 10 / 3600 = Wh
+        LOG_INFO(MAIN_SESSION_END, mainSessionCharge / 10 * MAIN_NOMINAL_VOLTAGE / 3600, mainPolicy == MAIN_POLICY_CONTROLLER ? "controller" : "charge cycle");
+      }
+
+      LOG_INFO(MAIN_NO_CAR);
+
+      // send the appropriate charging current, the chargers without a car are offered MAIN_CURRENT_NO_CAR_CHARGING
+      chargers::setChargingCurrent(0);
 
-  // debug message to know that initialization is finished
-  debug::log(F("main: Initialization finished. Waiting before starting..."));
+      // the charge cycle restarts with the next charge
+      scheduler::cancel(mainChargeCycleTask);
+      break;
+    case MAIN_STATE_WAITING_FOR_CAR:
+      LOG_INFO(MAIN_CAR_STARTED);
 
-  // just wait a few seconds before going into the loop, in case we just had an overcurrent protection
-  delay(MAIN_END_SETUP_WAIT);
+      // let the car start charging
+      scheduler::runIn(mainStateTimeoutTask, MAIN_INITIAL_CHARGE_DELAY);
+      break;
+    case MAIN_STATE_RAMPING:
+      LOG_INFO(MAIN_FIRST_CHARGE);
+
+      // the policy is kept for the whole session, so sessions can be compared
+      mainPolicy = inputs::readOption(INPUTS_OPTION_PI_CONTROLLER) ? MAIN_POLICY_CONTROLLER : MAIN_POLICY_CHARGE_CYCLE;
+      if (mainPolicy == MAIN_POLICY_CONTROLLER) {
+        LOG_INFO(MAIN_CONTROLLER_SELECTED);
+      }
+      if (power::available(teleinfo::read())) {
+        LOG_INFO(MAIN_POWER_HEADROOM, POWER_NOMINAL_VOLTAGE);
+      }
 
-  // debug message to know we finished setup
-  debug::log(F("main: Setup finished"));
+      // the phase of the charger may also have been changed
+      phases::configure();
+
+      // start of the charge session
+      mainSessionCharge = 0;
+      mainSessionChargeRest = 0;
+      mainSessionUpdate = millis();
+
+      // adapt with the last frame if it is still valid, otherwise wait for the next one
+      mainTeleinfoLost = false;
+      scheduler::runNow(mainFrameTask);
+      break;
+    case MAIN_STATE_SETTLING:
+      // let the teleinfo reflect the new charging current
+      scheduler::runIn(mainStateTimeoutTask, MAIN_CURRENT_CHANGE_DURATION);
+      break;
+    case MAIN_STATE_STEADY:
+      break;
+    case MAIN_STATE_CALIBRATING:
+      // the first step stops the charge to measure the house
+      chargers::getCalibration(mainCalibrationCharger).start();
+      startCalibrationStep();
+      break;
+  }
 }
 
-void loop() {
-  teleinfo_t teleinfo;
+// the short frames of an overrun have no subscription, they are only used by the fast path of the overrun
+static boolean teleinfoValid() {
+  const teleinfo_t &teleinfo = teleinfo::read();
 
-  static boolean chargeStarted;
+  // the frame must have the subscription and the current, of a single phase or of phase 1 on three-phase meters
+  return teleinfo::frameSequence() > 0 && teleinfo::frameAge() < TELEINFO_FRAME_MAX_AGE
+    && teleinfo.has(TELEINFO_FIELD_ISOUSC) && (teleinfo.has(TELEINFO_FIELD_IINST) || teleinfo.has(TELEINFO_FIELD_IINST1));
+}
 
-  boolean adaptCurrent;
+// ISOUSC multiplier in percent
+static uint8_t subscriptionPercentage() {
+  // If option is set, add 20% margin on ISOUSC
+  if (inputs::readOption(INPUTS_OPTION_GREATER_ISOUSC)) {
+    return MAIN_GREATER_ISOUSC_PERCENTAGE;
+  }
+  return 100;
+}
+
+// current that can still be taken from the subscription: ISOUSC * k - IINST - margin - forecast rise of the house load
+// on three-phase installations, ISOUSC is per phase and IINST is the current of the charger phase
+// with the power headroom, the subscribed power - PAPP is used instead of ISOUSC * k - IINST
+static deciamps_t headroom() {
+  const teleinfo_t &teleinfo = teleinfo::read();
+  boolean powerHeadroom = power::available(teleinfo);
+
+  // get the current margin
+  // default to 1A + option for the 2A additional margin
+  // the margin is smaller once the current drawn by the car is calibrated, even more without the rounding of IINST
+  deciamps_t calibratedMargin = powerHeadroom ? MAIN_POWER_CALIBRATED_MARGIN : MAIN_CALIBRATED_MARGIN;
+  deciamps_t currentMargin = (chargers::calibrated() ? calibratedMargin : MAIN_INITIAL_MARGIN)
+    + inputs::readOption(INPUTS_OPTION_MARGIN_ADD_1A) * DECIAMPS_PER_AMP;
+
+  // ISOUSC multiplier in percent
+  uint8_t iSOUSCPercentage = subscriptionPercentage();
+
+  if (powerHeadroom) {
+    return power::headroom(teleinfo, iSOUSCPercentage) - currentMargin - forecast::margin();
+  }
+
+  // teleinfo currents are in Amps, ISOUSC * percentage / 100 * 10 deciamps per Amp
+  return (teleinfo.ISOUSC * iSOUSCPercentage / 10 - phases::current(teleinfo) * DECIAMPS_PER_AMP) - currentMargin - forecast::margin();
+}
 
+// the house load is expected to rise above the headroom, by a change the charge cycle policy would apply
+// a smaller one would be checked again on each frame
+static boolean forecastPeak() {
+  deciamps_t decrease = -headroom();
+
+  return forecast::margin() > 0 && decrease >= MAIN_CURRENT_CHANGE_MINIMUM
+    && (int32_t)decrease * 100 > (int32_t)chargers::getChargingCurrent() * MAIN_PERCENTAGE_CHANGE_MINIMUM;
+}
+
+// compute and apply the new charging current with the charge cycle policy, returns true if it changed
+static boolean adaptCurrent() {
   // reset the current changed info for the viridian
-  viridian::resetChange();
-  
-  if (inputs::readOption(INPUTS_OPTION_CHARGING_CAR)) {
-    // There is no car charging
-    debug::log(F("main: No car is charging"));
+  chargers::resetChange();
 
-    // send the appropriate charging current
-    viridian::setChargingCurrent(MAIN_CURRENT_NO_CAR_CHARGING);
+  // the next adaptation waits for the next charge cycle
+  mainCycleElapsed = false;
 
-    // State that the charge did not start
-    chargeStarted = false;
-  } else {
-    if (chargeStarted == false) {
-      // log
-      debug::log(F("main: Car just started charging, waiting for charge to start"));
+  // Compute the avalaible current increase
+  deciamps_t availableCurrent = chargers::getChargingCurrent() + headroom();
 
-      // let the car start charging
-      delay(MAIN_INITIAL_CHARGE_DELAY);
-    }
+  // additional debug message to understand what is going on
+  LOG_DEBUG(MAIN_AVAILABLE_DECIAMPS, availableCurrent);
 
-    // Read the teleInfo
-    debug::log(F("main: Reading teleInfo"));
-    teleinfo = teleinfo::read();
-
-    // log the teleinfo data
-    debug::logNoLine(F("main: Teleinfo ISOUSC: "));
-    debug::log(String(teleinfo.ISOUSC));
-    debug::logNoLine(F("main: Teleinfo IINST: "));
-    debug::log(String(teleinfo.IINST));
-
-    // check if the teleinfo data is empty
-    if (teleinfo.ISOUSC == 0) {
-      // log
-      debug::log(F("main: ISOUSC is 0, teleinfo most likely failed to read data"));
-      debug::log(F("main: current will not be adapted"));
-    }
+  // remember the direction of the change, before it is applied
+  boolean decrease = availableCurrent < chargers::getChargingCurrent();
 
-    // check if adapting current is necessary
-    // If ISOUSC is 0, then teleinfo read failed, so do not try to adapt current
-    // Otherwise, adapt if on timer, or ADPS triggered, or we just started charging the car
-    adaptCurrent = teleinfo.ISOUSC > 0 && (timer::timerAllows() || teleinfo.ADPS > 0 || chargeStarted == false);
-
-    // If necessary to adaptCurrent 
-    if (adaptCurrent) {
-      if ( chargeStarted == false ) {
-        // log
-        debug::log(F("main: Now adapting charge current for first charge"));
-
-        // reset the timer
-        timer::resetTimer();
-
-        // Record that the charge has started
-        chargeStarted = true;
-      } else if (teleinfo.ADPS > 0) {
-        // log to debug
-        debug::log(F("main: ADPS received, adapting charge current"));
+  // if we were not charging before, start charging (if it is more than the minimum in viridian module)
+  if (chargers::getChargingCurrent() == 0) {
+    // also do not start charging if no current is available
+    if (availableCurrent > 0) {
+      // set the appropriate charging current
+      chargers::setChargingCurrent(availableCurrent);
+    }
+  } else {
+    // check that the availableCurrent is at least one Amp different
+    if ((-MAIN_CURRENT_CHANGE_MINIMUM < (availableCurrent - chargers::getChargingCurrent())) && ((availableCurrent - chargers::getChargingCurrent()) < MAIN_CURRENT_CHANGE_MINIMUM)) {
+      // if not, log a message
+      LOG_DEBUG(MAIN_CHANGE_TOO_SMALL);
+    } else {
+      // compare the new current to the allowed percentages of the current one, without dividing
+      int32_t newCurrent = (int32_t)availableCurrent * 100;
+      int32_t chargingCurrent = chargers::getChargingCurrent();
+
+      // if the percentage change is greater than allowed change
+      if (newCurrent > chargingCurrent * (100 + MAIN_PERCENTAGE_CHANGE_MINIMUM) || newCurrent < chargingCurrent * (100 - MAIN_PERCENTAGE_CHANGE_MINIMUM)) {
+        // set the new charging current
+        chargers::setChargingCurrent(availableCurrent);
       } else {
-        // log to debug
-        debug::log(F("main: Nominal timer activation"));
+        // log to debug that we did not ask for an update of the charging current
+        LOG_DEBUG(MAIN_CHANGE_NOT_IMPORTANT_DECIAMPS, chargers::getChargingCurrent());
       }
-      // get the current margin
-      // default to 1A + option for the 2A additional margin
-      uint8_t currentMargin = MAIN_INITIAL_MARGIN + inputs::readOption(INPUTS_OPTION_MARGIN_ADD_1A);
+    }
+  }
 
-      // ISOUSC multiplier
-      double iSOUSCMultplier = 1.0;
+  if (chargers::currentChanged()) {
+    mainLastChangeDecrease = decrease;
+  }
 
-      // If option is set, add 20% margin on ISOUSC
-      if (inputs::readOption(INPUTS_OPTION_GREATER_ISOUSC)) {
-        iSOUSCMultplier += 0.2;
-      }
+  return chargers::currentChanged();
+}
+
+// apply the new charging current of the controller, returns true if it changed
+static boolean adaptController() {
+  const teleinfo_t &teleinfo = teleinfo::read();
+  deciamps_t current = chargers::getChargingCurrent();
+
+  chargers::resetChange();
+
+  deciamps_t newCurrent = controller::update(current, headroom(), phases::overcurrent(teleinfo));
+  if (newCurrent != current) {
+    LOG_DEBUG(MAIN_CONTROLLER_CHANGE, current, newCurrent);
+    chargers::setChargingCurrent(newCurrent);
+    mainLastChangeDecrease = newCurrent < current;
+  }
+
+  return chargers::currentChanged();
+}
+
+// adapt the current with the policy and move to the state following the adaptation
+static void adaptAndSettle(const main_policy_t policy) {
+  deciamps_t current = chargers::getChargingCurrent();
+  boolean changed;
+
+  if (policy == MAIN_POLICY_CONTROLLER) {
+    changed = adaptController();
+  } else {
+    changed = adaptCurrent();
+  }
+
+  telemetry::decision(mainState, policy, headroom(), current, chargers::getChargingCurrent());
+
+  if (changed) {
+    // the step of the current tells the phase of the charger
+    phases::onCommand(chargers::getChargingCurrent() - current);
+    enterState(MAIN_STATE_SETTLING);
+  } else {
+    enterState(MAIN_STATE_STEADY);
+  }
+}
+
+// store the calibration and resume the charge from the available current, as for the first charge
+static void endCalibration() {
+  chargers::getCalibration(mainCalibrationCharger).finish();
+  adaptAndSettle(MAIN_POLICY_CHARGE_CYCLE);
+  controller::start(chargers::getChargingCurrent());
+}
+
+// send the charging current of the calibration step, and let the car settle before measuring
+// the other chargers keep their charging current
+static void startCalibrationStep() {
+  viridian &charger = chargers::get(mainCalibrationCharger);
+  deciamps_t current = charger.getChargingCurrent();
+  deciamps_t command = chargers::getCalibration(mainCalibrationCharger).command();
+
+  // the calibration must not cause an overcurrent, it ends with the points measured so far
+  if (command > current + headroom()) {
+    LOG_WARNING(MAIN_CALIBRATION_LIMITED, command);
+    endCalibration();
+    return;
+  }
+
+  charger.setChargingCurrent(command);
+  phases::onCommand(command - current);
+
+  mainCalibrationMeasuring = false;
+  scheduler::runIn(mainStateTimeoutTask, CALIBRATION_SETTLE_DELAY);
+}
+
+// a new teleinfo frame was published
+static void onFrame() {
+  PROFILE(FRAME);
+
+  telemetry::frame(teleinfo::read());
+
+  // the fast path cut the charge while the frame was received, the frames do not reflect it yet
+  // the settling then ignores the overruns this decrease could not have solved yet
+  boolean overrunCut = overrun::takeCut();
+  if (overrunCut && mainState > MAIN_STATE_RAMPING) {
+    controller::start(chargers::getChargingCurrent());
+    mainLastChangeDecrease = true;
+    enterState(MAIN_STATE_SETTLING);
+  }
+
+  if (!teleinfoValid()) {
+    return;
+  }
 
-      // Compute the avalaible current increase
-      double availableCurrent = viridian::getChargingCurrent() + (teleinfo.ISOUSC * iSOUSCMultplier - teleinfo.IINST) - currentMargin;
+  const teleinfo_t &teleinfo = teleinfo::read();
+  mainTeleinfoLost = false;
 
-      // additional debug message to understand what is going on
-      debug::logNoLine(F("main: available current is now "));
-      debug::logNoLine(String(availableCurrent));
-      debug::log(F(" Amps"));
+  overrun::setLimit(teleinfo.ISOUSC * subscriptionPercentage() / 10);
 
-      // if we were not charging before, start charging (if it is more than the minimum in viridian module)
-      if (viridian::getChargingCurrent() == 0.0) {
-        // also do not start charging if no current is available
-        if (availableCurrent > 0.0) {
-          // set the appropriate charging current
-          viridian::setChargingCurrent(availableCurrent);
+  // start of the delay to the DAC write that should follow, the fast path already wrote it
+  if (phases::overcurrent(teleinfo) && !overrunCut) {
+    PROFILE_ADPS();
+  }
+  phases::onFrame(teleinfo);
+  power::onFrame(teleinfo);
+  timeseries::addFrame(phases::current(teleinfo), teleinfo.PAPP, phases::overcurrent(teleinfo));
+
+  // the load of the house is the meter without the charge, only known while the charge is not changing
+  if (mainState == MAIN_STATE_IDLE || mainState == MAIN_STATE_STEADY) {
+    deciamps_t charge = chargers::getChargingCurrent();
+    deciamps_t house = phases::current(teleinfo) * DECIAMPS_PER_AMP - charge;
+    uint32_t chargePower = (uint32_t)charge * MAIN_NOMINAL_VOLTAGE / DECIAMPS_PER_AMP;
+
+    forecast::addFrame(house > 0 ? house : 0, teleinfo.PAPP > chargePower ? teleinfo.PAPP - chargePower : 0);
+  }
+
+  switch (mainState) {
+    case MAIN_STATE_RAMPING:
+      // first adaptation of the charge with the charge cycle policy, whatever the policy
+      // it takes the whole headroom at once, the controller then starts from there
+      scheduler::runEvery(mainChargeCycleTask, MAIN_CHARGE_CYCLE);
+      adaptAndSettle(MAIN_POLICY_CHARGE_CYCLE);
+      controller::start(chargers::getChargingCurrent());
+      break;
+    case MAIN_STATE_SETTLING:
+      // the frame may not reflect the last change yet: only react to an ADPS
+      // that a decrease of the current could not have caused
+      if (phases::overcurrent(teleinfo) && !mainLastChangeDecrease) {
+        LOG_INFO(MAIN_ADPS);
+        adaptAndSettle(mainPolicy);
+      }
+      break;
+    case MAIN_STATE_STEADY:
+      if (mainPolicy == MAIN_POLICY_CONTROLLER) {
+        // the controller runs on every frame, with its own slew limits
+        adaptAndSettle(mainPolicy);
+      } else if (phases::overcurrent(teleinfo)) {
+        LOG_INFO(MAIN_ADPS);
+        adaptAndSettle(mainPolicy);
+      } else if (forecastPeak()) {
+        // lower the charge before the meter flags the overrun
+        LOG_INFO(MAIN_FORECAST_PEAK, forecast::margin());
+        adaptAndSettle(mainPolicy);
+      } else if (mainCycleElapsed) {
+        LOG_INFO(MAIN_CHARGE_CYCLE);
+        adaptAndSettle(mainPolicy);
+      }
+      break;
+    case MAIN_STATE_CALIBRATING:
+      // an overcurrent ends the calibration with the points measured so far
+      if (phases::overcurrent(teleinfo)) {
+        LOG_INFO(MAIN_ADPS);
+        endCalibration();
+      } else if (mainCalibrationMeasuring && chargers::getCalibration(mainCalibrationCharger).measure(phases::current(teleinfo) * DECIAMPS_PER_AMP)) {
+        if (chargers::getCalibration(mainCalibrationCharger).next()) {
+          startCalibrationStep();
+        } else {
+          endCalibration();
         }
-      } else {
-        // check that the availableCurrent is at least one Amp different
-        if ((-1.0 < (availableCurrent - viridian::getChargingCurrent())) && ((availableCurrent - viridian::getChargingCurrent()) < 1.0)) {
-          // if not, log a message
-          debug::log(F("main: Change of charging current is less than one amp. Not changing."));
-          } else {
-          // compute the percentage change
-          double percentageChange = availableCurrent / viridian::getChargingCurrent();
-
-          // if the percentageChange is greater than allowed change
-          if (percentageChange > 1 + MAIN_PERCENTAGE_CHANGE_MINIMUM || percentageChange < 1 - MAIN_PERCENTAGE_CHANGE_MINIMUM) {
-            // set the new charging current
-            viridian::setChargingCurrent(availableCurrent);
-
-            // delay after the change of charge
-            delay(MAIN_CURRENT_CHANGE_DURATION);
-          } else {
-            // log to debug that we did not ask for an update of the charging current
-            debug::logNoLine(F("main: Change of charging current is not important enough (already charging at "));
-            debug::logNoLine(String(viridian::getChargingCurrent()));
-            debug::log(F(" Amps)"));
-          }
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+static void onStateTimeout() {
+  switch (mainState) {
+    case MAIN_STATE_STARTUP:
+      // debug message to know we finished setup
+      LOG_INFO(MAIN_SETUP_FINISHED);
+      // the car may already be charging
+      enterState(chargers::carCharging() ? MAIN_STATE_WAITING_FOR_CAR : MAIN_STATE_IDLE);
+      break;
+    case MAIN_STATE_WAITING_FOR_CAR:
+      enterState(MAIN_STATE_RAMPING);
+      break;
+    case MAIN_STATE_SETTLING:
+      enterState(MAIN_STATE_STEADY);
+      // a charge cycle may have elapsed while settling
+      scheduler::runNow(mainFrameTask);
+      break;
+    case MAIN_STATE_CALIBRATING:
+      // the next frames reflect the charging current of the step
+      mainCalibrationMeasuring = true;
+      break;
+    default:
+      break;
+  }
+}
+
+static void onChargeCycle() {
+  // the current is adapted with the next valid frame
+  mainCycleElapsed = true;
+}
+
+static void onSample() {
+  timeseries::commit(chargers::getChargingCurrent(), mainState);
+}
+
+static void onDump() {
+  // both outputs may run at the same time
+  bool dumping = timeseries::dumpNext();
+  dumping = profiler::reportNext() || dumping;
+
+  if (!dumping) {
+    scheduler::cancel(mainDumpTask);
+  }
+}
+
+// commands received on the serial port
+static void readCommands() {
+  while (Serial.available() > 0) {
+    int command = Serial.read();
+
+    // digits of the time of the day, anything else cancels it and is handled as a command
+    if (mainTimeDigits > 0) {
+      if (command >= '0' && command <= '9') {
+        mainTime = mainTime * 10 + command - '0';
+        mainTimeDigits--;
+        if (mainTimeDigits == 0 && mainTime / 100 < 24 && mainTime % 100 < 60) {
+          forecast::setTime(mainTime / 100 * 60 + mainTime % 100);
         }
+        continue;
       }
-    } else {
-      // simple log message
-      debug::log(F("main: waiting for appropriate time to change charge"));
+      mainTimeDigits = 0;
+    }
+
+    if (command == MAIN_COMMAND_TIME) {
+      mainTimeDigits = MAIN_TIME_DIGITS;
+      mainTime = 0;
+    }
+
+    if (command == MAIN_COMMAND_FORECAST) {
+      forecast::report();
+    }
+
+    // a dump in progress is restarted
+    if (command == MAIN_COMMAND_DUMP || command == MAIN_COMMAND_DUMP_AGGREGATED) {
+      timeseries::startDump(command == MAIN_COMMAND_DUMP ? 1 : MAIN_DUMP_AGGREGATE);
+      scheduler::runEvery(mainDumpTask, MAIN_DUMP_PERIOD);
+    }
+
+    if (command == MAIN_COMMAND_PROFILE) {
+      profiler::report();
+      scheduler::runEvery(mainDumpTask, MAIN_DUMP_PERIOD);
+    }
+
+    if (command >= MAIN_COMMAND_SELECT_CHARGER && command < MAIN_COMMAND_SELECT_CHARGER + VIRIDIAN_CHARGERS) {
+      mainCalibrationCharger = command - MAIN_COMMAND_SELECT_CHARGER;
+    }
+
+    // only while the car of the charger is charging, with the current settled
+    if (command == MAIN_COMMAND_CALIBRATE && mainState == MAIN_STATE_STEADY && chargers::get(mainCalibrationCharger).carCharging()) {
+      enterState(MAIN_STATE_CALIBRATING);
+    }
+  }
+}
+
+static void onPoll() {
+  // keep the state for a warm restart, this also resets the watchdog
+  restart_state_t state = { mainState, mainPolicy, mainSessionCharge, {} };
+  for (uint8_t i = 0; i < VIRIDIAN_CHARGERS; i++) {
+    state.current[i] = chargers::get(i).getChargingCurrent();
+  }
+  restart::save(state);
+
+  // a car that arrives or leaves while others are charging changes the share
+  if (chargers::refresh() && mainState >= MAIN_STATE_RAMPING && chargers::carCharging()) {
+    LOG_INFO(MAIN_CHARGERS_CHANGED, chargers::active());
+    chargers::setChargingCurrent(chargers::getChargingCurrent());
+
+    // the share is then adapted to the headroom once the frames reflect it, a calibration is stopped
+    if (mainState > MAIN_STATE_RAMPING) {
+      mainCycleElapsed = true;
+      mainLastChangeDecrease = false;
+      enterState(MAIN_STATE_SETTLING);
+    }
+  }
+
+  readCommands();
+
+  if (mainState == MAIN_STATE_STARTUP) {
+    return;
+  }
+
+  if (!chargers::carCharging()) {
+    if (mainState != MAIN_STATE_IDLE) {
+      enterState(MAIN_STATE_IDLE);
     }
+    return;
   }
 
-  // wait a bit for the next cycle
-  delay(MAIN_LOOP_DURATION);
-}
\ No newline at end of file
+  if (mainState == MAIN_STATE_IDLE) {
+    enterState(MAIN_STATE_WAITING_FOR_CAR);
+    return;
+  }
+
+  if (mainState >= MAIN_STATE_RAMPING) {
+    updateSession();
+  }
+
+  // If there is no recent frame, then teleinfo read failed, so the current is not adapted
+  // the short frames of an overrun are not a loss
+  const teleinfo_t &teleinfo = teleinfo::read();
+  boolean overrunFrame = teleinfo.shortFrame && teleinfo::frameAge() < TELEINFO_FRAME_MAX_AGE;
+  if (mainState != MAIN_STATE_WAITING_FOR_CAR && !mainTeleinfoLost && !teleinfoValid() && !overrunFrame) {
+    LOG_WARNING(MAIN_TELEINFO_LOST);
+    mainTeleinfoLost = true;
+  }
+}
+
+// resume the state saved before a warm restart, without the wait of a power-on
+static void resume(const restart_state_t &saved) {
+  mainPolicy = (main_policy_t)saved.policy;
+
+  // the poll moves to the state of the car
+  if (saved.state < MAIN_STATE_RAMPING || !chargers::carCharging()) {
+    enterState(MAIN_STATE_IDLE);
+    return;
+  }
+
+  LOG_INFO(MAIN_RESUMED, chargers::getChargingCurrent());
+
+  // the charge goes on: the session, the charge cycle and the controller continue from the charging current
+  phases::configure();
+  controller::start(chargers::getChargingCurrent());
+  mainSessionCharge = saved.sessionCharge;
+  mainSessionChargeRest = 0;
+  mainSessionUpdate = millis();
+  mainLastChangeDecrease = false;
+  scheduler::runEvery(mainChargeCycleTask, MAIN_CHARGE_CYCLE);
+
+  // a stopped charge, e.g. during a calibration, is adapted with the next frame
+  enterState(chargers::getChargingCurrent() > 0 ? MAIN_STATE_SETTLING : MAIN_STATE_RAMPING);
+}
+
+void setup() {
+  // the cause of the reset first, it also starts the watchdog
+  restart::initialize();
+  profiler::initialize();
+
+  // initialize the logger
+  logger::initialize();
+
+  // start things up
+  LOG_INFO(MAIN_STARTING);
+
+  // initialize inputs
+  inputs::initialize();
+
+  // load the calibration of the current, then initialize the viridian interface of each charger
+  // after a warm restart, the DACs still output the charging currents
+  chargers::initialize(restart::warm() ? restart::state().current : NULL, MAIN_CURRENT_NO_CAR_CHARGING);
+
+  // initialize the teleinfo interface
+  teleinfo::initialize();
+  overrun::initialize();
+
+  // initialize the time series and the forecast of the house load
+  timeseries::initialize();
+  forecast::initialize();
+
+  // initialize the scheduler and the tasks
+  scheduler::initialize();
+  mainPollTask = scheduler::add(onPoll);
+  mainFrameTask = scheduler::add(onFrame);
+  mainStateTimeoutTask = scheduler::add(onStateTimeout);
+  mainChargeCycleTask = scheduler::add(onChargeCycle);
+  mainSampleTask = scheduler::add(onSample);
+  mainDumpTask = scheduler::add(onDump);
+  scheduler::runEvery(mainPollTask, MAIN_POLL_PERIOD);
+  scheduler::runEvery(mainSampleTask, TIMESERIES_PERIOD);
+
+  // after a power-on, just wait a few seconds before handling the charge, in case we just had an overcurrent protection
+  // the teleinfo is received in the meantime
+  if (restart::warm()) {
+    resume(restart::state());
+  } else {
+    // debug message to know that initialization is finished
+    LOG_INFO(MAIN_INITIALIZED);
+    enterState(MAIN_STATE_STARTUP);
+  }
+}
+
+void loop() {
+  PROFILE(LOOP);
+
+  // consume the teleinfo stream, and handle each new frame as an event
+  teleinfo::process();
+  if (teleinfo::frameSequence() != mainFrameSequence) {
+    mainFrameSequence = teleinfo::frameSequence();
+    scheduler::runNow(mainFrameTask);
+  }
+
+  // a car that starts or stops charging is handled at once, not at the next poll
+  if (inputs::chargingChanged()) {
+    scheduler::runNow(mainPollTask);
+  }
+
+  // run the tasks that are due
+  scheduler::run();
+
+  // ramp the charging currents toward their new value
+  chargers::update();
+
+  // send the logs while the UART is idle
+  logger::flush();
+}
@@ -0,0 +1,86 @@
+#include <Arduino.h>
+
+#include "chargers/chargers.h"
+#include "logger/logger.h"
+#include "phases/phases.h"
+#include "profiler/profiler.h"
+
+#include "overrun.h"
+
+deciamps_t overrun::limit;
+deciamps_t overrun::base;
+uint32_t overrun::cutTime;
+bool overrun::cut;
+uint16_t overrun::cutCount;
+uint32_t overrun::latency;
+
+void overrun::initialize() {
+    teleinfo::subscribe(TELEINFO_FIELD_ADPS, overrun::onLine);
+    teleinfo::subscribe(TELEINFO_FIELD_ADIR1, overrun::onLine);
+    teleinfo::subscribe(TELEINFO_FIELD_ADIR2, overrun::onLine);
+    teleinfo::subscribe(TELEINFO_FIELD_ADIR3, overrun::onLine);
+}
+
+void overrun::setLimit(const deciamps_t limit) {
+    overrun::limit = limit;
+}
+
+bool overrun::takeCut() {
+    bool cut = overrun::cut;
+    overrun::cut = false;
+    return cut;
+}
+
+uint16_t overrun::cuts() {
+    return overrun::cutCount;
+}
+
+uint32_t overrun::maxLatency() {
+    return overrun::latency;
+}
+
+void overrun::onLine(const teleinfo_field_t field, const uint32_t value) {
+    uint32_t start = micros();
+    uint8_t phase = field == TELEINFO_FIELD_ADPS ? 1 : field - TELEINFO_FIELD_ADIR1 + 1;
+
+    // the overrun of another phase than the one of the charger is not ours to solve
+    if (field != TELEINFO_FIELD_ADPS && phases::chargerPhase() != PHASES_UNKNOWN && phases::chargerPhase() != phase) {
+        return;
+    }
+
+    // an overrun below the limit is expected with the greater ISOUSC option, main handles it
+    // without any full frame yet, the limit is 0 and the charge is stopped
+    deciamps_t excess = (deciamps_t)value * DECIAMPS_PER_AMP - overrun::limit;
+    if (excess <= 0) {
+        return;
+    }
+
+    deciamps_t charge = chargers::getChargingCurrent();
+    if (overrun::cutCount == 0 || millis() - overrun::cutTime >= OVERRUN_HOLD_OFF) {
+        overrun::base = charge;
+    }
+
+    // the measure includes the charge before the cut until the car follows it
+    deciamps_t safe = overrun::base - excess - OVERRUN_MARGIN;
+    if (safe < 0) {
+        safe = 0;
+    }
+    if (safe >= charge) {
+        return;
+    }
+
+    PROFILE_ADPS();
+    chargers::setChargingCurrent(safe);
+
+    uint32_t latency = micros() - start;
+    if (latency > overrun::latency) {
+        overrun::latency = latency;
+    }
+    if (overrun::cutCount < 0xFFFF) {
+        overrun::cutCount++;
+    }
+    overrun::cutTime = millis();
+    overrun::cut = true;
+
+    LOG_INFO(OVERRUN_CUT, (uint8_t)value, phase, charge, chargers::getChargingCurrent(), latency);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "teleinfo/teleinfo.h"
+#include "viridian/viridian.h"
+
+// Fast path of the overruns of the subscription
+// the meter signals an overrun with an ADPS line (single-phase) or ADIRn lines (three-phase), and historic
+// three-phase meters switch to short frames (ADCO, IINSTn and ADIRn only) until it ends
+// the charge is cut as soon as the line is validated, before the end of the frame, by the excess over the
+// limit plus a margin: the DAC is written within the frame of the first overrun line, instead of after
+// the frame and the state machine of main
+// standard meters do not send the overrun, it is raised at the end of the frame and handled by main
+
+// margin below the limit after a cut
+static const deciamps_t OVERRUN_MARGIN = 20;
+
+// time for the car to follow a cut (ms): the lines received meanwhile still include the previous charge,
+// they only cut further if the overrun grew
+static const uint32_t OVERRUN_HOLD_OFF = 5000;
+
+class overrun {
+    public:
+        // subscribe to the overrun lines
+        static void initialize();
+
+        // current allowed by the subscription, in deciamps, from the last full frame
+        static void setLimit(const deciamps_t limit);
+
+        // the charge was cut since the last call
+        static bool takeCut();
+
+        // number of cuts and maximum delay from the overrun line to the DAC written (us)
+        static uint16_t cuts();
+        static uint32_t maxLatency();
+
+    private:
+        static void onLine(const teleinfo_field_t field, const uint32_t value);
+
+        static deciamps_t limit;
+        // charge before the first cut of the hold-off
+        static deciamps_t base;
+        static uint32_t cutTime;
+        static bool cut;
+        static uint16_t cutCount;
+        static uint32_t latency;
+};
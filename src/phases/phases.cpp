@@ -0,0 +1,143 @@
+#include <Arduino.h>
+
+#include "inputs/inputs.h"
+#include "logger/logger.h"
+
+#include "phases.h"
+
+uint8_t phases::configuredPhase;
+uint8_t phases::detectedPhase;
+uint8_t phases::candidatePhase;
+uint8_t phases::candidateSteps;
+deciamps_t phases::stepChange;
+uint32_t phases::stepTime;
+uint8_t phases::stepCurrents[3];
+uint8_t phases::lastCurrents[3];
+
+void phases::configure() {
+    // 2 bits: 0 to detect the phase, 1 to 3 for the phase
+    uint8_t phase = inputs::readOption(INPUTS_OPTION_CHARGER_PHASE_1) + 2 * inputs::readOption(INPUTS_OPTION_CHARGER_PHASE_2);
+
+    if (phase != phases::configuredPhase) {
+        phases::configuredPhase = phase;
+        LOG_INFO(PHASES_CONFIGURED, phase);
+    }
+}
+
+uint8_t phases::chargerPhase() {
+    return phases::configuredPhase != PHASES_UNKNOWN ? phases::configuredPhase : phases::detectedPhase;
+}
+
+uint8_t phases::current(const teleinfo_t &frame) {
+    if (frame.phases == 1) {
+        return frame.IINST;
+    }
+
+    uint8_t phase = phases::chargerPhase();
+    if (phase != PHASES_UNKNOWN) {
+        return phases::phaseCurrent(frame, phase);
+    }
+
+    // the headroom is the one of the most loaded phase
+    uint8_t current = frame.IINST1;
+    if (frame.IINST2 > current) {
+        current = frame.IINST2;
+    }
+    if (frame.IINST3 > current) {
+        current = frame.IINST3;
+    }
+    return current;
+}
+
+bool phases::overcurrent(const teleinfo_t &frame) {
+    if (frame.phases == 1) {
+        return frame.ADPS > 0;
+    }
+
+    switch (phases::chargerPhase()) {
+        case 1:
+            return frame.ADIR1 > 0;
+        case 2:
+            return frame.ADIR2 > 0;
+        case 3:
+            return frame.ADIR3 > 0;
+        default:
+            return frame.ADIR1 > 0 || frame.ADIR2 > 0 || frame.ADIR3 > 0;
+    }
+}
+
+void phases::onFrame(const teleinfo_t &frame) {
+    if (frame.phases == 1) {
+        return;
+    }
+
+    if (phases::stepChange != 0 && millis() - phases::stepTime >= PHASES_DETECT_DELAY) {
+        phases::measureStep(frame);
+    }
+
+    for (uint8_t phase = 1; phase <= 3; phase++) {
+        phases::lastCurrents[phase - 1] = phases::phaseCurrent(frame, phase);
+    }
+}
+
+void phases::onCommand(const deciamps_t change) {
+    // only large steps stand out of the changes of the other loads
+    if (phases::configuredPhase != PHASES_UNKNOWN || (change > -PHASES_DETECT_MIN_STEP && change < PHASES_DETECT_MIN_STEP)) {
+        phases::stepChange = 0;
+        return;
+    }
+
+    phases::stepChange = change;
+    phases::stepTime = millis();
+    memcpy(phases::stepCurrents, phases::lastCurrents, sizeof(phases::stepCurrents));
+}
+
+uint8_t phases::phaseCurrent(const teleinfo_t &frame, const uint8_t phase) {
+    switch (phase) {
+        case 1:
+            return frame.IINST1;
+        case 2:
+            return frame.IINST2;
+        default:
+            return frame.IINST3;
+    }
+}
+
+void phases::measureStep(const teleinfo_t &frame) {
+    // the car may have taken too long, or the teleinfo was lost
+    bool late = millis() - phases::stepTime > PHASES_DETECT_TIMEOUT;
+
+    // expected change in Amps, rounded
+    int16_t expected = (phases::stepChange + (phases::stepChange > 0 ? DECIAMPS_PER_AMP / 2 : -DECIAMPS_PER_AMP / 2)) / DECIAMPS_PER_AMP;
+    phases::stepChange = 0;
+
+    if (late) {
+        return;
+    }
+
+    // the step matches a phase if it is the only one which changed as expected
+    uint8_t matching = PHASES_UNKNOWN;
+    for (uint8_t phase = 1; phase <= 3; phase++) {
+        int16_t change = (int16_t)phases::phaseCurrent(frame, phase) - phases::stepCurrents[phase - 1];
+
+        if (abs(change - expected) <= PHASES_DETECT_TOLERANCE) {
+            if (matching != PHASES_UNKNOWN) {
+                // more than one phase changed the same way: the step tells nothing
+                return;
+            }
+            matching = phase;
+        }
+    }
+
+    if (matching == PHASES_UNKNOWN || matching != phases::candidatePhase) {
+        phases::candidatePhase = matching;
+        phases::candidateSteps = matching != PHASES_UNKNOWN ? 1 : 0;
+    } else if (phases::candidateSteps < PHASES_DETECT_STEPS) {
+        phases::candidateSteps++;
+    }
+
+    if (phases::candidateSteps >= PHASES_DETECT_STEPS && phases::detectedPhase != matching) {
+        phases::detectedPhase = matching;
+        LOG_INFO(PHASES_DETECTED, matching);
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "teleinfo/teleinfo.h"
+#include "viridian/viridian.h"
+
+// Phase of the charger on three-phase installations
+// the headroom is computed on the phase of the charger, against the subscribed current per phase
+// the phase is configured with two options, or detected from the DAC steps:
+// after a change of the charging current, the phase whose current changed the same way is the one of the charger
+// with several chargers, the phase is the one of all of them, and the steps are the changes of their sum
+
+// minimum change of the charging current to detect the phase
+static const deciamps_t PHASES_DETECT_MIN_STEP = 30;
+// delay after a change of the charging current before measuring its effect (ms)
+static const uint32_t PHASES_DETECT_DELAY = 5000;
+// maximum delay to measure the effect of a change, the step is ignored after (ms)
+static const uint32_t PHASES_DETECT_TIMEOUT = 15000;
+// tolerance on the change of the phase current, in Amps
+static const uint8_t PHASES_DETECT_TOLERANCE = 2;
+// the phases that did not change must be out of the tolerance of the smallest step, once rounded to Amps
+static_assert(PHASES_DETECT_MIN_STEP - DECIAMPS_PER_AMP / 2 > PHASES_DETECT_TOLERANCE * DECIAMPS_PER_AMP, "PHASES_DETECT_MIN_STEP must be larger than PHASES_DETECT_TOLERANCE");
+// number of matching steps in a row to decide on the phase
+static const uint8_t PHASES_DETECT_STEPS = 3;
+
+// no phase configured nor detected yet
+static const uint8_t PHASES_UNKNOWN = 0;
+
+class phases {
+    public:
+        // read the configured phase, at the start of each charge
+        static void configure();
+        // phase of the charger, PHASES_UNKNOWN on a three-phase installation until it is detected
+        static uint8_t chargerPhase();
+
+        // current and overcurrent of the charger phase
+        // while the phase is unknown, the most loaded phase and any overcurrent are used
+        static uint8_t current(const teleinfo_t &frame);
+        static bool overcurrent(const teleinfo_t &frame);
+
+        // to be called on each valid frame, and on each change of the charging current
+        static void onFrame(const teleinfo_t &frame);
+        static void onCommand(const deciamps_t change);
+
+    private:
+        static uint8_t phaseCurrent(const teleinfo_t &frame, const uint8_t phase);
+        static void measureStep(const teleinfo_t &frame);
+
+        static uint8_t configuredPhase;
+        static uint8_t detectedPhase;
+
+        // phase that matched the last steps, and how many times in a row
+        static uint8_t candidatePhase;
+        static uint8_t candidateSteps;
+
+        // step waiting to be measured
+        static deciamps_t stepChange;
+        static uint32_t stepTime;
+        static uint8_t stepCurrents[3];
+        // currents of the last frame, the ones before the next step
+        static uint8_t lastCurrents[3];
+};
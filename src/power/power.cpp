@@ -0,0 +1,51 @@
+#include <Arduino.h>
+
+#include "power.h"
+
+uint32_t power::value;
+
+void power::onFrame(const teleinfo_t &frame) {
+    if (!frame.has(TELEINFO_FIELD_PAPP)) {
+        return;
+    }
+
+    uint32_t measure = frame.PAPP << POWER_FILTER_SHIFT;
+
+    // a rise is taken at once, the first frame too
+    if (measure >= power::value) {
+        power::value = measure;
+    } else {
+        power::value -= (power::value - measure) >> POWER_FILTER_FALL_SHIFT;
+    }
+}
+
+bool power::available(const teleinfo_t &frame) {
+    return POWER_HEADROOM && frame.phases == 1 && frame.has(TELEINFO_FIELD_PAPP) && power::value > 0;
+}
+
+deciamps_t power::headroom(const teleinfo_t &frame, const uint8_t percentage) {
+    // subscribed power in VA
+    uint32_t perAmp = teleinfo::getMode() == TELEINFO_MODE_STANDARD ? POWER_STANDARD_VA_PER_AMP : POWER_NOMINAL_VOLTAGE;
+    int32_t subscribed = (uint32_t)frame.ISOUSC * perAmp * percentage / 100;
+
+    // VA * 10 deciamps per Amp / V, rounded down
+    int32_t available = subscribed - (int32_t)power::filtered();
+    int32_t headroom = available * DECIAMPS_PER_AMP / POWER_NOMINAL_VOLTAGE;
+    if (available < 0 && headroom * POWER_NOMINAL_VOLTAGE != available * DECIAMPS_PER_AMP) {
+        headroom--;
+    }
+
+    // the meter cuts on the current, whatever the voltage
+    if (teleinfo::getMode() == TELEINFO_MODE_HISTORIC && frame.has(TELEINFO_FIELD_IINST)) {
+        int32_t currentHeadroom = (int32_t)frame.ISOUSC * percentage / 10 - (int32_t)frame.IINST * DECIAMPS_PER_AMP;
+        if (currentHeadroom < headroom) {
+            headroom = currentHeadroom;
+        }
+    }
+
+    return headroom;
+}
+
+uint32_t power::filtered() {
+    return power::value >> POWER_FILTER_SHIFT;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "teleinfo/teleinfo.h"
+#include "viridian/viridian.h"
+
+// Headroom in the power domain: the subscribed power minus the apparent power PAPP, converted into
+// the current of the charger with the nominal voltage
+// PAPP has a 10 VA resolution (about 0.05A), where ISOUSC and IINST are whole Amps, so the charge
+// can run closer to the subscription and the headroom no longer flaps on the rounding of IINST
+// PAPP is filtered across frames: a rise is taken at once, a fall is smoothed, so the noise of the
+// meter cannot trigger increases the next frame would take back
+// only used on single-phase meters, where PAPP is the power of the phase of the charger:
+// the current headroom is used on three-phase meters, and on frames without PAPP
+
+// power headroom, set to 1 to compute the headroom from PAPP
+#ifndef POWER_HEADROOM
+#define POWER_HEADROOM 0
+#endif
+
+// nominal voltage to convert the power into a current, in V
+// historic meters cut on the current: on a sagging mains, PAPP converted at the nominal voltage is below
+// the current, so the headroom is capped by the one of IINST in historic mode
+#ifndef POWER_NOMINAL_VOLTAGE
+#define POWER_NOMINAL_VOLTAGE 230
+#endif
+
+// subscribed power of the standard mode, per Amp of ISOUSC (VA): PREF (kVA) is mapped on ISOUSC * 5
+// historic meters cut on the current: ISOUSC * the nominal voltage is used instead
+static const uint16_t POWER_STANDARD_VA_PER_AMP = 1000 / TELEINFO_STANDARD_AMPS_PER_KVA;
+
+// filtered power in 1/16 VA, a fall of PAPP is taken with a 1/4 weight
+static const uint8_t POWER_FILTER_SHIFT = 4;
+static const uint8_t POWER_FILTER_FALL_SHIFT = 2;
+
+class power {
+    public:
+        // to be called on each valid frame
+        static void onFrame(const teleinfo_t &frame);
+
+        // the headroom of the frame can be computed from the power
+        static bool available(const teleinfo_t &frame);
+
+        // subscribed power * percentage / 100 - filtered PAPP, in deciamps at the nominal voltage
+        // in historic mode, no more than ISOUSC * percentage / 100 - IINST
+        static deciamps_t headroom(const teleinfo_t &frame, const uint8_t percentage);
+
+        // filtered apparent power (VA)
+        static uint32_t filtered();
+
+    private:
+        // filtered power in 1/16 VA, 0 until the first frame with PAPP
+        static uint32_t value;
+};
@@ -0,0 +1,169 @@
+#include <Arduino.h>
+
+#include "logger/logger.h"
+
+#include "profiler.h"
+
+#if PROFILER_ENABLED
+
+static_assert(PROFILER_BUCKETS == 16, "the histogram log message has 16 buckets");
+
+#define PROFILER_STAGE_NAME(id, name) name,
+static const char* const PROFILER_STAGE_NAMES[PROFILER_STAGE_COUNT] = {
+    PROFILER_STAGES(PROFILER_STAGE_NAME)
+};
+#undef PROFILER_STAGE_NAME
+
+static const char* const PROFILER_HISTOGRAM_NAMES[PROFILER_HISTOGRAM_COUNT] = { "loop", "ADPS to DAC" };
+
+// room needed in the logger for the longest line, the histogram
+static const uint8_t PROFILER_REPORT_LINE_SIZE = LOGGER_MESSAGE_OVERHEAD + 1 + 2 + LOGGER_STRING_MAX_LENGTH + PROFILER_BUCKETS * 3;
+
+#if defined(__AVR__)
+// end of the static variables, and of the heap if it is used
+extern uint8_t __heap_start;
+extern uint8_t* __brkval;
+
+static uint8_t* profiler_stackBottom() {
+    return __brkval != NULL ? __brkval : &__heap_start;
+}
+#endif
+
+profiler_stats_t profiler::stats[PROFILER_STAGE_COUNT];
+uint16_t profiler::histograms[PROFILER_HISTOGRAM_COUNT][PROFILER_BUCKETS];
+uint32_t profiler::adpsTime;
+bool profiler::adpsPending;
+uint8_t profiler::reportLine;
+
+void profiler::initialize() {
+    for (uint8_t i = 0; i < PROFILER_STAGE_COUNT; i++) {
+        profiler::resetStage((profiler_stage_t)i);
+    }
+
+#if defined(__AVR__)
+    // paint the free stack, down from just below the current frame
+    uint8_t here;
+    for (uint8_t* p = profiler_stackBottom(); p < &here - PROFILER_STACK_GUARD; p++) {
+        *p = PROFILER_CANARY;
+    }
+#endif
+}
+
+void profiler::record(const profiler_stage_t stage, const uint32_t duration) {
+    profiler_stats_t &stats = profiler::stats[stage];
+    uint16_t value = duration > 0xFFFF ? 0xFFFF : duration;
+
+    // the mean is kept meaningful by stopping the count rather than wrapping the sum
+    if (stats.sum + value >= stats.sum) {
+        stats.count++;
+        stats.sum += value;
+    }
+    if (value < stats.min) {
+        stats.min = value;
+    }
+    if (value > stats.max) {
+        stats.max = value;
+    }
+
+    if (stage == PROFILER_STAGE_LOOP) {
+        profiler::addToHistogram(PROFILER_HISTOGRAM_LOOP, duration);
+    }
+}
+
+void profiler::resetStage(const profiler_stage_t stage) {
+    memset(&profiler::stats[stage], 0, sizeof(profiler_stats_t));
+    profiler::stats[stage].min = 0xFFFF;
+}
+
+void profiler::markAdps() {
+    // the first frame of an overcurrent counts
+    if (!profiler::adpsPending) {
+        profiler::adpsTime = micros();
+        profiler::adpsPending = true;
+    }
+}
+
+void profiler::markDacWrite() {
+    if (profiler::adpsPending) {
+        profiler::addToHistogram(PROFILER_HISTOGRAM_ADPS_TO_DAC, micros() - profiler::adpsTime);
+        profiler::adpsPending = false;
+    }
+}
+
+void profiler::addToHistogram(const profiler_histogram_t histogram, const uint32_t duration) {
+    // log2 of the duration
+    uint8_t bucket = 0;
+    for (uint32_t value = duration; value > 1 && bucket < PROFILER_BUCKETS - 1; value >>= 1) {
+        bucket++;
+    }
+
+    if (profiler::histograms[histogram][bucket] < 0xFFFF) {
+        profiler::histograms[histogram][bucket]++;
+    }
+}
+
+void profiler::report() {
+    profiler::reportLine = 1;
+}
+
+bool profiler::reportNext() {
+    if (profiler::reportLine == 0) {
+        return false;
+    }
+
+    // wait for the logger to send the previous lines
+    if (logger::space() < PROFILER_REPORT_LINE_SIZE) {
+        return true;
+    }
+
+    // the stages, the histograms, then the memory
+    uint8_t line = profiler::reportLine - 1;
+    profiler::reportLine++;
+
+    if (line < PROFILER_STAGE_COUNT) {
+        const profiler_stats_t &stats = profiler::stats[line];
+        if (stats.count > 0) {
+            LOG_INFO(PROFILER_STAGE, PROFILER_STAGE_NAMES[line], stats.count, stats.min, stats.sum / stats.count, stats.max);
+        }
+        profiler::resetStage((profiler_stage_t)line);
+        return true;
+    }
+    line -= PROFILER_STAGE_COUNT;
+
+    if (line < PROFILER_HISTOGRAM_COUNT) {
+        const uint16_t* buckets = profiler::histograms[line];
+        LOG_INFO(PROFILER_HISTOGRAM, PROFILER_HISTOGRAM_NAMES[line],
+            buckets[0], buckets[1], buckets[2], buckets[3], buckets[4], buckets[5], buckets[6], buckets[7],
+            buckets[8], buckets[9], buckets[10], buckets[11], buckets[12], buckets[13], buckets[14], buckets[15]);
+        return true;
+    }
+
+    LOG_INFO(PROFILER_MEMORY, profiler::freeRam(), profiler::unusedStack());
+    profiler::reportLine = 0;
+    return false;
+}
+
+uint16_t profiler::freeRam() {
+#if defined(__AVR__)
+    uint8_t here;
+    return &here - profiler_stackBottom();
+#else
+    return 0;
+#endif
+}
+
+uint16_t profiler::unusedStack() {
+#if defined(__AVR__)
+    // the stack grows down: the paint left at the bottom was never used
+    uint8_t here;
+    uint8_t* p = profiler_stackBottom();
+    while (p < &here && *p == PROFILER_CANARY) {
+        p++;
+    }
+    return p - profiler_stackBottom();
+#else
+    return 0;
+#endif
+}
+
+#endif
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Profiler of the hot paths, enabled at compile time with -D PROFILER_ENABLED=1
+// PROFILE(stage) times the rest of the enclosing block with micros() (4 us resolution on the Uno)
+// each stage keeps its number of calls and its min, mean and max duration
+// the loop and the delay from a frame with an overcurrent to the next DAC write are also kept
+// in histograms of log2 buckets, and the free RAM is measured with the part of the stack never used
+// report() sends them to the logger, one line per call to reportNext(), the stages restart after it
+// when disabled, the macros and the calls are removed
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 0
+#endif
+
+// stages: id, name
+#define PROFILER_STAGES(X) \
+    X(LOOP, "loop") \
+    X(TELEINFO, "teleinfo") \
+    X(TASKS, "tasks") \
+    X(FRAME, "frame") \
+    X(DAC, "dac") \
+    X(LOGGER, "logger")
+
+#define PROFILER_STAGE_ID(id, name) PROFILER_STAGE_##id,
+enum profiler_stage_t : uint8_t {
+    PROFILER_STAGES(PROFILER_STAGE_ID)
+    PROFILER_STAGE_COUNT
+};
+#undef PROFILER_STAGE_ID
+
+// buckets of the histograms: durations from 2^i to 2^(i+1) - 1 us, the last one is for longer ones
+static const uint8_t PROFILER_BUCKETS = 16;
+
+// value of the stack bytes painted at startup
+static const uint8_t PROFILER_CANARY = 0xC5;
+
+// bytes below the stack pointer that are not painted, for the painting function itself
+static const uint8_t PROFILER_STACK_GUARD = 32;
+
+enum profiler_histogram_t : uint8_t {
+    PROFILER_HISTOGRAM_LOOP,
+    PROFILER_HISTOGRAM_ADPS_TO_DAC,
+    PROFILER_HISTOGRAM_COUNT
+};
+
+#if PROFILER_ENABLED
+
+typedef struct profiler_stats_t profiler_stats_t;
+struct profiler_stats_t {
+    uint32_t count;
+    uint16_t min;
+    uint16_t max;
+    uint32_t sum;
+};
+
+class profiler {
+    public:
+        // paint the free stack, to be called first
+        static void initialize();
+
+        static void record(const profiler_stage_t stage, const uint32_t duration);
+        // a frame with an overcurrent was received, and the DAC was written
+        static void markAdps();
+        static void markDacWrite();
+
+        // start a report, then send its lines while it returns true
+        static void report();
+        static bool reportNext();
+
+        // bytes between the heap and the stack, now and never used by the stack since the startup
+        static uint16_t freeRam();
+        static uint16_t unusedStack();
+
+    private:
+        static void resetStage(const profiler_stage_t stage);
+        static void addToHistogram(const profiler_histogram_t histogram, const uint32_t duration);
+
+        static profiler_stats_t stats[PROFILER_STAGE_COUNT];
+        static uint16_t histograms[PROFILER_HISTOGRAM_COUNT][PROFILER_BUCKETS];
+        static uint32_t adpsTime;
+        static bool adpsPending;
+        // next line of the report, 0 when no report is running
+        static uint8_t reportLine;
+};
+
+// times the rest of the block
+class profiler_scope {
+    public:
+        profiler_scope(const profiler_stage_t stage) : stage(stage), start(micros()) {}
+        ~profiler_scope() { profiler::record(this->stage, micros() - this->start); }
+    private:
+        profiler_stage_t stage;
+        uint32_t start;
+};
+
+#define PROFILER_CONCAT(a, b) a##b
+#define PROFILER_SCOPE_NAME(line) PROFILER_CONCAT(profilerScope, line)
+#define PROFILE(stage) profiler_scope PROFILER_SCOPE_NAME(__LINE__)(PROFILER_STAGE_##stage)
+#define PROFILE_ADPS() profiler::markAdps()
+#define PROFILE_DAC_WRITE() profiler::markDacWrite()
+
+#else
+
+class profiler {
+    public:
+        static void initialize() {}
+        static void report() {}
+        static bool reportNext() { return false; }
+};
+
+#define PROFILE(stage) do {} while (0)
+#define PROFILE_ADPS() do {} while (0)
+#define PROFILE_DAC_WRITE() do {} while (0)
+
+#endif
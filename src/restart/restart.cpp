@@ -0,0 +1,110 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <avr/wdt.h>
+
+#include "logger/logger.h"
+#include "calibration/calibration.h"
+
+#include "restart.h"
+
+static_assert(CALIBRATION_EEPROM_ADDRESS + sizeof(calibration_eeprom_t) <= RESTART_EEPROM_ADDRESS, "the restart counters overlap the calibration");
+static_assert(RESTART_EEPROM_ADDRESS + RESTART_CAUSE_COUNT * sizeof(uint16_t) <= CALIBRATION_EEPROM_NEXT_ADDRESS, "the restart counters overlap the calibration of the next chargers");
+
+// saved state, in the .noinit section that the startup code does not clear
+typedef struct restart_saved_t restart_saved_t;
+struct restart_saved_t {
+    uint16_t magic;
+    restart_state_t state;
+    // successive warm restarts
+    uint8_t warmCount;
+    uint8_t checksum;
+};
+
+static restart_saved_t restart_saved __attribute__((section(".noinit")));
+
+restart_cause_t restart::_cause;
+bool restart::_warm;
+
+void restart::initialize() {
+    uint8_t flags = MCUSR;
+
+    // the flags must be cleared for the watchdog to be disabled, it stays enabled after a watchdog reset
+    MCUSR = 0;
+    wdt_disable();
+
+    // a power-on also sets the brown-out flag
+    if (flags & _BV(PORF)) {
+        restart::_cause = RESTART_CAUSE_POWER_ON;
+    } else if (flags & _BV(BORF)) {
+        restart::_cause = RESTART_CAUSE_BROWN_OUT;
+    } else if (flags & _BV(WDRF)) {
+        restart::_cause = RESTART_CAUSE_WATCHDOG;
+    } else if (flags & _BV(EXTRF)) {
+        restart::_cause = RESTART_CAUSE_EXTERNAL;
+    } else {
+        restart::_cause = RESTART_CAUSE_UNKNOWN;
+    }
+
+    // the RAM is random after a power loss, the state must also be valid
+    restart::_warm = restart::_cause != RESTART_CAUSE_POWER_ON && restart::_cause != RESTART_CAUSE_BROWN_OUT
+        && restart_saved.magic == RESTART_MAGIC && restart_saved.checksum == restart::checksum()
+        && restart_saved.warmCount < RESTART_MAX_WARM;
+
+    // a state that causes successive resets is given up
+    if (restart::_warm) {
+        restart_saved.warmCount++;
+    } else {
+        memset(&restart_saved, 0, sizeof(restart_saved));
+    }
+    restart_saved.checksum = restart::checksum();
+
+    uint16_t count;
+    int address = RESTART_EEPROM_ADDRESS + restart::_cause * sizeof(count);
+    EEPROM.get(address, count);
+    // erased EEPROM
+    if (count == 0xFFFF) {
+        count = 0;
+    }
+    EEPROM.put(address, ++count);
+
+    LOG_INFO(RESTART_CAUSE, restart::_cause, count, restart::_warm ? "warm" : "cold");
+
+    wdt_enable(RESTART_WATCHDOG_TIMEOUT);
+}
+
+restart_cause_t restart::cause() {
+    return restart::_cause;
+}
+
+bool restart::warm() {
+    return restart::_warm;
+}
+
+const restart_state_t &restart::state() {
+    return restart_saved.state;
+}
+
+void restart::save(const restart_state_t &state) {
+    wdt_reset();
+
+    restart_saved.magic = RESTART_MAGIC;
+    restart_saved.state = state;
+
+    // running for a while, the next restart is not successive
+    if (millis() > RESTART_STABLE_TIME) {
+        restart_saved.warmCount = 0;
+    }
+
+    restart_saved.checksum = restart::checksum();
+}
+
+uint8_t restart::checksum() {
+    const uint8_t* bytes = (const uint8_t*)&restart_saved;
+    uint8_t sum = 0;
+
+    // complemented, so zeroed RAM does not match
+    for (uint8_t i = 0; i < offsetof(restart_saved_t, checksum); i++) {
+        sum += bytes[i];
+    }
+    return ~sum;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Arduino.h>
+#include <avr/wdt.h>
+
+#include "viridian/viridian.h"
+
+// Restart handling
+// the cause of the reset is read from the MCU status register, and the state of the charge is kept
+// in RAM that is not cleared at startup: after a watchdog or an external reset, the charge resumes
+// with its charging current, which the DAC kept, instead of waiting as after a power-on
+// the number of resets of each cause is counted in EEPROM
+// the watchdog resets the board if loop() is stuck
+
+// EEPROM address of the counters, after the calibration of the first charger
+static const int RESTART_EEPROM_ADDRESS = 32;
+
+// watchdog timeout, see avr/wdt.h
+static const uint8_t RESTART_WATCHDOG_TIMEOUT = WDTO_2S;
+
+// successive warm restarts before the state is not trusted anymore
+static const uint8_t RESTART_MAX_WARM = 3;
+
+// uptime after which a warm restart is not considered successive (ms)
+static const uint32_t RESTART_STABLE_TIME = 60000;
+
+// value of the saved state, not likely to be found in uninitialized RAM
+static const uint16_t RESTART_MAGIC = 0x5649;
+
+enum restart_cause_t : uint8_t {
+    // the bootloader may clear the flags
+    RESTART_CAUSE_UNKNOWN,
+    RESTART_CAUSE_POWER_ON,
+    RESTART_CAUSE_EXTERNAL,
+    RESTART_CAUSE_BROWN_OUT,
+    RESTART_CAUSE_WATCHDOG,
+    RESTART_CAUSE_COUNT
+};
+
+// state of the main program, saved regularly
+typedef struct restart_state_t restart_state_t;
+struct restart_state_t {
+    uint8_t state;
+    uint8_t policy;
+    uint32_t sessionCharge;
+    // charging current of each charger
+    deciamps_t current[VIRIDIAN_CHARGERS];
+};
+
+class restart {
+    public:
+        // read the cause of the reset and the saved state, then start the watchdog
+        // to be called first
+        static void initialize();
+
+        static restart_cause_t cause();
+        // true if the saved state can be resumed: warm restart, and not too many of them in a row
+        static bool warm();
+        static const restart_state_t &state();
+
+        // save the state and reset the watchdog, to be called regularly
+        static void save(const restart_state_t &state);
+
+    private:
+        static uint8_t checksum();
+
+        static restart_cause_t _cause;
+        static bool _warm;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Lock-free ring buffer for a single producer and a single consumer
+// typically an interrupt pushing and the main program popping
+// the producer only writes head, the consumer only writes tail, both are 8 bits so their access is atomic
+// one slot is kept free to tell a full buffer from an empty one
+template <typename T, uint8_t SIZE>
+class ring_buffer {
+    static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "ring_buffer size must be a power of two");
+
+    public:
+        ring_buffer() : _head(0), _tail(0) {}
+
+        // producer side: returns false if the buffer is full
+        bool push(const T value) {
+            uint8_t head = _head;
+            uint8_t next = (head + 1) & (SIZE - 1);
+
+            if (next == _tail) {
+                return false;
+            }
+
+            _buffer[head] = value;
+            _head = next;
+            return true;
+        }
+
+        // consumer side: returns false if the buffer is empty
+        bool pop(T &value) {
+            uint8_t tail = _tail;
+
+            if (tail == _head) {
+                return false;
+            }
+
+            value = _buffer[tail];
+            _tail = (tail + 1) & (SIZE - 1);
+            return true;
+        }
+
+        // consumer side: number of values that can be popped
+        uint8_t available() const {
+            return (_head - _tail) & (SIZE - 1);
+        }
+
+        // producer side: number of values that can be pushed
+        uint8_t space() const {
+            return (SIZE - 1) - available();
+        }
+
+        // consumer side: drop all the values
+        void clear() {
+            _tail = _head;
+        }
+
+    private:
+        volatile T _buffer[SIZE];
+        volatile uint8_t _head;
+        volatile uint8_t _tail;
+};
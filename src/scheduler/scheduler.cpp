@@ -0,0 +1,183 @@
+#include <Arduino.h>
+
+#include "profiler/profiler.h"
+
+#include "scheduler.h"
+
+static_assert((SCHEDULER_WHEEL_SLOTS & (SCHEDULER_WHEEL_SLOTS - 1)) == 0, "SCHEDULER_WHEEL_SLOTS must be a power of two");
+static_assert(SCHEDULER_MAX_TASKS <= 8, "the ready and scheduled masks are on 8 bits");
+
+scheduler_callback_t scheduler::callbacks[SCHEDULER_MAX_TASKS];
+uint32_t scheduler::deadlines[SCHEDULER_MAX_TASKS];
+uint32_t scheduler::periods[SCHEDULER_MAX_TASKS];
+uint8_t scheduler::next[SCHEDULER_MAX_TASKS];
+uint8_t scheduler::wheel[SCHEDULER_WHEEL_SLOTS];
+
+uint8_t scheduler::taskCount;
+uint8_t scheduler::scheduled;
+uint8_t scheduler::ready;
+uint32_t scheduler::currentTick;
+uint32_t scheduler::tick;
+uint32_t scheduler::tickStart;
+
+void scheduler::initialize() {
+    scheduler::taskCount = 0;
+    scheduler::scheduled = 0;
+    scheduler::ready = 0;
+    memset(scheduler::wheel, SCHEDULER_NO_TASK, SCHEDULER_WHEEL_SLOTS);
+    scheduler::tick = 0;
+    scheduler::tickStart = millis();
+    scheduler::currentTick = 0;
+}
+
+scheduler_task_t scheduler::add(scheduler_callback_t callback) {
+    if (scheduler::taskCount >= SCHEDULER_MAX_TASKS) {
+        return SCHEDULER_NO_TASK;
+    }
+
+    scheduler_task_t task = scheduler::taskCount++;
+    scheduler::callbacks[task] = callback;
+    scheduler::periods[task] = 0;
+
+    return task;
+}
+
+void scheduler::runIn(const scheduler_task_t task, const uint32_t delayMS) {
+    scheduler::cancel(task);
+    scheduler::periods[task] = 0;
+    scheduler::schedule(task, scheduler::now() + scheduler::toTicks(delayMS));
+}
+
+void scheduler::runEvery(const scheduler_task_t task, const uint32_t periodMS) {
+    scheduler::cancel(task);
+    scheduler::periods[task] = scheduler::toTicks(periodMS);
+    scheduler::schedule(task, scheduler::now() + scheduler::periods[task]);
+}
+
+void scheduler::runNow(const scheduler_task_t task) {
+    scheduler::ready |= _BV(task);
+}
+
+void scheduler::cancel(const scheduler_task_t task) {
+    scheduler::unlink(task);
+    scheduler::periods[task] = 0;
+    scheduler::ready &= ~_BV(task);
+}
+
+bool scheduler::isScheduled(const scheduler_task_t task) {
+    return (scheduler::scheduled | scheduler::ready) & _BV(task);
+}
+
+void scheduler::run() {
+    PROFILE(TASKS);
+    uint32_t nowTick = scheduler::now();
+
+    if (nowTick - scheduler::currentTick >= SCHEDULER_WHEEL_SLOTS) {
+        // late by a whole turn of the wheel: every slot has to be checked anyway
+        for (scheduler_task_t task = 0; task < scheduler::taskCount; task++) {
+            if ((scheduler::scheduled & _BV(task)) && (int32_t)(scheduler::deadlines[task] - nowTick) <= 0) {
+                scheduler::expire(task);
+            }
+        }
+        scheduler::currentTick = nowTick + 1;
+    } else {
+        // check the slot of each tick since the last run
+        while ((int32_t)(nowTick - scheduler::currentTick) >= 0) {
+            uint8_t task = scheduler::wheel[scheduler::currentTick & (SCHEDULER_WHEEL_SLOTS - 1)];
+            while (task != SCHEDULER_NO_TASK) {
+                uint8_t nextTask = scheduler::next[task];
+                // the slot also holds the deadlines of the next turns of the wheel
+                if ((int32_t)(scheduler::deadlines[task] - scheduler::currentTick) <= 0) {
+                    scheduler::expire(task);
+                }
+                task = nextTask;
+            }
+            scheduler::currentTick++;
+        }
+    }
+
+    // run the ready tasks, they may schedule tasks again
+    for (scheduler_task_t task = 0; task < scheduler::taskCount; task++) {
+        if (scheduler::ready & _BV(task)) {
+            scheduler::ready &= ~_BV(task);
+            scheduler::callbacks[task]();
+        }
+    }
+}
+
+uint32_t scheduler::idleTime() {
+    if (scheduler::ready) {
+        return 0;
+    }
+
+    uint32_t nowTick = scheduler::now();
+    // time already spent in the current tick
+    uint32_t elapsed = millis() - scheduler::tickStart;
+    uint32_t idle = 0xFFFFFFFF;
+    for (scheduler_task_t task = 0; task < scheduler::taskCount; task++) {
+        if (scheduler::scheduled & _BV(task)) {
+            // the task runs once the tick counter reaches its deadline
+            int32_t ticks = (int32_t)(scheduler::deadlines[task] - nowTick);
+            if (ticks <= 0) {
+                return 0;
+            }
+            uint32_t remaining = (uint32_t)ticks * SCHEDULER_TICK_MS - elapsed;
+            if (remaining < idle) {
+                idle = remaining;
+            }
+        }
+    }
+
+    return idle;
+}
+
+void scheduler::schedule(const scheduler_task_t task, const uint32_t deadline) {
+    uint8_t slot = deadline & (SCHEDULER_WHEEL_SLOTS - 1);
+
+    scheduler::deadlines[task] = deadline;
+    scheduler::next[task] = scheduler::wheel[slot];
+    scheduler::wheel[slot] = task;
+    scheduler::scheduled |= _BV(task);
+}
+
+void scheduler::unlink(const scheduler_task_t task) {
+    if (!(scheduler::scheduled & _BV(task))) {
+        return;
+    }
+
+    uint8_t* link = &scheduler::wheel[scheduler::deadlines[task] & (SCHEDULER_WHEEL_SLOTS - 1)];
+    while (*link != task) {
+        link = &scheduler::next[*link];
+    }
+    *link = scheduler::next[task];
+    scheduler::scheduled &= ~_BV(task);
+}
+
+void scheduler::expire(const scheduler_task_t task) {
+    scheduler::unlink(task);
+    scheduler::ready |= _BV(task);
+
+    // periodic tasks are scheduled again right away, without drifting
+    if (scheduler::periods[task] > 0) {
+        uint32_t deadline = scheduler::deadlines[task] + scheduler::periods[task];
+        uint32_t nowTick = scheduler::now();
+        if ((int32_t)(deadline - nowTick) <= 0) {
+            deadline = nowTick + scheduler::periods[task];
+        }
+        scheduler::schedule(task, deadline);
+    }
+}
+
+uint32_t scheduler::toTicks(const uint32_t durationMS) {
+    // round up, and at least one tick so a task never runs in the tick it was scheduled
+    uint32_t ticks = (durationMS + SCHEDULER_TICK_MS - 1) / SCHEDULER_TICK_MS;
+    return ticks > 0 ? ticks : 1;
+}
+
+uint32_t scheduler::now() {
+    // the difference of millis() is right across its wrap, the remainder is carried to the next tick
+    uint32_t ticks = (uint32_t)(millis() - scheduler::tickStart) / SCHEDULER_TICK_MS;
+    scheduler::tick += ticks;
+    scheduler::tickStart += ticks * SCHEDULER_TICK_MS;
+    return scheduler::tick;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Cooperative scheduler: tasks are plain functions run from loop() by scheduler::run()
+// deadlines are kept in a timer wheel: each slot holds the tasks whose deadline tick
+// falls in it, so a tick only looks at the tasks of one slot
+// a task can be one-shot, periodic, or run as soon as possible after an event
+// the ticks are counted from the differences of millis(), so they go on across its wrap (every 49.7 days)
+
+// resolution of the deadlines in ms
+static const uint16_t SCHEDULER_TICK_MS = 10;
+// number of slots of the timer wheel (power of two)
+static const uint8_t SCHEDULER_WHEEL_SLOTS = 16;
+// maximum number of tasks (one bit each in the ready mask)
+static const uint8_t SCHEDULER_MAX_TASKS = 8;
+// returned by add() when there is no task left
+static const uint8_t SCHEDULER_NO_TASK = 0xFF;
+
+typedef void (*scheduler_callback_t)();
+typedef uint8_t scheduler_task_t;
+
+class scheduler {
+    public:
+        static void initialize();
+
+        // create a task, not scheduled yet
+        static scheduler_task_t add(scheduler_callback_t callback);
+
+        // run the task once after delayMS
+        static void runIn(const scheduler_task_t task, const uint32_t delayMS);
+        // run the task every periodMS, the first time after periodMS
+        static void runEvery(const scheduler_task_t task, const uint32_t periodMS);
+        // run the task at the next call to run(), e.g. after an event
+        static void runNow(const scheduler_task_t task);
+        // remove the pending deadline and run of the task
+        static void cancel(const scheduler_task_t task);
+        static bool isScheduled(const scheduler_task_t task);
+
+        // run the tasks that are due, to be called from loop()
+        static void run();
+
+        // time in ms until the next deadline, 0 if a task is ready, 0xFFFFFFFF if none is scheduled
+        // a host can skip the idle time up to it
+        static uint32_t idleTime();
+    private:
+        static void schedule(const scheduler_task_t task, const uint32_t deadline);
+        static void unlink(const scheduler_task_t task);
+        static void expire(const scheduler_task_t task);
+        static uint32_t toTicks(const uint32_t durationMS);
+        static uint32_t now();
+
+        static scheduler_callback_t callbacks[SCHEDULER_MAX_TASKS];
+        static uint32_t deadlines[SCHEDULER_MAX_TASKS];
+        static uint32_t periods[SCHEDULER_MAX_TASKS];
+        // linked list of the tasks in the same slot
+        static uint8_t next[SCHEDULER_MAX_TASKS];
+        static uint8_t wheel[SCHEDULER_WHEEL_SLOTS];
+
+        static uint8_t taskCount;
+        static uint8_t scheduled;
+        static uint8_t ready;
+        static uint32_t currentTick;
+        // free running tick counter, and millis() at the start of its tick
+        static uint32_t tick;
+        static uint32_t tickStart;
+};
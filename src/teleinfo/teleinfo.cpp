@@ -1,94 +1,205 @@
 #include <Arduino.h>
 
-#include <SoftwareSerial.h>
-
-#include "debug/debug.h"
+#include "logger/logger.h"
+#include "profiler/profiler.h"
+#include "tic_receiver/tic_receiver.h"
 
 #include "teleinfo.h"
 
+// type and max length of a teleinfo_t field
+template <typename T> struct teleinfo_field;
+template <size_t N> struct teleinfo_field<char[N]> {
+    static const teleinfo_type_t type = TELEINFO_TYPE_STRING;
+    static const uint8_t maxLength = N - 1;
+};
+template <> struct teleinfo_field<char> {
+    static const teleinfo_type_t type = TELEINFO_TYPE_CHAR;
+    static const uint8_t maxLength = 1;
+};
+template <> struct teleinfo_field<uint8_t> {
+    static const teleinfo_type_t type = TELEINFO_TYPE_UINT8;
+    static const uint8_t maxLength = 3;
+};
+template <> struct teleinfo_field<uint32_t> {
+    static const teleinfo_type_t type = TELEINFO_TYPE_UINT32;
+    static const uint8_t maxLength = 9;
+};
+
+// the offsets in teleinfo_t are stored on 8 bits
+static_assert(sizeof(teleinfo_t) <= 0xFF, "teleinfo_t is too large for 8 bits offsets");
+
+// hash of a label, same computation as the one done while receiving it
+constexpr uint8_t teleinfo_hash(const char* label, uint8_t slots, uint8_t hash = 0) {
+    return *label == '\0' ? hash & (slots - 1) : teleinfo_hash(label + 1, slots, (uint8_t)(hash * TELEINFO_HASH_MULTIPLIER + *label));
+}
+
+// index of the first label in a hash slot
+constexpr uint8_t teleinfo_slot(const char* const* names, uint8_t count, uint8_t slots, uint8_t slot, uint8_t index = 0) {
+    return index == count ? TELEINFO_LABEL_UNKNOWN : teleinfo_hash(names[index], slots) == slot ? index : teleinfo_slot(names, count, slots, slot, index + 1);
+}
+
+// the hash is perfect if every label is the first one in its slot
+constexpr bool teleinfo_perfectHash(const char* const* names, uint8_t count, uint8_t slots, uint8_t index = 0) {
+    return index == count || (teleinfo_slot(names, count, slots, teleinfo_hash(names[index], slots)) == index && teleinfo_perfectHash(names, count, slots, index + 1));
+}
+
+// hash slot -> label index, 8 slots at a time
+#define TELEINFO_SLOT_8(names, slots, n) \
+    teleinfo_slot(names, sizeof(names) / sizeof(names[0]), slots, n), \
+    teleinfo_slot(names, sizeof(names) / sizeof(names[0]), slots, n + 1), \
+    teleinfo_slot(names, sizeof(names) / sizeof(names[0]), slots, n + 2), \
+    teleinfo_slot(names, sizeof(names) / sizeof(names[0]), slots, n + 3), \
+    teleinfo_slot(names, sizeof(names) / sizeof(names[0]), slots, n + 4), \
+    teleinfo_slot(names, sizeof(names) / sizeof(names[0]), slots, n + 5), \
+    teleinfo_slot(names, sizeof(names) / sizeof(names[0]), slots, n + 6), \
+    teleinfo_slot(names, sizeof(names) / sizeof(names[0]), slots, n + 7)
+
+// description of a label recorded in the field of the same name
+#define TELEINFO_LABEL_ENTRY(field, type, size) TELEINFO_LABEL_MAPPED_ENTRY(field, field, 1)
+// description of a label recorded in another field, with a multiplier for numbers
+#define TELEINFO_LABEL_MAPPED_ENTRY(label, field, multiplier) { \
+    #label, \
+    offsetof(teleinfo_t, field), \
+    teleinfo_field<decltype(teleinfo_t::field)>::type, \
+    teleinfo_field<decltype(teleinfo_t::field)>::maxLength, \
+    TELEINFO_FIELD_##field, \
+    multiplier },
+
+// label names, only used at compile time to build the hash tables
+#define TELEINFO_LABEL_NAME(label, type, size) #label,
+#define TELEINFO_LABEL_MAPPED_NAME(label, field, multiplier) #label,
+
+// historic mode tables
+static constexpr const char* TELEINFO_HISTORIC_LABEL_NAMES[] = { TELEINFO_FIELDS(TELEINFO_LABEL_NAME) };
+static_assert(teleinfo_perfectHash(TELEINFO_HISTORIC_LABEL_NAMES, sizeof(TELEINFO_HISTORIC_LABEL_NAMES) / sizeof(TELEINFO_HISTORIC_LABEL_NAMES[0]), TELEINFO_HISTORIC_HASH_SLOTS),
+    "collision in the historic label hash: change TELEINFO_HASH_MULTIPLIER or TELEINFO_HISTORIC_HASH_SLOTS");
+static const teleinfo_label_t TELEINFO_HISTORIC_LABEL_TABLE[] PROGMEM = { TELEINFO_FIELDS(TELEINFO_LABEL_ENTRY) };
+static_assert(TELEINFO_HISTORIC_HASH_SLOTS == 128, "the historic slot table must be filled for every slot");
+static const uint8_t TELEINFO_HISTORIC_SLOT_TABLE[TELEINFO_HISTORIC_HASH_SLOTS] PROGMEM = {
+    TELEINFO_SLOT_8(TELEINFO_HISTORIC_LABEL_NAMES, TELEINFO_HISTORIC_HASH_SLOTS, 0),
+    TELEINFO_SLOT_8(TELEINFO_HISTORIC_LABEL_NAMES, TELEINFO_HISTORIC_HASH_SLOTS, 8),
+    TELEINFO_SLOT_8(TELEINFO_HISTORIC_LABEL_NAMES, TELEINFO_HISTORIC_HASH_SLOTS, 16),
+    TELEINFO_SLOT_8(TELEINFO_HISTORIC_LABEL_NAMES, TELEINFO_HISTORIC_HASH_SLOTS, 24),
+    TELEINFO_SLOT_8(TELEINFO_HISTORIC_LABEL_NAMES, TELEINFO_HISTORIC_HASH_SLOTS, 32),
+    TELEINFO_SLOT_8(TELEINFO_HISTORIC_LABEL_NAMES, TELEINFO_HISTORIC_HASH_SLOTS, 40),
+    TELEINFO_SLOT_8(TELEINFO_HISTORIC_LABEL_NAMES, TELEINFO_HISTORIC_HASH_SLOTS, 48),
+    TELEINFO_SLOT_8(TELEINFO_HISTORIC_LABEL_NAMES, TELEINFO_HISTORIC_HASH_SLOTS, 56),
+    TELEINFO_SLOT_8(TELEINFO_HISTORIC_LABEL_NAMES, TELEINFO_HISTORIC_HASH_SLOTS, 64),
+    TELEINFO_SLOT_8(TELEINFO_HISTORIC_LABEL_NAMES, TELEINFO_HISTORIC_HASH_SLOTS, 72),
+    TELEINFO_SLOT_8(TELEINFO_HISTORIC_LABEL_NAMES, TELEINFO_HISTORIC_HASH_SLOTS, 80),
+    TELEINFO_SLOT_8(TELEINFO_HISTORIC_LABEL_NAMES, TELEINFO_HISTORIC_HASH_SLOTS, 88),
+    TELEINFO_SLOT_8(TELEINFO_HISTORIC_LABEL_NAMES, TELEINFO_HISTORIC_HASH_SLOTS, 96),
+    TELEINFO_SLOT_8(TELEINFO_HISTORIC_LABEL_NAMES, TELEINFO_HISTORIC_HASH_SLOTS, 104),
+    TELEINFO_SLOT_8(TELEINFO_HISTORIC_LABEL_NAMES, TELEINFO_HISTORIC_HASH_SLOTS, 112),
+    TELEINFO_SLOT_8(TELEINFO_HISTORIC_LABEL_NAMES, TELEINFO_HISTORIC_HASH_SLOTS, 120)
+};
+
+// standard mode tables
+static constexpr const char* TELEINFO_STANDARD_LABEL_NAMES[] = { TELEINFO_STANDARD_LABELS(TELEINFO_LABEL_MAPPED_NAME) };
+static_assert(teleinfo_perfectHash(TELEINFO_STANDARD_LABEL_NAMES, sizeof(TELEINFO_STANDARD_LABEL_NAMES) / sizeof(TELEINFO_STANDARD_LABEL_NAMES[0]), TELEINFO_STANDARD_HASH_SLOTS),
+    "collision in the standard label hash: change TELEINFO_HASH_MULTIPLIER or TELEINFO_STANDARD_HASH_SLOTS");
+static const teleinfo_label_t TELEINFO_STANDARD_LABEL_TABLE[] PROGMEM = { TELEINFO_STANDARD_LABELS(TELEINFO_LABEL_MAPPED_ENTRY) };
+static_assert(TELEINFO_STANDARD_HASH_SLOTS == 16, "the standard slot table must be filled for every slot");
+static const uint8_t TELEINFO_STANDARD_SLOT_TABLE[TELEINFO_STANDARD_HASH_SLOTS] PROGMEM = {
+    TELEINFO_SLOT_8(TELEINFO_STANDARD_LABEL_NAMES, TELEINFO_STANDARD_HASH_SLOTS, 0),
+    TELEINFO_SLOT_8(TELEINFO_STANDARD_LABEL_NAMES, TELEINFO_STANDARD_HASH_SLOTS, 8)
+};
+
 char teleinfo::labelBuffer[TELEINFO_LABEL_BUFFER_SIZE];
 char teleinfo::valueBuffer[TELEINFO_VALUE_BUFFER_SIZE];
 
-// Use same pin for RX and TX since we will not send data
-SoftwareSerial sSerial(TELEINFO_INPUT_PIN, TELEINFO_INPUT_PIN);
+teleinfo::state_t teleinfo::state;
+teleinfo_mode_t teleinfo::mode;
+uint32_t teleinfo::lastLineTime;
+uint8_t teleinfo::counter;
+uint8_t teleinfo::cks;
+uint8_t teleinfo::lineCks;
+uint8_t teleinfo::labelHash;
+uint8_t teleinfo::labelIndex;
+const teleinfo_label_t* teleinfo::label;
+teleinfo_type_t teleinfo::labelType;
+uint8_t teleinfo::labelMaxLength;
+uint32_t teleinfo::numericValue;
+bool teleinfo::valueValid;
+uint8_t teleinfo::frameErrors;
+
+teleinfo_t teleinfo::frames[2];
+uint8_t teleinfo::frontFrame;
+uint16_t teleinfo::sequence;
+uint32_t teleinfo::frameTime;
+
+teleinfo_field_t teleinfo::subscribedFields[TELEINFO_MAX_SUBSCRIBERS];
+teleinfo_callback_t teleinfo::subscribers[TELEINFO_MAX_SUBSCRIBERS];
+uint8_t teleinfo::subscriberCount;
 
 void teleinfo::initialize() {
     // clear the buffer
     teleinfo::clearBuffer();
 
-    // start Serial
-    sSerial.begin(1200);
+    // start with the historic mode, the standard one will be tried if no line is received
+    teleinfo::setMode(TELEINFO_MODE_HISTORIC);
 }
 
-teleinfo_t teleinfo::read() {
-    // structure for the return
-    teleinfo_t result;
+void teleinfo::setMode(const teleinfo_mode_t mode) {
+    teleinfo::mode = mode;
 
-    // Begin by flushing the serial interface
-    while (sSerial.available())
-        sSerial.read();
-    debug::log(F("teleinfo: sSerial.flushed"));
+    // wait for the start of a frame
+    teleinfo::state = TELEINFO_STATE_WAIT_FRAME;
+    teleinfo::lastLineTime = millis();
 
-    // Find the end of the ongoing teleinfo frame
-    do {
-        // try to read a line            
-        if (!teleinfo::readLine()) {
-            // if for some reason it failed, log so
-            debug::log(F("teleinfo: impossible to synchronize with start of teleinfo frame"));
+    // start the receiver at the speed of the mode
+    if (mode == TELEINFO_MODE_HISTORIC) {
+        LOG_INFO(TELEINFO_LISTENING_HISTORIC);
+        tic_receiver::begin(TELEINFO_HISTORIC_SPEED);
+    } else {
+        LOG_INFO(TELEINFO_LISTENING_STANDARD);
+        tic_receiver::begin(TELEINFO_STANDARD_SPEED);
+    }
+}
 
-            // and return the (empty) teleinfo data
-            return result;
-        }
-    } while (strcmp(teleinfo::labelBuffer, "MOTDETAT") != 0);
-    debug::log(F("teleinfo: found end of teleinfo frame"));
-
-    // we are at the start of a frame
-    do {
-        if (teleinfo::readLine()) {                
-            // try to match the label with all available labels
-            if (record("ADCO", result.ADCO)) continue;
-            if (record("OPTARIF", result.OPTARIF)) continue;
-            if (record("ISOUSC", result.ISOUSC)) continue;
-            if (record("PTEC", result.PTEC)) continue;
-            if (record("IINST", result.IINST)) continue;
-            if (record("IINST1", result.IINST1)) continue;
-            if (record("IINST2", result.IINST2)) continue;
-            if (record("IINST3", result.IINST3)) continue;
-            if (record("ADPS", result.ADPS)) continue;
-            if (record("IMAX", result.IMAX)) continue;
-            if (record("IMAX1", result.IMAX1)) continue;
-            if (record("IMAX2", result.IMAX2)) continue;
-            if (record("IMAX3", result.IMAX3)) continue;
-            if (record("PAPP", result.PAPP)) continue;
-            if (record("PMAX", result.PMAX)) continue;
-            if (record("BASE", result.BASE)) continue;
-            if (record("HCHC", result.HCHC)) continue;
-            if (record("HCHP", result.HCHP)) continue;
-            if (record("EJP_HN", result.EJP_HN)) continue;
-            if (record("EJP_HPM", result.EJP_HPM)) continue;
-            if (record("PEJP", result.PEJP)) continue;
-            if (record("BBR_HC_JB", result.BBR_HC_JB)) continue;
-            if (record("BBR_HP_JB", result.BBR_HP_JB)) continue;
-            if (record("BBR_HC_JW", result.BBR_HC_JW)) continue;
-            if (record("BBR_HP_JW", result.BBR_HP_JW)) continue;
-            if (record("BBR_HC_JR", result.BBR_HC_JR)) continue;
-            if (record("BBR_HP_JR", result.BBR_HP_JR)) continue;
-            if (record("DEMAIN", result.DEMAIN)) continue;
-            if (record("HHPHC", &result.HHPHC)) continue;
-            if (record("MOTDETAT", result.MOTDETAT)) continue;
-
-            // no match: probably an unknow label ?
-            debug::logNoLine(F("teleinfo: Unknown label found - label: "));
-            debug::logNoLine(String(teleinfo::labelBuffer));
-            debug::logNoLine(F(" - value: "));
-            debug::log(String(teleinfo::valueBuffer));
-        } else {
-            debug::log(F("teleinfo: read failed"));
-        }
-    } while (strcmp(teleinfo::labelBuffer, "MOTDETAT") != 0);
+teleinfo_mode_t teleinfo::getMode() {
+    return teleinfo::mode;
+}
+
+bool teleinfo::process() {
+    PROFILE(TELEINFO);
+    bool published = false;
+
+    // without any valid line for a while, the meter is most likely in the other mode
+    if (millis() - teleinfo::lastLineTime >= TELEINFO_DETECT_DURATION) {
+        teleinfo::setMode(teleinfo::mode == TELEINFO_MODE_HISTORIC ? TELEINFO_MODE_STANDARD : TELEINFO_MODE_HISTORIC);
+    }
+
+    // consume everything that was received since the last call
+    while (tic_receiver::available()) {
+        published |= teleinfo::processChar(teleinfo::readChar());
+    }
+
+    return published;
+}
+
+const teleinfo_t& teleinfo::read() {
+    // the front frame is only swapped by process(), so it is stable until the next call
+    return teleinfo::frames[teleinfo::frontFrame];
+}
 
-    // return the result (at the end)
-    return result;
+uint16_t teleinfo::frameSequence() {
+    return teleinfo::sequence;
+}
+
+uint32_t teleinfo::frameAge() {
+    return millis() - teleinfo::frameTime;
+}
+
+bool teleinfo::subscribe(const teleinfo_field_t field, teleinfo_callback_t callback) {
+    if (teleinfo::subscriberCount >= TELEINFO_MAX_SUBSCRIBERS) {
+        return false;
+    }
+
+    teleinfo::subscribedFields[teleinfo::subscriberCount] = field;
+    teleinfo::subscribers[teleinfo::subscriberCount] = callback;
+    teleinfo::subscriberCount++;
+    return true;
 }
 
 void teleinfo::clearBuffer() {
@@ -96,134 +207,318 @@ void teleinfo::clearBuffer() {
     memset( teleinfo::valueBuffer, '\0', TELEINFO_VALUE_BUFFER_SIZE);
 }
 
-bool teleinfo::readLine() {
-    uint8_t cks = 32;
-    uint8_t messageCks;
-    uint32_t timeoutStart;
+bool teleinfo::processChar(const char c) {
+    // frame delimiters are handled whatever the state
+    switch (c) {
+        case TELEINFO_STX:
+            teleinfo::startFrame();
+            return false;
+        case TELEINFO_ETX:
+            return teleinfo::endFrame();
+        case TELEINFO_EOT:
+            // the meter interrupted the frame, drop it
+            LOG_WARNING(TELEINFO_FRAME_INTERRUPTED);
+            teleinfo::state = TELEINFO_STATE_WAIT_FRAME;
+            return false;
+        case TELEINFO_LF:
+            // start of a line, the previous one should have been ended
+            if (teleinfo::state != TELEINFO_STATE_WAIT_FRAME) {
+                if (teleinfo::state != TELEINFO_STATE_WAIT_LINE) {
+                    teleinfo::lineError();
+                }
+                teleinfo::clearBuffer();
+                teleinfo::counter = 0;
+                teleinfo::cks = 0;
+                teleinfo::labelHash = 0;
+                teleinfo::state = TELEINFO_STATE_LABEL;
+            }
+            return false;
+    }
 
-    // clear the buffer
-    teleinfo::clearBuffer();
+    const char separator = (teleinfo::mode == TELEINFO_MODE_HISTORIC) ? TELEINFO_HISTORIC_SEPARATOR : TELEINFO_STANDARD_SEPARATOR;
+
+    switch (teleinfo::state) {
+        case TELEINFO_STATE_LABEL:
+            if (c == separator) {
+                // the separator between label and value is part of the checksum
+                teleinfo::cks += (uint8_t)c;
+                teleinfo::findLabel();
+                teleinfo::startField();
+                teleinfo::state = (teleinfo::mode == TELEINFO_MODE_HISTORIC) ? TELEINFO_STATE_VALUE : TELEINFO_STATE_FIELD_START;
+            } else if (teleinfo::counter < TELEINFO_LABEL_BUFFER_SIZE - 1) {
+                teleinfo::labelBuffer[teleinfo::counter++] = c;
+                teleinfo::labelHash = teleinfo::labelHash * TELEINFO_HASH_MULTIPLIER + c;
+                teleinfo::cks += (uint8_t)c;
+            } else {
+                teleinfo::lineError();
+            }
+            break;
+        case TELEINFO_STATE_VALUE:
+            if (c == separator) {
+                if (teleinfo::mode == TELEINFO_MODE_HISTORIC) {
+                    // the separator before the checksum is not part of it
+                    teleinfo::state = TELEINFO_STATE_CHECKSUM;
+                } else {
+                    // in standard mode, it is: the next field may be the checksum or the value after a date
+                    teleinfo::cks += (uint8_t)c;
+                    teleinfo::state = TELEINFO_STATE_FIELD_START;
+                }
+            } else if (c == TELEINFO_CR) {
+                teleinfo::lineError();
+            } else {
+                teleinfo::addChar(c);
+            }
+            break;
+        case TELEINFO_STATE_FIELD_START:
+            if (c == separator) {
+                // empty field
+                teleinfo::cks += (uint8_t)c;
+                teleinfo::startField();
+            } else if (c == TELEINFO_CR) {
+                teleinfo::lineError();
+            } else {
+                // this char is either the checksum, or the start of a field
+                teleinfo::lineCks = c;
+                teleinfo::state = TELEINFO_STATE_FIELD_PENDING;
+            }
+            break;
+        case TELEINFO_STATE_FIELD_PENDING:
+            if (c == TELEINFO_CR) {
+                // the pending char was the checksum, the last field is the value
+                teleinfo::endLine();
+            } else {
+                // the pending char started a new field, the previous one was a date
+                teleinfo::startField();
+                teleinfo::addChar(teleinfo::lineCks);
+                if (c == separator) {
+                    teleinfo::cks += (uint8_t)c;
+                    teleinfo::state = TELEINFO_STATE_FIELD_START;
+                } else {
+                    teleinfo::addChar(c);
+                    teleinfo::state = TELEINFO_STATE_VALUE;
+                }
+            }
+            break;
+        case TELEINFO_STATE_CHECKSUM:
+            // the checksum may be any printable char, separator included
+            teleinfo::lineCks = c;
+            teleinfo::state = TELEINFO_STATE_END_LINE;
+            break;
+        case TELEINFO_STATE_END_LINE:
+            if (c == TELEINFO_CR) {
+                teleinfo::endLine();
+            } else {
+                teleinfo::lineError();
+            }
+            break;
+        default:
+            // waiting for a frame or a line: ignore the char
+            break;
+    }
 
-    // initiate the timeout counter
-    timeoutStart = millis();
+    return false;
+}
 
-    // First make sure that we are at the end of a line
-    do {
-        while (!sSerial.available() && (millis() - timeoutStart) < TELEINFO_TIMEOUT) ;
+void teleinfo::startField() {
+    teleinfo::counter = 0;
+    teleinfo::numericValue = 0;
+    teleinfo::valueValid = true;
+    memset(teleinfo::valueBuffer, '\0', TELEINFO_VALUE_BUFFER_SIZE);
+}
 
-        // check if timeout is reached
-        if (millis() - timeoutStart >= TELEINFO_TIMEOUT) {
-            // debug that the read failed in timeout
-            debug::log(F("teleinfo: Timeout on teleinfo read"));
+void teleinfo::addChar(const char c) {
+    teleinfo::cks += (uint8_t)c;
 
-            // return it failed
-            return false;
-        }
-    } while (teleinfo::readChar() != '\n');
-
-    // First read the label
-    if (teleinfo::readWord(teleinfo::labelBuffer, TELEINFO_LABEL_BUFFER_SIZE, cks) ) {
-        debug::logNoLine(F("teleinfo: read label "));
-        debug::log(String(teleinfo::labelBuffer));
-        // Next read the value
-        if (teleinfo::readWord(teleinfo::valueBuffer, TELEINFO_VALUE_BUFFER_SIZE, cks)) {
-            debug::logNoLine(F("teleinfo: read value "));
-            debug::log(String(teleinfo::valueBuffer));
-            // Read the final cks
-            while (!sSerial.available()) ;
-            messageCks = teleinfo::readChar();
-
-            // compute our own cks
-            cks = (cks & 0x3F) + 0x20;
-
-            // return whether the cks are identical
-            return (cks==messageCks);
-        } else {
-            // log an issue
-            debug::log(F("teleinfo: error while reading a value"));
+    if (teleinfo::counter < teleinfo::labelMaxLength) {
+        teleinfo::valueBuffer[teleinfo::counter++] = c;
+
+        // convert numbers while they are received
+        if (teleinfo::labelType == TELEINFO_TYPE_UINT8 || teleinfo::labelType == TELEINFO_TYPE_UINT32) {
+            if (c >= '0' && c <= '9') {
+                teleinfo::numericValue = teleinfo::numericValue * 10 + (c - '0');
+            } else {
+                teleinfo::valueValid = false;
+            }
         }
     } else {
-        // log an issue
-        debug::log(F("teleinfo: error while reading a label"));
+        // field too long for its destination
+        teleinfo::valueValid = false;
     }
+}
 
-    // return there was an issue
-    return false;
+void teleinfo::startFrame() {
+    // restart with a blank frame in the back buffer
+    // (the constructor of teleinfo_t does not clear every field)
+    memset((void*)&teleinfo::frames[1 - teleinfo::frontFrame], 0, sizeof(teleinfo_t));
+    teleinfo::frameErrors = 0;
+    teleinfo::state = TELEINFO_STATE_WAIT_LINE;
 }
 
-inline bool teleinfo::readWord(char* buffer, uint8_t maxBufferLength, uint8_t &cks) {
-    uint8_t counter = 0;
-    char c;
+bool teleinfo::endFrame() {
+    // ignore the end of a frame that was not started
+    if (teleinfo::state == TELEINFO_STATE_WAIT_FRAME) {
+        return false;
+    }
 
-    // Read one word
-    do {
-        // wait for a char to be available
-        while (!sSerial.available()) ;
+    teleinfo::state = TELEINFO_STATE_WAIT_FRAME;
 
-        // read one char
-        c = teleinfo::readChar();
+    // a frame with invalid lines would be incomplete, so it is not published
+    if (teleinfo::frameErrors > 0) {
+        LOG_WARNING(TELEINFO_FRAME_DROPPED, teleinfo::frameErrors, tic_receiver::parityErrors(), tic_receiver::framingErrors(), tic_receiver::overruns());
+        return false;
+    }
 
-        // compute cks
-        cks += (uint8_t)c;
+    teleinfo_t &frame = teleinfo::frames[1 - teleinfo::frontFrame];
 
-        // assign to buffer (if not empty)
-        if (c != ' ')  {
-            buffer[counter++] = c;
-        }
-    } while (c != ' ' && counter < maxBufferLength);
+    // only three-phase meters send the currents of phases 2 and 3, in both modes
+    frame.phases = frame.has(TELEINFO_FIELD_IINST2) || frame.has(TELEINFO_FIELD_IINST3) ? 3 : 1;
 
-    if (c != ' ' && counter == maxBufferLength) {
-        // check for buffer overflow
-        debug::log(F("teleinfo: buffer overflow !!! buffer cleared"));
-        debug::logNoLine(F("teleinfo: buffer was "));
-        debug::log(String(buffer));
+    // the short frames sent during an overrun have no subscription, they are followed by a full frame once it ends
+    frame.shortFrame = !frame.has(TELEINFO_FIELD_ISOUSC)
+        && (frame.has(TELEINFO_FIELD_ADIR1) || frame.has(TELEINFO_FIELD_ADIR2) || frame.has(TELEINFO_FIELD_ADIR3));
 
-        // clear the buffer
-        teleinfo::clearBuffer();
+    if (teleinfo::mode == TELEINFO_MODE_STANDARD) {
+        teleinfo::completeStandardFrame(frame);
     }
 
-    // return whether the buffer overflowed or not
-    return (counter != maxBufferLength);
+    // publish the back buffer
+    teleinfo::frontFrame = 1 - teleinfo::frontFrame;
+    teleinfo::sequence++;
+    teleinfo::frameTime = millis();
+
+    return true;
 }
 
-char teleinfo::readChar() {
-    // Read a single char
-    // the 0x7F mask is necessary because it is not possible to begin the softwareSerial with parameters SERIAL_7E1 
-    return sSerial.read() & 0x7F;
+void teleinfo::completeStandardFrame(teleinfo_t &frame) {
+    // the current of a single phase meter is sent as the current of phase 1
+    if (frame.has(TELEINFO_FIELD_IINST)) {
+        frame.IINST1 = frame.IINST;
+        frame.setPresent(TELEINFO_FIELD_IINST1);
+    }
+
+    // there is no ADPS nor ADIR in standard mode, raise them the same way as a historic meter
+    if (frame.phases == 3) {
+        frame.ISOUSC = (uint16_t)frame.ISOUSC * TELEINFO_STANDARD_PHASE_PERCENTAGE / 100;
+
+        if (frame.ISOUSC > 0) {
+            frame.ADIR1 = frame.IINST1 > frame.ISOUSC ? frame.IINST1 : 0;
+            frame.ADIR2 = frame.IINST2 > frame.ISOUSC ? frame.IINST2 : 0;
+            frame.ADIR3 = frame.IINST3 > frame.ISOUSC ? frame.IINST3 : 0;
+        }
+    } else if (frame.ISOUSC > 0 && frame.IINST > frame.ISOUSC) {
+        frame.ADPS = frame.IINST;
+    }
 }
 
-bool teleinfo::record(const char* label, char* destination) {
-    // compare the label with the expected label
-    if (strcmp(teleinfo::labelBuffer, label) == 0) {
-        // copy the value to the destination
-        strcpy(destination, teleinfo::valueBuffer);
-        // return OK
-        return true;
+void teleinfo::endLine() {
+    // compute our own cks
+    uint8_t computedCks = (teleinfo::cks & 0x3F) + 0x20;
+
+    if (computedCks == teleinfo::lineCks) {
+        // the line is valid, so the mode is the right one
+        teleinfo::lastLineTime = millis();
+
+        if (teleinfo::valueValid || teleinfo::labelIndex == TELEINFO_LABEL_UNKNOWN) {
+            teleinfo::recordLine(teleinfo::frames[1 - teleinfo::frontFrame]);
+            teleinfo::state = TELEINFO_STATE_WAIT_LINE;
+        } else {
+            LOG_WARNING(TELEINFO_INVALID_VALUE, teleinfo::labelBuffer);
+            teleinfo::lineError();
+        }
+    } else {
+        LOG_WARNING(TELEINFO_CHECKSUM_ERROR, teleinfo::labelBuffer);
+        teleinfo::lineError();
     }
+}
 
-    return false;
+void teleinfo::lineError() {
+    // count the error and wait for the next line
+    if (teleinfo::frameErrors < 0xFF) {
+        teleinfo::frameErrors++;
+    }
+    teleinfo::state = TELEINFO_STATE_WAIT_LINE;
 }
 
-bool teleinfo::record(const char* label, uint8_t &destination) {
-    // compare the label with the expected label
-    if (strcmp(teleinfo::labelBuffer, label) == 0) {
-        // convert the value to the destination
-        destination = atoi(teleinfo::valueBuffer);
-        // return OK
-        return true;
+char teleinfo::readChar() {
+    // Read a single char, already checked for parity by the receiver
+    return tic_receiver::read();
+}
+
+void teleinfo::findLabel() {
+    // labels of the current mode
+    const teleinfo_label_t* labels;
+
+    // the label was hashed while received, so a single lookup is needed
+    if (teleinfo::mode == TELEINFO_MODE_HISTORIC) {
+        labels = TELEINFO_HISTORIC_LABEL_TABLE;
+        teleinfo::labelIndex = pgm_read_byte(&TELEINFO_HISTORIC_SLOT_TABLE[teleinfo::labelHash & (TELEINFO_HISTORIC_HASH_SLOTS - 1)]);
+    } else {
+        labels = TELEINFO_STANDARD_LABEL_TABLE;
+        teleinfo::labelIndex = pgm_read_byte(&TELEINFO_STANDARD_SLOT_TABLE[teleinfo::labelHash & (TELEINFO_STANDARD_HASH_SLOTS - 1)]);
     }
 
-    return false;
+    // an unknown label may share the slot of a known one
+    if (teleinfo::labelIndex != TELEINFO_LABEL_UNKNOWN && strcmp_P(teleinfo::labelBuffer, labels[teleinfo::labelIndex].name) != 0) {
+        teleinfo::labelIndex = TELEINFO_LABEL_UNKNOWN;
+    }
+
+    if (teleinfo::labelIndex == TELEINFO_LABEL_UNKNOWN) {
+        // keep the value as a string, only to log it
+        teleinfo::label = NULL;
+        teleinfo::labelType = TELEINFO_TYPE_STRING;
+        teleinfo::labelMaxLength = TELEINFO_VALUE_BUFFER_SIZE - 1;
+    } else {
+        teleinfo::label = &labels[teleinfo::labelIndex];
+        teleinfo::labelType = (teleinfo_type_t)pgm_read_byte(&teleinfo::label->type);
+        teleinfo::labelMaxLength = pgm_read_byte(&teleinfo::label->maxLength);
+    }
 }
 
-bool teleinfo::record(const char* label, uint32_t &destination) {
-    // compare the label with the expected label
-    if (strcmp(teleinfo::labelBuffer, label) == 0) {
-        // convert the value to the destination
-        destination = atol(teleinfo::valueBuffer);
-        // return OK
-        return true;
+void teleinfo::recordLine(teleinfo_t &frame) {
+    if (teleinfo::labelIndex == TELEINFO_LABEL_UNKNOWN) {
+        // standard frames contain many labels that are not recorded
+        if (teleinfo::mode == TELEINFO_MODE_STANDARD) {
+            return;
+        }
+
+        // no match: probably an unknow label, or one not tracked by this build ?
+        LOG_DEBUG(TELEINFO_UNKNOWN_LABEL, teleinfo::labelBuffer, teleinfo::valueBuffer);
+        return;
     }
 
-    return false;
-}
\ No newline at end of file
+    // destination field in the frame
+    uint8_t* destination = (uint8_t*)&frame + pgm_read_byte(&teleinfo::label->offset);
+    teleinfo_field_t field = (teleinfo_field_t)pgm_read_byte(&teleinfo::label->field);
+    frame.setPresent(field);
+
+    // numbers may be scaled to the unit of the historic label
+    uint32_t value = teleinfo::numericValue * pgm_read_byte(&teleinfo::label->multiplier);
+
+    switch (teleinfo::labelType) {
+        case TELEINFO_TYPE_STRING:
+            // the value buffer is cleared for each line, so the value is terminated
+            memcpy(destination, teleinfo::valueBuffer, teleinfo::counter + 1);
+            break;
+        case TELEINFO_TYPE_CHAR:
+            *destination = teleinfo::valueBuffer[0];
+            break;
+        case TELEINFO_TYPE_UINT8:
+            *destination = (uint8_t)value;
+            break;
+        case TELEINFO_TYPE_UINT32:
+            memcpy(destination, &value, sizeof(uint32_t));
+            break;
+    }
+
+    // the subscribers get the value as soon as the line is validated, before the end of the frame
+    if (teleinfo::labelType == TELEINFO_TYPE_STRING) {
+        value = 0;
+    } else if (teleinfo::labelType == TELEINFO_TYPE_CHAR) {
+        value = teleinfo::valueBuffer[0];
+    }
+    for (uint8_t i = 0; i < teleinfo::subscriberCount; i++) {
+        if (teleinfo::subscribedFields[i] == field) {
+            teleinfo::subscribers[i](field, value);
+        }
+    }
+}
@@ -5,80 +5,270 @@
 // Inspired by arduino-teleInfo by jaysee available at 
 // https://github.com/jaysee/teleInfo
 
-// Pin allocation for the teleinfo
-static const uint8_t TELEINFO_INPUT_PIN = 9;
-
 // Size for the teleinfo buffers
 // max length for the labels
 static const uint8_t TELEINFO_LABEL_BUFFER_SIZE = 10;
 // max length for the values
 static const uint8_t TELEINFO_VALUE_BUFFER_SIZE = 16;
 
-// timeout for teleinfo read (in ms)
-// set at one day in nominal case, because it is safer to receive the teleinfo data
-static const uint32_t TELEINFO_TIMEOUT = 86400000;
+// maximum age of the last frame (in ms) before the teleinfo data is considered stale
+// a historic frame is sent every 1 to 2 seconds, so set to 10s
+static const uint32_t TELEINFO_FRAME_MAX_AGE = 10000;
+
+// control characters of the teleinfo stream
+static const char TELEINFO_STX = 0x02;
+static const char TELEINFO_ETX = 0x03;
+static const char TELEINFO_EOT = 0x04;
+static const char TELEINFO_LF = 0x0A;
+static const char TELEINFO_CR = 0x0D;
+
+// modes of the teleinfo
+// historic mode: 1200 bauds, fields separated by spaces
+// standard mode (Linky): 9600 bauds, fields separated by tabs, with optional date fields
+enum teleinfo_mode_t : uint8_t {
+	TELEINFO_MODE_HISTORIC,
+	TELEINFO_MODE_STANDARD
+};
+static const uint32_t TELEINFO_HISTORIC_SPEED = 1200;
+static const uint32_t TELEINFO_STANDARD_SPEED = 9600;
+static const char TELEINFO_HISTORIC_SEPARATOR = ' ';
+static const char TELEINFO_STANDARD_SEPARATOR = '\t';
+
+// duration without any valid line (in ms) before switching to the other mode
+static const uint32_t TELEINFO_DETECT_DURATION = 5000;
+
+// conversion of the standard mode subscribed power (kVA) to the historic ISOUSC (A)
+static const uint8_t TELEINFO_STANDARD_AMPS_PER_KVA = 5;
+// historic three-phase meters send ISOUSC per phase: kVA * 1000 / 3 / 230V = kVA * 1.45 = 29% of the single phase ISOUSC
+static const uint8_t TELEINFO_STANDARD_PHASE_PERCENTAGE = 29;
+
+// Labels recorded in teleinfo_t, by group: X(field, type, array size)
+// the value type and max length are deduced from the type of the field
+// historic labels are recorded in the field of the same name,
+// standard labels are mapped on the historic fields: X(label, field, multiplier)
+// adding a label only requires adding it to a group
+
+// labels used to control the charge, always tracked
+#define TELEINFO_CONTROL_FIELDS(X) \
+	X(ISOUSC, uint8_t, ) \
+	X(IINST, uint8_t, ) \
+	X(IINST1, uint8_t, ) \
+	X(IINST2, uint8_t, ) \
+	X(IINST3, uint8_t, ) \
+	X(ADPS, uint8_t, ) \
+	X(ADIR1, uint8_t, ) \
+	X(ADIR2, uint8_t, ) \
+	X(ADIR3, uint8_t, ) \
+	X(PAPP, uint32_t, )
+#define TELEINFO_CONTROL_STANDARD_LABELS(X) \
+	X(IRMS1, IINST, 1) \
+	X(IRMS2, IINST2, 1) \
+	X(IRMS3, IINST3, 1) \
+	X(SINSTS, PAPP, 1) \
+	X(PREF, ISOUSC, TELEINFO_STANDARD_AMPS_PER_KVA)
+
+// contract and meter status, tracked with -D TELEINFO_TRACK_STATUS=1
+#if TELEINFO_TRACK_STATUS
+#define TELEINFO_STATUS_FIELDS(X) \
+	X(ADCO, char, [13]) \
+	X(OPTARIF, char, [5]) \
+	X(PCOUP, uint8_t, ) \
+	X(PTEC, char, [5]) \
+	X(IMAX, uint8_t, ) \
+	X(IMAX1, uint8_t, ) \
+	X(IMAX2, uint8_t, ) \
+	X(IMAX3, uint8_t, ) \
+	X(PMAX, uint32_t, ) \
+	X(DEMAIN, char, [5]) \
+	X(HHPHC, char, ) \
+	X(MOTDETAT, char, [7])
+#define TELEINFO_STATUS_STANDARD_LABELS(X) \
+	X(ADSC, ADCO, 1) \
+	X(SMAXSN, PMAX, 1) \
+	X(PCOUP, PCOUP, 1)
+#else
+#define TELEINFO_STATUS_FIELDS(X)
+#define TELEINFO_STATUS_STANDARD_LABELS(X)
+#endif
+
+// energy indexes of the tariffs, tracked with -D TELEINFO_TRACK_INDEXES=1
+#if TELEINFO_TRACK_INDEXES
+#define TELEINFO_INDEX_FIELDS(X) \
+	X(BASE, uint32_t, ) \
+	X(HCHC, uint32_t, ) \
+	X(HCHP, uint32_t, ) \
+	X(EJP_HN, uint32_t, ) \
+	X(EJP_HPM, uint32_t, ) \
+	X(PEJP, uint8_t, ) \
+	X(BBR_HC_JB, uint32_t, ) \
+	X(BBR_HP_JB, uint32_t, ) \
+	X(BBR_HC_JW, uint32_t, ) \
+	X(BBR_HP_JW, uint32_t, ) \
+	X(BBR_HC_JR, uint32_t, ) \
+	X(BBR_HP_JR, uint32_t, )
+#define TELEINFO_INDEX_STANDARD_LABELS(X) \
+	X(EAST, BASE, 1)
+#else
+#define TELEINFO_INDEX_FIELDS(X)
+#define TELEINFO_INDEX_STANDARD_LABELS(X)
+#endif
+
+#define TELEINFO_FIELDS(X) \
+	TELEINFO_CONTROL_FIELDS(X) \
+	TELEINFO_STATUS_FIELDS(X) \
+	TELEINFO_INDEX_FIELDS(X)
+
+#define TELEINFO_STANDARD_LABELS(X) \
+	TELEINFO_CONTROL_STANDARD_LABELS(X) \
+	TELEINFO_STATUS_STANDARD_LABELS(X) \
+	TELEINFO_INDEX_STANDARD_LABELS(X)
+
+// index of each tracked field, for the presence bits and the subscribers
+#define TELEINFO_FIELD_ID(field, type, size) TELEINFO_FIELD_##field,
+enum teleinfo_field_t : uint8_t {
+	TELEINFO_FIELDS(TELEINFO_FIELD_ID)
+	TELEINFO_FIELD_COUNT
+};
+#undef TELEINFO_FIELD_ID
 
 typedef struct teleinfo_t teleinfo_t;
 struct teleinfo_t {
-	char ADCO[12]; 
-	char OPTARIF[4]; 
-	uint8_t ISOUSC; 
-	char PTEC[4]; 
-	uint8_t IINST; 
-	uint8_t IINST1; 
-	uint8_t IINST2; 
-	uint8_t IINST3; 
-	uint8_t ADPS; 
-	uint8_t IMAX; 
-	uint8_t IMAX1; 
-	uint8_t IMAX2; 
-	uint8_t IMAX3; 
-	uint32_t PAPP; 
-	uint32_t PMAX; 
-
-	uint32_t BASE; 
-
-	uint32_t HCHC; 
-	uint32_t HCHP; 
-
-	uint32_t EJP_HN; 
-	uint32_t EJP_HPM; 
-	uint8_t PEJP; 
-
-	uint32_t BBR_HC_JB; 
-	uint32_t BBR_HP_JB; 
-	uint32_t BBR_HC_JW; 
-	uint32_t BBR_HP_JW; 
-	uint32_t BBR_HC_JR; 
-	uint32_t BBR_HP_JR; 
-	char DEMAIN[4]; 
-	char HHPHC;
-
-    char MOTDETAT[6]; 
-
-	teleinfo_t() :
-		ADCO { '\0','\0','\0','\0','\0','\0','\0','\0','\0','\0','\0','\0'},
-		OPTARIF {'\0','\0','\0','\0',},
-		ISOUSC( 0 ),
-		IINST( 0 ),
-		ADPS( 0 )
-		{}
+#define TELEINFO_FIELD_DECLARATION(field, type, size) type field size;
+	TELEINFO_FIELDS(TELEINFO_FIELD_DECLARATION)
+#undef TELEINFO_FIELD_DECLARATION
+
+	// not a label: 3 when the frame has the currents of phases 2 and 3, 1 otherwise
+	uint8_t phases;
+
+	// not a label: short frame of a historic three-phase meter during an overrun, with ADCO, IINSTn and ADIRn only
+	bool shortFrame;
+
+	// one bit per field received in the frame, the others are 0
+	uint8_t present[(TELEINFO_FIELD_COUNT + 7) / 8];
+
+	teleinfo_t() {
+		memset((void*)this, 0, sizeof(teleinfo_t));
+	}
+
+	bool has(const teleinfo_field_t field) const {
+		return present[field >> 3] & (1 << (field & 7));
+	}
+
+	void setPresent(const teleinfo_field_t field) {
+		present[field >> 3] |= 1 << (field & 7);
+	}
+};
+
+// value of a tracked field given to the subscribers, once its line is validated
+// numbers are converted to the unit of the historic label, chars are given as is, strings as 0 (read them in the frame)
+typedef void (*teleinfo_callback_t)(const teleinfo_field_t field, const uint32_t value);
+
+// maximum number of subscriptions
+static const uint8_t TELEINFO_MAX_SUBSCRIBERS = 6;
+
+// Perfect hash of the labels, computed while the label is received:
+// hash = hash * TELEINFO_HASH_MULTIPLIER + c, on 8 bits, then masked to the number of slots of the mode
+// the multiplier is checked at compile time to give no collision between the labels of a mode
+static const uint8_t TELEINFO_HASH_MULTIPLIER = 37;
+static const uint8_t TELEINFO_HISTORIC_HASH_SLOTS = 128;
+static const uint8_t TELEINFO_STANDARD_HASH_SLOTS = 16;
+// slot content for an unknown label
+static const uint8_t TELEINFO_LABEL_UNKNOWN = 0xFF;
+
+// value types of the labels
+enum teleinfo_type_t : uint8_t {
+	TELEINFO_TYPE_STRING,
+	TELEINFO_TYPE_CHAR,
+	TELEINFO_TYPE_UINT8,
+	TELEINFO_TYPE_UINT32
+};
+
+// description of a label, stored in PROGMEM
+typedef struct teleinfo_label_t teleinfo_label_t;
+struct teleinfo_label_t {
+	char name[TELEINFO_LABEL_BUFFER_SIZE];
+	// offset of the destination field in teleinfo_t
+	uint8_t offset;
+	teleinfo_type_t type;
+	// max number of chars (strings) or digits (numbers) of the value
+	uint8_t maxLength;
+	teleinfo_field_t field;
+	// multiplier applied to numbers
+	uint8_t multiplier;
 };
 
 class teleinfo {
     public:
         static void initialize();
-        
-        static teleinfo_t read();     
+
+        // the mode is detected automatically, but can be forced (until no line is received)
+        static void setMode(const teleinfo_mode_t mode);
+        static teleinfo_mode_t getMode();
+
+        // consume the received bytes, returns true when a new frame was published
+        static bool process();
+
+        // last complete frame, with its sequence number and age (in ms)
+        // only the fields present in the frame are meaningful (see teleinfo_t::has)
+        static const teleinfo_t& read();
+        static uint16_t frameSequence();
+        static uint32_t frameAge();
+
+        // call back on each validated line of the field, returns false if there is no room left
+        static bool subscribe(const teleinfo_field_t field, teleinfo_callback_t callback);
     private:
+        // states of the frame parser
+        enum state_t {
+            TELEINFO_STATE_WAIT_FRAME,
+            TELEINFO_STATE_WAIT_LINE,
+            TELEINFO_STATE_LABEL,
+            TELEINFO_STATE_VALUE,
+            TELEINFO_STATE_FIELD_START,
+            TELEINFO_STATE_FIELD_PENDING,
+            TELEINFO_STATE_CHECKSUM,
+            TELEINFO_STATE_END_LINE
+        };
+
         static void clearBuffer();
-        static bool readLine();
+        static bool processChar(const char c);
+        static void startField();
+        static void addChar(const char c);
+        static void startFrame();
+        static bool endFrame();
+        static void completeStandardFrame(teleinfo_t &frame);
+        static void endLine();
+        static void lineError();
 		static char readChar();
-        static inline bool readWord(char* buffer, uint8_t maxBufferLength, uint8_t &cks);
-        static inline bool record(const char* label, char* destination);
-        static inline bool record(const char* label, uint8_t &destination);
-        static inline bool record(const char* label, uint32_t &destination);
+        static void findLabel();
+        static void recordLine(teleinfo_t &frame);
 
         static char labelBuffer[TELEINFO_LABEL_BUFFER_SIZE];
         static char valueBuffer[TELEINFO_VALUE_BUFFER_SIZE];
+
+        // parser state
+        static state_t state;
+        static teleinfo_mode_t mode;
+        static uint32_t lastLineTime;
+        static uint8_t counter;
+        static uint8_t cks;
+        static uint8_t lineCks;
+        static uint8_t labelHash;
+        static uint8_t labelIndex;
+        static const teleinfo_label_t* label;
+        static teleinfo_type_t labelType;
+        static uint8_t labelMaxLength;
+        static uint32_t numericValue;
+        static bool valueValid;
+        static uint8_t frameErrors;
+
+        // double buffer of frames: the front one is read, the back one is being parsed
+        static teleinfo_t frames[2];
+        static uint8_t frontFrame;
+        static uint16_t sequence;
+        static uint32_t frameTime;
+
+        // subscriptions
+        static teleinfo_field_t subscribedFields[TELEINFO_MAX_SUBSCRIBERS];
+        static teleinfo_callback_t subscribers[TELEINFO_MAX_SUBSCRIBERS];
+        static uint8_t subscriberCount;
 };
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include <Arduino.h>
+
+#include "telemetry.h"
+
+#if LOGGER_TELEMETRY
+void telemetry::frame(const teleinfo_t &frame) {
+    telemetry_frame_t record;
+
+    record.time = millis();
+    record.subscribed = frame.ISOUSC;
+    record.current[0] = frame.IINST1;
+    record.current[1] = frame.IINST2;
+    record.current[2] = frame.IINST3;
+    record.power = frame.PAPP;
+    record.overcurrent = (frame.ADPS > 0 ? TELEMETRY_OVERCURRENT_ADPS : 0)
+        | (frame.ADIR1 > 0 ? TELEMETRY_OVERCURRENT_ADIR1 : 0)
+        | (frame.ADIR2 > 0 ? TELEMETRY_OVERCURRENT_ADIR1 << 1 : 0)
+        | (frame.ADIR3 > 0 ? TELEMETRY_OVERCURRENT_ADIR1 << 2 : 0);
+    record.phases = frame.phases;
+
+    logger::writeRecord(TELEMETRY_RECORD_FRAME, &record, sizeof(record));
+}
+
+void telemetry::decision(const uint8_t state, const uint8_t policy, const deciamps_t headroom, const deciamps_t previous, const deciamps_t command) {
+    telemetry_decision_t record;
+
+    record.time = millis();
+    record.state = state;
+    record.policy = policy;
+    record.headroom = headroom;
+    record.previous = previous;
+    record.command = command;
+
+    logger::writeRecord(TELEMETRY_RECORD_DECISION, &record, sizeof(record));
+}
+
+void telemetry::dac(const uint8_t address, const uint16_t value, const uint16_t target, const uint8_t status, const uint8_t attempts) {
+    telemetry_dac_t record;
+
+    record.time = millis();
+    record.value = value;
+    record.target = target;
+    record.status = status;
+    record.attempts = attempts;
+    record.address = address;
+
+    logger::writeRecord(TELEMETRY_RECORD_DAC, &record, sizeof(record));
+}
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "logger/logger.h"
+#include "teleinfo/teleinfo.h"
+#include "viridian/viridian.h"
+
+// Telemetry records, sent with the logs in telemetry mode (-D LOGGER_TELEMETRY=1)
+// each record has a fixed layout, little endian, and starts with the time in ms
+// the records are framed by the logger (COBS and CRC), tools/telemetry_decoder decodes them
+// without the telemetry mode, the calls are empty and removed by the compiler
+
+// types of the records, after the ids of the log messages
+enum telemetry_record_t : uint8_t {
+    // each published meter frame
+    TELEMETRY_RECORD_FRAME = 0x80,
+    // each adaptation of the charging current
+    TELEMETRY_RECORD_DECISION,
+    // each write to the DAC
+    TELEMETRY_RECORD_DAC
+};
+
+static_assert((uint8_t)LOGGER_MESSAGE_COUNT <= (uint8_t)TELEMETRY_RECORD_FRAME, "the log messages ids overlap the telemetry records");
+
+// bits of the overcurrent field of the frame record
+static const uint8_t TELEMETRY_OVERCURRENT_ADPS = 0x01;
+// ADIR1 to ADIR3 are the next bits
+static const uint8_t TELEMETRY_OVERCURRENT_ADIR1 = 0x02;
+
+typedef struct telemetry_frame_t telemetry_frame_t;
+struct __attribute__((packed)) telemetry_frame_t {
+    uint32_t time;
+    // Amps
+    uint8_t subscribed;
+    uint8_t current[3];
+    // VA
+    uint32_t power;
+    uint8_t overcurrent;
+    uint8_t phases;
+};
+
+typedef struct telemetry_decision_t telemetry_decision_t;
+struct __attribute__((packed)) telemetry_decision_t {
+    uint32_t time;
+    // state and policy of the main program
+    uint8_t state;
+    uint8_t policy;
+    deciamps_t headroom;
+    deciamps_t previous;
+    deciamps_t command;
+};
+
+typedef struct telemetry_dac_t telemetry_dac_t;
+struct __attribute__((packed)) telemetry_dac_t {
+    uint32_t time;
+    // value written and target of the ramp
+    uint16_t value;
+    uint16_t target;
+    // result of the write (see dac_MCP4725.h), 0 on success, and the number of attempts
+    uint8_t status;
+    uint8_t attempts;
+    // I2C address of the DAC, one per charger
+    uint8_t address;
+};
+
+class telemetry {
+    public:
+#if LOGGER_TELEMETRY
+        static void frame(const teleinfo_t &frame);
+        static void decision(const uint8_t state, const uint8_t policy, const deciamps_t headroom, const deciamps_t previous, const deciamps_t command);
+        static void dac(const uint8_t address, const uint16_t value, const uint16_t target, const uint8_t status, const uint8_t attempts);
+#else
+        static void frame(const teleinfo_t &) {}
+        static void decision(const uint8_t, const uint8_t, const deciamps_t, const deciamps_t, const deciamps_t) {}
+        static void dac(const uint8_t, const uint16_t, const uint16_t, const uint8_t, const uint8_t) {}
+#endif
+};
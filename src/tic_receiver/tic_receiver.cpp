@@ -0,0 +1,154 @@
+#include <Arduino.h>
+
+#include "tic_receiver.h"
+
+ring_buffer<uint8_t, TIC_RECEIVER_BUFFER_SIZE> tic_receiver::buffer;
+
+uint8_t tic_receiver::halfBitTicks;
+uint8_t tic_receiver::bitIndex;
+uint8_t tic_receiver::currentByte;
+uint8_t tic_receiver::parity;
+
+volatile uint16_t tic_receiver::_overruns;
+volatile uint16_t tic_receiver::_parityErrors;
+volatile uint16_t tic_receiver::_framingErrors;
+
+void tic_receiver::begin(const uint32_t speed) {
+    // timer ticks per bit, with the smallest prescaler that fits on 8 bits
+    uint32_t ticks = F_CPU / 8 / speed;
+    uint8_t prescaler = _BV(CS21);
+    if (ticks > 0x100) {
+        ticks = F_CPU / 64 / speed;
+        prescaler = _BV(CS22);
+    }
+
+    uint8_t oldSREG = SREG;
+    cli();
+
+    // stop an ongoing reception
+    TIMSK2 &= ~_BV(OCIE2A);
+
+    // timer 2 in CTC mode: one compare match per bit
+    TCCR2A = _BV(WGM21);
+    TCCR2B = prescaler;
+    OCR2A = ticks - 1;
+    tic_receiver::halfBitTicks = ticks / 2;
+
+    // input pin with pull-up, idle state is high
+    pinMode(TIC_RECEIVER_INPUT_PIN, INPUT_PULLUP);
+
+    // restart with an empty buffer and no error
+    tic_receiver::buffer.clear();
+    tic_receiver::_overruns = 0;
+    tic_receiver::_parityErrors = 0;
+    tic_receiver::_framingErrors = 0;
+
+    // wait for a start bit
+    PCMSK0 |= _BV(PCINT1);
+    PCIFR = _BV(PCIF0);
+    PCICR |= _BV(PCIE0);
+
+    SREG = oldSREG;
+}
+
+uint8_t tic_receiver::available() {
+    return tic_receiver::buffer.available();
+}
+
+int tic_receiver::read() {
+    uint8_t c;
+
+    if (tic_receiver::buffer.pop(c)) {
+        return c;
+    }
+
+    return -1;
+}
+
+uint16_t tic_receiver::overruns() {
+    return tic_receiver::readCounter(tic_receiver::_overruns);
+}
+
+uint16_t tic_receiver::parityErrors() {
+    return tic_receiver::readCounter(tic_receiver::_parityErrors);
+}
+
+uint16_t tic_receiver::framingErrors() {
+    return tic_receiver::readCounter(tic_receiver::_framingErrors);
+}
+
+uint16_t tic_receiver::readCounter(volatile uint16_t &counter) {
+    // 16 bits are not read atomically, the interrupts could update the counter in between
+    uint8_t oldSREG = SREG;
+    cli();
+    uint16_t value = counter;
+    SREG = oldSREG;
+
+    return value;
+}
+
+void tic_receiver::onPinChange() {
+    // only a falling edge is a start bit
+    if (PINB & _BV(PINB1)) {
+        return;
+    }
+
+    // ignore the edges until the end of the byte
+    PCMSK0 &= ~_BV(PCINT1);
+
+    // first sample in the middle of the start bit, then one per bit
+    TCNT2 = tic_receiver::halfBitTicks;
+    TIFR2 = _BV(OCF2A);
+    TIMSK2 |= _BV(OCIE2A);
+
+    tic_receiver::bitIndex = 0;
+    tic_receiver::currentByte = 0;
+    tic_receiver::parity = 0;
+}
+
+void tic_receiver::onTimer() {
+    uint8_t bit = (PINB & _BV(PINB1)) ? 1 : 0;
+
+    if (tic_receiver::bitIndex == 0) {
+        // start bit must still be low, otherwise it was a glitch
+        if (bit) {
+            tic_receiver::endByte();
+            return;
+        }
+    } else if (tic_receiver::bitIndex < TIC_RECEIVER_BITS - 2) {
+        // data bits, least significant first
+        tic_receiver::currentByte |= bit << (tic_receiver::bitIndex - 1);
+        tic_receiver::parity ^= bit;
+    } else if (tic_receiver::bitIndex == TIC_RECEIVER_BITS - 2) {
+        // even parity: data and parity bits have an even number of ones
+        tic_receiver::parity ^= bit;
+    } else {
+        // stop bit must be high
+        if (!bit) {
+            tic_receiver::_framingErrors++;
+        } else if (tic_receiver::parity) {
+            tic_receiver::_parityErrors++;
+        } else if (!tic_receiver::buffer.push(tic_receiver::currentByte)) {
+            tic_receiver::_overruns++;
+        }
+        tic_receiver::endByte();
+        return;
+    }
+
+    tic_receiver::bitIndex++;
+}
+
+void tic_receiver::endByte() {
+    // stop sampling and wait for the next start bit
+    TIMSK2 &= ~_BV(OCIE2A);
+    PCIFR = _BV(PCIF0);
+    PCMSK0 |= _BV(PCINT1);
+}
+
+ISR(PCINT0_vect) {
+    tic_receiver::onPinChange();
+}
+
+ISR(TIMER2_COMPA_vect) {
+    tic_receiver::onTimer();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "ring_buffer/ring_buffer.h"
+
+// Interrupt driven receiver for the teleinfo (7 data bits, even parity, 1 stop bit)
+// the start bit is detected by a pin change interrupt, then the bits are sampled
+// in the middle of their period by the compare match interrupt of timer 2
+// so the CPU is never blocked while a byte is received
+
+// Pin allocation for the teleinfo: pin 9 = PB1 = PCINT1
+static const uint8_t TIC_RECEIVER_INPUT_PIN = 9;
+
+// size of the reception buffer, 64 bytes is about 67ms at 9600 bauds
+static const uint8_t TIC_RECEIVER_BUFFER_SIZE = 64;
+
+// number of bits sampled per byte: start, 7 data, parity, stop
+static const uint8_t TIC_RECEIVER_BITS = 10;
+
+class tic_receiver {
+    public:
+        static void begin(const uint32_t speed);
+
+        // consumer side
+        static uint8_t available();
+        static int read();
+
+        // error counters since begin()
+        static uint16_t overruns();
+        static uint16_t parityErrors();
+        static uint16_t framingErrors();
+
+        // called from the interrupts
+        static void onPinChange();
+        static void onTimer();
+    private:
+        static uint16_t readCounter(volatile uint16_t &counter);
+        static void endByte();
+
+        static ring_buffer<uint8_t, TIC_RECEIVER_BUFFER_SIZE> buffer;
+
+        // reception state, only used by the interrupts
+        static uint8_t halfBitTicks;
+        static uint8_t bitIndex;
+        static uint8_t currentByte;
+        static uint8_t parity;
+
+        static volatile uint16_t _overruns;
+        static volatile uint16_t _parityErrors;
+        static volatile uint16_t _framingErrors;
+};
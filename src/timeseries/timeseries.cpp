@@ -0,0 +1,289 @@
+#include <Arduino.h>
+
+#include "logger/logger.h"
+
+#include "timeseries.h"
+
+// room needed in the logger for a dump line: sync, id and up to 11 arguments of 5 bytes
+static const uint8_t TIMESERIES_DUMP_LINE_SIZE = 2 + 11 * 5;
+
+uint8_t timeseries::blocks[TIMESERIES_BLOCKS][TIMESERIES_BLOCK_SIZE];
+uint8_t timeseries::blockLengths[TIMESERIES_BLOCKS];
+uint8_t timeseries::blockCounts[TIMESERIES_BLOCKS];
+uint8_t timeseries::firstBlock;
+uint8_t timeseries::blockCount;
+timeseries_sample_t timeseries::last;
+uint16_t timeseries::sampleCount;
+
+uint8_t timeseries::periodMaxCurrent;
+uint32_t timeseries::periodPowerSum;
+uint8_t timeseries::periodFrames;
+bool timeseries::periodOvercurrent;
+
+bool timeseries::dumping;
+uint8_t timeseries::dumpAggregate;
+uint8_t timeseries::dumpBlock;
+uint8_t timeseries::dumpOffset;
+uint8_t timeseries::dumpSampleInBlock;
+uint16_t timeseries::dumpSample;
+timeseries_sample_t timeseries::dumpPrevious;
+
+void timeseries::initialize() {
+    timeseries::firstBlock = 0;
+    timeseries::blockCount = 0;
+    timeseries::sampleCount = 0;
+    timeseries::periodMaxCurrent = 0;
+    timeseries::periodPowerSum = 0;
+    timeseries::periodFrames = 0;
+    timeseries::periodOvercurrent = false;
+    timeseries::dumping = false;
+}
+
+void timeseries::addFrame(const uint8_t current, const uint32_t power, const bool overcurrent) {
+    if (current > timeseries::periodMaxCurrent) {
+        timeseries::periodMaxCurrent = current;
+    }
+
+    // a period has less than 255 frames, even in standard mode
+    if (timeseries::periodFrames < 0xFF) {
+        timeseries::periodPowerSum += power;
+        timeseries::periodFrames++;
+    }
+
+    timeseries::periodOvercurrent |= overcurrent;
+}
+
+void timeseries::commit(const deciamps_t command, const uint8_t state) {
+    timeseries_sample_t sample;
+    uint8_t data[TIMESERIES_SAMPLE_MAX_SIZE];
+
+    sample.command = command;
+    sample.flags = (state << TIMESERIES_STATE_SHIFT) | (timeseries::periodOvercurrent ? TIMESERIES_FLAG_OVERCURRENT : 0);
+
+    if (timeseries::periodFrames > 0) {
+        sample.current = timeseries::periodMaxCurrent;
+        sample.power = timeseries::periodPowerSum / timeseries::periodFrames;
+    } else {
+        // keep the last values, so they are not stored again
+        sample.current = timeseries::last.current;
+        sample.power = timeseries::last.power;
+        sample.flags |= TIMESERIES_FLAG_NO_METER;
+    }
+
+    uint8_t block = (timeseries::firstBlock + timeseries::blockCount - 1) % TIMESERIES_BLOCKS;
+    uint8_t length = timeseries::encode(data, sample, timeseries::last);
+
+    if (timeseries::blockCount == 0 || timeseries::blockLengths[block] + length > TIMESERIES_BLOCK_SIZE) {
+        // a new block, which starts with the sample as is
+        if (timeseries::blockCount == TIMESERIES_BLOCKS) {
+            // the oldest block can not be dropped while it is dumped: the period goes on until the end of the dump
+            if (timeseries::dumping) {
+                return;
+            }
+
+            timeseries::sampleCount -= timeseries::blockCounts[timeseries::firstBlock];
+            timeseries::firstBlock = (timeseries::firstBlock + 1) % TIMESERIES_BLOCKS;
+            timeseries::blockCount--;
+        }
+
+        block = (timeseries::firstBlock + timeseries::blockCount) % TIMESERIES_BLOCKS;
+        timeseries::blockCount++;
+        timeseries::blockLengths[block] = 0;
+        timeseries::blockCounts[block] = 0;
+
+        timeseries_sample_t zero;
+        memset(&zero, 0, sizeof(zero));
+        length = timeseries::encode(data, sample, zero);
+    }
+
+    memcpy(&timeseries::blocks[block][timeseries::blockLengths[block]], data, length);
+    timeseries::blockLengths[block] += length;
+    timeseries::blockCounts[block]++;
+    timeseries::sampleCount++;
+    timeseries::last = sample;
+
+    // start a new period
+    timeseries::periodMaxCurrent = 0;
+    timeseries::periodPowerSum = 0;
+    timeseries::periodFrames = 0;
+    timeseries::periodOvercurrent = false;
+}
+
+void timeseries::startDump(const uint8_t aggregate) {
+    timeseries::dumping = true;
+    timeseries::dumpAggregate = aggregate > 0 ? aggregate : 1;
+    timeseries::dumpBlock = 0;
+    timeseries::dumpOffset = 0;
+    timeseries::dumpSampleInBlock = 0;
+    timeseries::dumpSample = 0;
+
+    LOG_INFO(TIMESERIES_DUMP_START, timeseries::sampleCount, TIMESERIES_PERIOD / 1000, timeseries::dumpAggregate);
+}
+
+bool timeseries::dumpNext() {
+    if (!timeseries::dumping) {
+        return false;
+    }
+
+    if (logger::space() < TIMESERIES_DUMP_LINE_SIZE) {
+        // wait for the logger to send the previous lines
+        return true;
+    }
+
+    // age of the first sample of the line, in s
+    uint32_t age = (uint32_t)(timeseries::sampleCount - timeseries::dumpSample) * (TIMESERIES_PERIOD / 1000);
+
+    timeseries_sample_t sample;
+    if (!timeseries::readSample(sample)) {
+        LOG_INFO(TIMESERIES_DUMP_END);
+        timeseries::dumping = false;
+        return false;
+    }
+
+    if (timeseries::dumpAggregate == 1) {
+        LOG_INFO(TIMESERIES_SAMPLE, age, sample.current, sample.power, sample.command, sample.flags);
+        return true;
+    }
+
+    // min, max and average of the samples of the line
+    uint8_t minCurrent = sample.current;
+    uint8_t maxCurrent = sample.current;
+    uint16_t sumCurrent = sample.current;
+    uint32_t minPower = sample.power;
+    uint32_t maxPower = sample.power;
+    uint32_t sumPower = sample.power;
+    deciamps_t minCommand = sample.command;
+    deciamps_t maxCommand = sample.command;
+    uint8_t overcurrents = (sample.flags & TIMESERIES_FLAG_OVERCURRENT) ? 1 : 0;
+    uint8_t count = 1;
+
+    while (count < timeseries::dumpAggregate && timeseries::readSample(sample)) {
+        if (sample.current < minCurrent) {
+            minCurrent = sample.current;
+        }
+        if (sample.current > maxCurrent) {
+            maxCurrent = sample.current;
+        }
+        if (sample.power < minPower) {
+            minPower = sample.power;
+        }
+        if (sample.power > maxPower) {
+            maxPower = sample.power;
+        }
+        if (sample.command < minCommand) {
+            minCommand = sample.command;
+        }
+        if (sample.command > maxCommand) {
+            maxCommand = sample.command;
+        }
+        sumCurrent += sample.current;
+        sumPower += sample.power;
+        overcurrents += (sample.flags & TIMESERIES_FLAG_OVERCURRENT) ? 1 : 0;
+        count++;
+    }
+
+    LOG_INFO(TIMESERIES_AGGREGATE, age, minCurrent, maxCurrent, (uint8_t)(sumCurrent / count),
+        minPower, maxPower, sumPower / count, minCommand, maxCommand, overcurrents);
+    return true;
+}
+
+bool timeseries::readSample(timeseries_sample_t &sample) {
+    // skip to the next block
+    while (timeseries::dumpBlock < timeseries::blockCount
+            && timeseries::dumpSampleInBlock >= timeseries::blockCounts[(timeseries::firstBlock + timeseries::dumpBlock) % TIMESERIES_BLOCKS]) {
+        timeseries::dumpBlock++;
+        timeseries::dumpOffset = 0;
+        timeseries::dumpSampleInBlock = 0;
+    }
+
+    if (timeseries::dumpBlock >= timeseries::blockCount) {
+        return false;
+    }
+
+    // the first sample of a block is the difference with 0
+    if (timeseries::dumpSampleInBlock == 0) {
+        memset(&timeseries::dumpPrevious, 0, sizeof(timeseries::dumpPrevious));
+    }
+
+    sample = timeseries::dumpPrevious;
+    uint8_t block = (timeseries::firstBlock + timeseries::dumpBlock) % TIMESERIES_BLOCKS;
+    timeseries::dumpOffset += timeseries::decode(&timeseries::blocks[block][timeseries::dumpOffset], sample);
+    timeseries::dumpSampleInBlock++;
+    timeseries::dumpSample++;
+    timeseries::dumpPrevious = sample;
+
+    return true;
+}
+
+uint8_t timeseries::encode(uint8_t* data, const timeseries_sample_t &sample, const timeseries_sample_t &previous) {
+    uint8_t header = sample.flags;
+    uint8_t length = 1;
+
+    if (sample.current != previous.current) {
+        header |= TIMESERIES_CURRENT_CHANGED;
+        length += timeseries::writeVarint(&data[length], (int32_t)sample.current - previous.current);
+    }
+    if (sample.power != previous.power) {
+        header |= TIMESERIES_POWER_CHANGED;
+        length += timeseries::writeVarint(&data[length], (int32_t)(sample.power - previous.power));
+    }
+    if (sample.command != previous.command) {
+        header |= TIMESERIES_COMMAND_CHANGED;
+        length += timeseries::writeVarint(&data[length], (int32_t)sample.command - previous.command);
+    }
+
+    data[0] = header;
+    return length;
+}
+
+uint8_t timeseries::decode(const uint8_t* data, timeseries_sample_t &sample) {
+    uint8_t header = data[0];
+    uint8_t length = 1;
+    int32_t delta;
+
+    // sample holds the previous sample, the differences are added to it
+    if (header & TIMESERIES_CURRENT_CHANGED) {
+        length += timeseries::readVarint(&data[length], delta);
+        sample.current += delta;
+    }
+    if (header & TIMESERIES_POWER_CHANGED) {
+        length += timeseries::readVarint(&data[length], delta);
+        sample.power += delta;
+    }
+    if (header & TIMESERIES_COMMAND_CHANGED) {
+        length += timeseries::readVarint(&data[length], delta);
+        sample.command += delta;
+    }
+
+    sample.flags = header & ~(TIMESERIES_CURRENT_CHANGED | TIMESERIES_POWER_CHANGED | TIMESERIES_COMMAND_CHANGED);
+    return length;
+}
+
+uint8_t timeseries::writeVarint(uint8_t* data, const int32_t value) {
+    // zigzag: small negative values are small too
+    uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    uint8_t length = 0;
+
+    // 7 bits per byte, the high bit tells that another byte follows
+    while (zigzag >= 0x80) {
+        data[length++] = (zigzag & 0x7F) | 0x80;
+        zigzag >>= 7;
+    }
+    data[length++] = zigzag;
+
+    return length;
+}
+
+uint8_t timeseries::readVarint(const uint8_t* data, int32_t &value) {
+    uint32_t zigzag = 0;
+    uint8_t length = 0;
+    uint8_t shift = 0;
+
+    do {
+        zigzag |= (uint32_t)(data[length] & 0x7F) << shift;
+        shift += 7;
+    } while (data[length++] & 0x80);
+
+    value = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+    return length;
+}
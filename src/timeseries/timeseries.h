@@ -0,0 +1,98 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "viridian/viridian.h"
+
+// Time series of the meter and charger samples, kept in RAM for a post-mortem analysis
+// a sample is taken every TIMESERIES_PERIOD: the maximum current and the average power of the frames
+// received during the period, the commanded current and the state flags
+//
+// the samples are stored in blocks: the first sample of a block is stored as is, the next ones
+// as the difference with the previous one (zigzag varint), and only the values that changed
+// when the buffer is full, the oldest block is dropped
+//
+// sample encoding: a header byte, then a varint for each value set in the changed bits
+//   bits 0-2: current, power and command changed
+//   bit 3: overcurrent during the period
+//   bit 4: no meter frame during the period
+//   bits 5-7: state
+
+// period of the samples in ms
+static const uint32_t TIMESERIES_PERIOD = 10000;
+
+// blocks of the buffer: 6 blocks of 64 bytes hold about 20 to 60 minutes of samples
+static const uint8_t TIMESERIES_BLOCKS = 6;
+static const uint8_t TIMESERIES_BLOCK_SIZE = 64;
+
+// header bits
+static const uint8_t TIMESERIES_CURRENT_CHANGED = 0x01;
+static const uint8_t TIMESERIES_POWER_CHANGED = 0x02;
+static const uint8_t TIMESERIES_COMMAND_CHANGED = 0x04;
+static const uint8_t TIMESERIES_FLAG_OVERCURRENT = 0x08;
+static const uint8_t TIMESERIES_FLAG_NO_METER = 0x10;
+static const uint8_t TIMESERIES_STATE_SHIFT = 5;
+
+// maximum size of an encoded sample: header and 3 varints of 32 bits
+static const uint8_t TIMESERIES_SAMPLE_MAX_SIZE = 1 + 3 * 5;
+
+typedef struct timeseries_sample_t timeseries_sample_t;
+struct timeseries_sample_t {
+    // Amps
+    uint8_t current;
+    // VA
+    uint32_t power;
+    deciamps_t command;
+    // header bits, except the changed ones
+    uint8_t flags;
+};
+
+class timeseries {
+    public:
+        static void initialize();
+
+        // aggregate a valid meter frame in the running period
+        static void addFrame(const uint8_t current, const uint32_t power, const bool overcurrent);
+        // store the sample of the period, with the command and the state (3 bits), to be called every TIMESERIES_PERIOD
+        static void commit(const deciamps_t command, const uint8_t state);
+
+        // dump the samples to the logger, from the oldest, as aggregates of the given number of samples
+        static void startDump(const uint8_t aggregate);
+        // send the next dump line if the logger has room for it, returns false once the dump is finished
+        static bool dumpNext();
+
+        // encoding of a sample as the difference with the previous one, decode() adds it to the previous one in sample
+        // the functions return the number of bytes written or read
+        static uint8_t encode(uint8_t* data, const timeseries_sample_t &sample, const timeseries_sample_t &previous);
+        static uint8_t decode(const uint8_t* data, timeseries_sample_t &sample);
+        static uint8_t writeVarint(uint8_t* data, const int32_t value);
+        static uint8_t readVarint(const uint8_t* data, int32_t &value);
+
+    private:
+        static bool readSample(timeseries_sample_t &sample);
+
+        // blocks, from the oldest one at firstBlock, in a ring
+        static uint8_t blocks[TIMESERIES_BLOCKS][TIMESERIES_BLOCK_SIZE];
+        static uint8_t blockLengths[TIMESERIES_BLOCKS];
+        static uint8_t blockCounts[TIMESERIES_BLOCKS];
+        static uint8_t firstBlock;
+        static uint8_t blockCount;
+        // last stored sample, the base of the next difference
+        static timeseries_sample_t last;
+        static uint16_t sampleCount;
+
+        // running period
+        static uint8_t periodMaxCurrent;
+        static uint32_t periodPowerSum;
+        static uint8_t periodFrames;
+        static bool periodOvercurrent;
+
+        // dump in progress
+        static bool dumping;
+        static uint8_t dumpAggregate;
+        static uint8_t dumpBlock;
+        static uint8_t dumpOffset;
+        static uint8_t dumpSampleInBlock;
+        static uint16_t dumpSample;
+        static timeseries_sample_t dumpPrevious;
+};
@@ -1,96 +1,156 @@
 #include <Arduino.h>
 
+#include "calibration/calibration.h"
 #include "dac_MCP4725/dac_MCP4725.h"
-#include "debug/debug.h"
+#include "inputs/inputs.h"
+#include "logger/logger.h"
 
 #include "viridian.h"
 
-double viridian::_chargingCurrent;
-boolean viridian::_currentChanged;
+// DAC value for a current, computed at compile time
+// the current is corrected by the measured offset, then converted to its IC equivalent voltage, then to the DAC value
+static constexpr uint16_t viridian_dacValue(const deciamps_t current) {
+    return (VIRIDIAN_MIN_RANGE_ICV
+        + (double)(current + VIRIDIAN_MEASURED_OFFSET - VIRIDIAN_MIN_RANGE_CURRENT) * (VIRIDIAN_MAX_RANGE_ICV - VIRIDIAN_MIN_RANGE_ICV) / (VIRIDIAN_MAX_RANGE_CURRENT - VIRIDIAN_MIN_RANGE_CURRENT)
+        - VIRIDIAN_DAC_MIN_V) / (VIRIDIAN_DAC_MAX_V - VIRIDIAN_DAC_MIN_V) * VIRIDIAN_DAC_MAX_Q;
+}
+
+// the 10 values from amps.0 to amps.9
+#define VIRIDIAN_DAC_VALUES_1A(amps) \
+    viridian_dacValue(amps * DECIAMPS_PER_AMP + 0), viridian_dacValue(amps * DECIAMPS_PER_AMP + 1), \
+    viridian_dacValue(amps * DECIAMPS_PER_AMP + 2), viridian_dacValue(amps * DECIAMPS_PER_AMP + 3), \
+    viridian_dacValue(amps * DECIAMPS_PER_AMP + 4), viridian_dacValue(amps * DECIAMPS_PER_AMP + 5), \
+    viridian_dacValue(amps * DECIAMPS_PER_AMP + 6), viridian_dacValue(amps * DECIAMPS_PER_AMP + 7), \
+    viridian_dacValue(amps * DECIAMPS_PER_AMP + 8), viridian_dacValue(amps * DECIAMPS_PER_AMP + 9)
+
+// DAC value for each deciamp of the working range
+static const uint16_t VIRIDIAN_DAC_TABLE[VIRIDIAN_DAC_TABLE_SIZE] PROGMEM = {
+    VIRIDIAN_DAC_VALUES_1A(6), VIRIDIAN_DAC_VALUES_1A(7), VIRIDIAN_DAC_VALUES_1A(8), VIRIDIAN_DAC_VALUES_1A(9),
+    VIRIDIAN_DAC_VALUES_1A(10), VIRIDIAN_DAC_VALUES_1A(11), VIRIDIAN_DAC_VALUES_1A(12), VIRIDIAN_DAC_VALUES_1A(13),
+    VIRIDIAN_DAC_VALUES_1A(14), VIRIDIAN_DAC_VALUES_1A(15), VIRIDIAN_DAC_VALUES_1A(16), VIRIDIAN_DAC_VALUES_1A(17),
+    VIRIDIAN_DAC_VALUES_1A(18), VIRIDIAN_DAC_VALUES_1A(19), VIRIDIAN_DAC_VALUES_1A(20), VIRIDIAN_DAC_VALUES_1A(21),
+    VIRIDIAN_DAC_VALUES_1A(22), VIRIDIAN_DAC_VALUES_1A(23), VIRIDIAN_DAC_VALUES_1A(24), VIRIDIAN_DAC_VALUES_1A(25),
+    VIRIDIAN_DAC_VALUES_1A(26), VIRIDIAN_DAC_VALUES_1A(27), VIRIDIAN_DAC_VALUES_1A(28), VIRIDIAN_DAC_VALUES_1A(29),
+    VIRIDIAN_DAC_VALUES_1A(30), VIRIDIAN_DAC_VALUES_1A(31),
+    viridian_dacValue(32 * DECIAMPS_PER_AMP)
+};
+
+static_assert(VIRIDIAN_MIN_RANGE_CURRENT == 6 * DECIAMPS_PER_AMP && VIRIDIAN_MAX_RANGE_CURRENT == 32 * DECIAMPS_PER_AMP, "VIRIDIAN_DAC_TABLE must cover the working range");
+static_assert(viridian_dacValue(VIRIDIAN_MAX_RANGE_CURRENT) <= VIRIDIAN_DAC_MAX_Q, "the working range must fit in the DAC range");
+
+void viridian::initialize(const uint8_t index, const calibration &chargerCalibration, const deciamps_t current) {
+    this->index = index;
+    this->_calibration = &chargerCalibration;
+    this->_currentChanged = false;
 
-void viridian::initialize() {
     // initialize the underlying dac
-    dac_MCP4725::initialize();
+    this->dac.initialize(index);
+
+    if (current > 0) {
+        // warm restart: the DAC kept its output, only the charging current is set again
+        this->_chargingCurrent = 0;
+        this->setChargingCurrent(current);
+        return;
+    }
+
+    // until the firmware sets it, the DAC outputs the minimum charging current after a power-on
+    this->dac.writePowerOnValue(viridian::dacValue(VIRIDIAN_MIN_RANGE_CURRENT));
 
     // set the starting charging current to not 0
-    viridian::_chargingCurrent = 1.0;
+    this->_chargingCurrent = 1;
 
     // set the charging current to 0
-    viridian::stopCharging();
+    this->stopCharging();
 }
 
-void viridian::setChargingCurrent(const double maxAmps) {
-    double newChargingCurrent;
+void viridian::update() {
+    // step the ramp of the DAC
+    this->dac.update();
+
+    // the car may not get the charging current: stop, the DAC is written 0 until it answers again
+    if (this->dac.hasFailed()) {
+        this->stopCharging();
+    }
+}
 
-    if (maxAmps > VIRIDIAN_MAX_RANGE_AMPS) {
+void viridian::setChargingCurrent(const deciamps_t maxCurrent) {
+    deciamps_t newChargingCurrent;
+
+    if (this->dac.hasFailed()) {
+        // no charge while the DAC fails
+        newChargingCurrent = 0;
+    } else if (maxCurrent > VIRIDIAN_MAX_RANGE_CURRENT) {
         // if new value is more than max, apply max
-        newChargingCurrent = VIRIDIAN_MAX_RANGE_AMPS;
-    } else if (maxAmps < VIRIDIAN_MIN_RANGE_AMPS) {
+        newChargingCurrent = VIRIDIAN_MAX_RANGE_CURRENT;
+    } else if (maxCurrent < VIRIDIAN_MIN_RANGE_CURRENT) {
         // if value is less than minimum, just apply 0
-        newChargingCurrent = 0.0;
+        newChargingCurrent = 0;
         // also log a message
-        debug::logNoLine(F("viridian: Not charging - new charging current is less than minimum of "));
-        debug::logNoLine(String(VIRIDIAN_MIN_RANGE_AMPS));
-        debug::log(F(" Amps"));
+        LOG_INFO(VIRIDIAN_BELOW_MINIMUM_DECIAMPS, VIRIDIAN_MIN_RANGE_CURRENT);
     } else {
         // this is an acceptable value
-        newChargingCurrent = maxAmps;
+        newChargingCurrent = maxCurrent;
     }
 
     // if this is a new command
-    if (newChargingCurrent != viridian::_chargingCurrent) {
+    if (newChargingCurrent != this->_chargingCurrent) {
         // save it
-        viridian::_chargingCurrent = newChargingCurrent;
+        this->_chargingCurrent = newChargingCurrent;
 
         // also send directly the command to the car
-        viridian::sendToCar();
+        this->sendToCar();
 
         // also state that the current has changed
-        viridian::_currentChanged = true;
+        this->_currentChanged = true;
     }
 }
 
 void viridian::stopCharging() {
-    viridian::setChargingCurrent(0.0);
+    this->setChargingCurrent(0);
 }
 
-double viridian::getChargingCurrent() {
-    return viridian::_chargingCurrent;
+deciamps_t viridian::getChargingCurrent() const {
+    return this->_chargingCurrent;
 }
 
 void viridian::resetChange() {
-    viridian::_currentChanged = false;
+    this->_currentChanged = false;
+}
+
+boolean viridian::currentChanged() const {
+    return this->_currentChanged;
 }
 
-boolean viridian::currentChanged() {
-    return viridian::_currentChanged;
+boolean viridian::carCharging() const {
+    // the option is set when there is no car charging
+    return !inputs::readOption(INPUTS_CHARGING_CAR_PINS[this->index]);
+}
+
+uint16_t viridian::dacValue(const deciamps_t current) {
+    return pgm_read_word(&VIRIDIAN_DAC_TABLE[current - VIRIDIAN_MIN_RANGE_CURRENT]);
 }
 
 void viridian::sendToCar() {
     // special case to stop charging
-    if (viridian::_chargingCurrent == 0.0) {
-        debug::log(F("viridian: Sending stop command to Viridian"));
+    if (this->_chargingCurrent == 0) {
+        LOG_INFO(VIRIDIAN_STOP);
 
-        // just send 0 to the DAC
-        dac_MCP4725::write(0);
+        // just send 0 to the DAC, now
+        this->dac.rampTo(0);
     } else {
-        // Correct the charging current (because of offset)
-        double correctedChargingCurrent = viridian::_chargingCurrent + VIRIDIAN_MEASURED_OFFSET;
-
-        // IC equivalent voltage for the current value
-        double ICV = VIRIDIAN_MIN_RANGE_ICV + (correctedChargingCurrent - VIRIDIAN_MIN_RANGE_AMPS) * (VIRIDIAN_MAX_RANGE_ICV - VIRIDIAN_MIN_RANGE_ICV) / (VIRIDIAN_MAX_RANGE_AMPS - VIRIDIAN_MIN_RANGE_AMPS);
+        // value for the DAC, the current is always in the working range here
+        // corrected by the calibration, for the car to draw the charging current
+        uint16_t dacValue = viridian::dacValue(this->_calibration->correct(this->_chargingCurrent));
 
-        // value for the DAC
-        uint16_t dacValue = (ICV - VIRIDIAN_DAC_MIN_V) / (VIRIDIAN_DAC_MAX_V - VIRIDIAN_DAC_MIN_V) * VIRIDIAN_DAC_MAX_Q;
+        LOG_INFO(VIRIDIAN_CHARGE_DECIAMPS, this->_chargingCurrent, dacValue);
 
-        debug::logNoLine(F("viridian: Sending charging command to Viridian at "));
-        debug::logNoLine(String(viridian::_chargingCurrent));
-        debug::logNoLine(F("A, IC equivalent voltage: "));
-        debug::logNoLine(String(ICV));
-        debug::logNoLine(F("V, DAC Value: "));
-        debug::log(String(dacValue));
+        // the values below the working range stop the charge, a start goes straight to its minimum
+        uint16_t minimumValue = viridian::dacValue(VIRIDIAN_MIN_RANGE_CURRENT);
+        if (this->dac.getValue() < minimumValue) {
+            this->dac.write(minimumValue);
+        }
 
-        // Send the value to the DAC
-        dac_MCP4725::write(dacValue);        
+        // Send the value to the DAC, the increases are ramped
+        this->dac.rampTo(dacValue);
     }
-}
\ No newline at end of file
+}
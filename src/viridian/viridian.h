@@ -2,17 +2,26 @@
 
 #include <Arduino.h>
 
+#include "dac_MCP4725/dac_MCP4725.h"
+
+class calibration;
+
+// currents are handled in fixed point, in tenths of Amps (deciamps)
+typedef int16_t deciamps_t;
+static const deciamps_t DECIAMPS_PER_AMP = 10;
+
 // working range : 6-32A
-static const double VIRIDIAN_MIN_RANGE_AMPS = 6.0;
-static const double VIRIDIAN_MAX_RANGE_AMPS = 32.0;
+static const deciamps_t VIRIDIAN_MIN_RANGE_CURRENT = 60;
+static const deciamps_t VIRIDIAN_MAX_RANGE_CURRENT = 320;
 
 // IC equivalent voltage for min and max values
-static const double VIRIDIAN_MIN_RANGE_ICV = 0.8018;
-static const double VIRIDIAN_MAX_RANGE_ICV = 2.1132;
+// only used at compile time, to build the table of DAC values
+static constexpr double VIRIDIAN_MIN_RANGE_ICV = 0.8018;
+static constexpr double VIRIDIAN_MAX_RANGE_ICV = 2.1132;
 
 // DAC min and max output voltage
-static const double VIRIDIAN_DAC_MIN_V = 0.0;
-static const double VIRIDIAN_DAC_MAX_V = 5.0;
+static constexpr double VIRIDIAN_DAC_MIN_V = 0.0;
+static constexpr double VIRIDIAN_DAC_MAX_V = 5.0;
 
 // DAC max value
 static const uint16_t VIRIDIAN_DAC_MAX_Q = 4095;
@@ -20,22 +29,48 @@ static const uint16_t VIRIDIAN_DAC_MAX_Q = 4095;
 // Measured offset for current measurement
 // positive offset means that the real current is too low
 // negative offset means that the real current is too high
-static const double VIRIDIAN_MEASURED_OFFSET = -2;
+static const deciamps_t VIRIDIAN_MEASURED_OFFSET = -20;
+
+// number of chargers behind the meter, each with its DAC at the next I2C address and its charging input
+// on three-phase installations, all the chargers must be on the same phase: there is a single charger phase
+// (see phases), whose headroom and overcurrent are shared by all the chargers
+#ifndef VIRIDIAN_CHARGERS
+#define VIRIDIAN_CHARGERS 1
+#endif
+
+static_assert(VIRIDIAN_CHARGERS >= 1 && VIRIDIAN_CHARGERS <= DAC_MCP4725_I2C_ADDRESSES, "one DAC address per charger");
+
+// number of entries of the table of DAC values: one per deciamp of the working range
+static const uint16_t VIRIDIAN_DAC_TABLE_SIZE = VIRIDIAN_MAX_RANGE_CURRENT - VIRIDIAN_MIN_RANGE_CURRENT + 1;
 
 class viridian {
     public:
-        static void initialize();
+        // start with the charging current kept by a warm restart, or stopped with 0
+        // the charger drives the DAC of its index, and corrects its charging current with the calibration
+        void initialize(const uint8_t index, const calibration &chargerCalibration, const deciamps_t current);
+        // move the DAC output toward the charging current, to be called often
+        // the charge is stopped while the DAC fails
+        void update();
+
+        void setChargingCurrent(const deciamps_t maxCurrent);
+        void stopCharging();
+        deciamps_t getChargingCurrent() const;
+
+        void resetChange();
+        boolean currentChanged() const;
+
+        // a car is charging on this charger
+        boolean carCharging() const;
 
-        static void setChargingCurrent(const double maxAmps);
-        static void stopCharging();
-        static double getChargingCurrent();
-        
-        static void resetChange();
-        static boolean currentChanged();
+        // DAC value sent to the car for a current of the working range
+        static uint16_t dacValue(const deciamps_t current);
 
     private:
-        static void sendToCar();
+        void sendToCar();
 
-        static double _chargingCurrent;
-        static boolean _currentChanged;
-};
\ No newline at end of file
+        uint8_t index;
+        dac_MCP4725 dac;
+        const calibration* _calibration;
+        deciamps_t _chargingCurrent;
+        boolean _currentChanged;
+};
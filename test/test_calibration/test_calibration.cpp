@@ -0,0 +1,134 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <unity.h>
+
+#include "calibration/calibration.h"
+#include "hal/native/hal_native.h"
+
+// Calibration of the current drawn by the car: measure, store, and correction of the commands
+
+// load of the house on the charger phase during the calibration
+static const deciamps_t HOUSE = 30;
+
+// current drawn by a car for a command: 85% of it, plus 1.5 A
+static deciamps_t drawn(const deciamps_t command) {
+    return command * 85 / 100 + 15;
+}
+
+// run a whole calibration against the car model, the car draws the current given by the model
+static void calibrate(calibration &charger, deciamps_t (*model)(const deciamps_t command)) {
+    charger.start();
+    do {
+        deciamps_t current = HOUSE + (charger.command() > 0 ? model(charger.command()) : 0);
+        while (!charger.measure(current)) {
+        }
+    } while (charger.next());
+    charger.finish();
+}
+
+// a car that draws less at the top of the range
+static deciamps_t decreasing(const deciamps_t command) {
+    return command < 250 ? command : 500 - command;
+}
+
+void setUp() {
+    hal_native::reset();
+    hal_native::setQuiet(true);
+
+    // erased EEPROM
+    for (uint16_t i = 0; i < EEPROM.length(); i++) {
+        EEPROM.write(i, 0xFF);
+    }
+}
+
+void tearDown() {
+}
+
+static void testUncalibrated() {
+    calibration charger;
+    charger.initialize(0);
+
+    TEST_ASSERT_FALSE(charger.calibrated());
+    TEST_ASSERT_EQUAL_INT16(160, charger.correct(160));
+}
+
+static void testCorrection() {
+    calibration charger;
+    charger.initialize(0);
+    calibrate(charger, drawn);
+
+    TEST_ASSERT_TRUE(charger.calibrated());
+    // the command for the car to draw the current is the inverse of the model, within the rounding
+    for (deciamps_t command = VIRIDIAN_MIN_RANGE_CURRENT; command <= VIRIDIAN_MAX_RANGE_CURRENT; command += 13) {
+        TEST_ASSERT_INT_WITHIN(2, command, charger.correct(drawn(command)));
+    }
+    // and stays in the working range outside of the measured points
+    TEST_ASSERT_EQUAL_INT16(VIRIDIAN_MIN_RANGE_CURRENT, charger.correct(10));
+    TEST_ASSERT_EQUAL_INT16(VIRIDIAN_MAX_RANGE_CURRENT, charger.correct(VIRIDIAN_MAX_RANGE_CURRENT));
+}
+
+static void testStoredAndLoaded() {
+    calibration first;
+    first.initialize(0);
+    calibrate(first, drawn);
+
+    // a restart loads the points of each charger from its own address
+    calibration loaded;
+    loaded.initialize(0);
+    calibration other;
+    other.initialize(1);
+
+    TEST_ASSERT_TRUE(loaded.calibrated());
+    TEST_ASSERT_EQUAL_INT16(first.correct(150), loaded.correct(150));
+    TEST_ASSERT_FALSE(other.calibrated());
+}
+
+static void testInvalidNotStored() {
+    calibration charger;
+    charger.initialize(0);
+    calibrate(charger, drawn);
+
+    // points that do not increase can not be inverted, the previous calibration is kept
+    calibrate(charger, decreasing);
+    TEST_ASSERT_TRUE(charger.calibrated());
+    TEST_ASSERT_INT_WITHIN(2, 200, charger.correct(drawn(200)));
+
+    calibration loaded;
+    loaded.initialize(0);
+    TEST_ASSERT_INT_WITHIN(2, 200, loaded.correct(drawn(200)));
+}
+
+static void testCorruptedNotLoaded() {
+    calibration charger;
+    charger.initialize(0);
+    calibrate(charger, drawn);
+
+    EEPROM.write(CALIBRATION_EEPROM_ADDRESS + offsetof(calibration_eeprom_t, measured), 0);
+    calibration loaded;
+    loaded.initialize(0);
+    TEST_ASSERT_FALSE(loaded.calibrated());
+}
+
+static void testAbort() {
+    calibration charger;
+    charger.initialize(0);
+    calibrate(charger, drawn);
+
+    // the correction is disabled while running, and back after an abort
+    charger.start();
+    TEST_ASSERT_FALSE(charger.calibrated());
+    TEST_ASSERT_EQUAL_INT16(0, charger.command());
+    charger.abort();
+    TEST_ASSERT_TRUE(charger.calibrated());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testUncalibrated);
+    RUN_TEST(testCorrection);
+    RUN_TEST(testStoredAndLoaded);
+    RUN_TEST(testInvalidNotStored);
+    RUN_TEST(testCorruptedNotLoaded);
+    RUN_TEST(testAbort);
+    return UNITY_END();
+}
@@ -0,0 +1,139 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <unity.h>
+
+#include "chargers/chargers.h"
+#include "hal/native/hal_native.h"
+#include "inputs/inputs.h"
+
+// Share of the charging current between the chargers with a car
+// built with 3 chargers by env:native_chargers
+
+static_assert(VIRIDIAN_CHARGERS == 3, "the share tests expect 3 chargers");
+
+// current offered to the chargers without a car
+static const deciamps_t OFFER = VIRIDIAN_MIN_RANGE_CURRENT;
+
+// the charging signal of a charger is low when there is no car charging
+static void plug(const uint8_t index, const bool charging) {
+    hal_native::setPin(INPUTS_CHARGING_CAR_PINS[index], charging ? HIGH : LOW);
+}
+
+static deciamps_t current(const uint8_t index) {
+    return chargers::get(index).getChargingCurrent();
+}
+
+void setUp() {
+    hal_native::reset();
+    hal_native::setQuiet(true);
+    hal_native::setDacs(VIRIDIAN_CHARGERS);
+
+    // not calibrated
+    for (uint16_t i = 0; i < EEPROM.length(); i++) {
+        EEPROM.write(i, 0xFF);
+    }
+
+    for (uint8_t i = 0; i < VIRIDIAN_CHARGERS; i++) {
+        plug(i, true);
+    }
+    chargers::initialize(NULL, OFFER);
+}
+
+void tearDown() {
+}
+
+static void testMaxMinShare() {
+    chargers::setShare(CHARGERS_SHARE_MAX_MIN);
+    chargers::setChargingCurrent(450);
+
+    TEST_ASSERT_EQUAL_INT16(150, current(0));
+    TEST_ASSERT_EQUAL_INT16(150, current(1));
+    TEST_ASSERT_EQUAL_INT16(150, current(2));
+    TEST_ASSERT_EQUAL_INT16(450, chargers::getChargingCurrent());
+}
+
+static void testMaximumPerCharger() {
+    chargers::setShare(CHARGERS_SHARE_MAX_MIN);
+    chargers::setChargingCurrent(1200);
+
+    for (uint8_t i = 0; i < VIRIDIAN_CHARGERS; i++) {
+        TEST_ASSERT_EQUAL_INT16(CHARGERS_MAX_CURRENT[i], current(i));
+    }
+}
+
+static void testPriorityShare() {
+    chargers::setShare(CHARGERS_SHARE_PRIORITY);
+    chargers::setChargingCurrent(700);
+
+    TEST_ASSERT_EQUAL_INT16(CHARGERS_MAX_CURRENT[0], current(0));
+    TEST_ASSERT_EQUAL_INT16(CHARGERS_MAX_CURRENT[1], current(1));
+    TEST_ASSERT_EQUAL_INT16(700 - CHARGERS_MAX_CURRENT[0] - CHARGERS_MAX_CURRENT[1], current(2));
+}
+
+static void testEqualShare() {
+    chargers::setShare(CHARGERS_SHARE_EQUAL);
+    chargers::setChargingCurrent(400);
+
+    TEST_ASSERT_EQUAL_INT16(133, current(0));
+    TEST_ASSERT_EQUAL_INT16(133, current(1));
+    TEST_ASSERT_EQUAL_INT16(133, current(2));
+}
+
+static void testLastChargersStopped() {
+    chargers::setShare(CHARGERS_SHARE_MAX_MIN);
+
+    // not enough for the minimum of 3 chargers: the last one is stopped
+    chargers::setChargingCurrent(150);
+    TEST_ASSERT_EQUAL_INT16(75, current(0));
+    TEST_ASSERT_EQUAL_INT16(75, current(1));
+    TEST_ASSERT_EQUAL_INT16(0, current(2));
+
+    // nor of 2: the first one takes it all
+    chargers::setChargingCurrent(110);
+    TEST_ASSERT_EQUAL_INT16(110, current(0));
+    TEST_ASSERT_EQUAL_INT16(0, current(1));
+    TEST_ASSERT_EQUAL_INT16(0, current(2));
+
+    // nor of 1: all stopped
+    chargers::setChargingCurrent(VIRIDIAN_MIN_RANGE_CURRENT - 1);
+    TEST_ASSERT_EQUAL_INT16(0, chargers::getChargingCurrent());
+}
+
+static void testChargerWithoutCar() {
+    plug(1, false);
+    TEST_ASSERT_TRUE(chargers::refresh());
+    TEST_ASSERT_EQUAL_UINT8(0b101, chargers::active());
+    TEST_ASSERT_FALSE(chargers::refresh());
+
+    // the charger without a car is offered a current to start, not counted in the share
+    chargers::setShare(CHARGERS_SHARE_MAX_MIN);
+    chargers::setChargingCurrent(300);
+    TEST_ASSERT_EQUAL_INT16(150, current(0));
+    TEST_ASSERT_EQUAL_INT16(OFFER, current(1));
+    TEST_ASSERT_EQUAL_INT16(150, current(2));
+    TEST_ASSERT_EQUAL_INT16(300, chargers::getChargingCurrent());
+}
+
+static void testNoCar() {
+    for (uint8_t i = 0; i < VIRIDIAN_CHARGERS; i++) {
+        plug(i, false);
+    }
+    chargers::refresh();
+
+    TEST_ASSERT_FALSE(chargers::carCharging());
+    TEST_ASSERT_FALSE(chargers::calibrated());
+    chargers::setChargingCurrent(300);
+    TEST_ASSERT_EQUAL_INT16(0, chargers::getChargingCurrent());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testMaxMinShare);
+    RUN_TEST(testMaximumPerCharger);
+    RUN_TEST(testPriorityShare);
+    RUN_TEST(testEqualShare);
+    RUN_TEST(testLastChargersStopped);
+    RUN_TEST(testChargerWithoutCar);
+    RUN_TEST(testNoCar);
+    return UNITY_END();
+}
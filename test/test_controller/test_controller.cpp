@@ -0,0 +1,91 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "controller/controller.h"
+#include "hal/native/hal_native.h"
+
+// Back-off and slew limits of the PI controller of the charging current
+
+void setUp() {
+    hal_native::reset();
+    hal_native::setQuiet(true);
+}
+
+void tearDown() {
+}
+
+static void testBackOffNegativeHeadroom() {
+    controller::start(200);
+    hal_native::advance(1000000);
+
+    // the whole excess is removed at once
+    TEST_ASSERT_EQUAL_INT16(170, controller::update(200, -30, false));
+}
+
+static void testBackOffBelowRange() {
+    controller::start(80);
+    hal_native::advance(1000000);
+
+    // below the working range the car is stopped
+    TEST_ASSERT_EQUAL_INT16(0, controller::update(80, -30, false));
+}
+
+static void testBackOffAdps() {
+    controller::start(200);
+    hal_native::advance(1000000);
+
+    // an ADPS with a positive headroom is backed off too
+    TEST_ASSERT_EQUAL_INT16(200 - CONTROLLER_ADPS_DECREASE, controller::update(200, 15, true));
+}
+
+static void testBackOffIgnoresSlewLimit() {
+    controller::start(200);
+    hal_native::advance(1000000);
+    TEST_ASSERT_EQUAL_INT16(170, controller::update(200, -30, false));
+
+    // a second back-off right after the first one is not delayed
+    hal_native::advance(1000000);
+    TEST_ASSERT_EQUAL_INT16(150, controller::update(170, -20, false));
+}
+
+static void testIncreaseSlewLimited() {
+    controller::start(100);
+
+    // a large headroom is taken in steps, no more often than the increase interval
+    hal_native::advance(CONTROLLER_INCREASE_INTERVAL * 1000);
+    deciamps_t current = controller::update(100, 150, false);
+    TEST_ASSERT_GREATER_THAN(100, current);
+    TEST_ASSERT_LESS_OR_EQUAL(100 + CONTROLLER_MAX_INCREASE, current);
+
+    hal_native::advance(1000000);
+    TEST_ASSERT_EQUAL_INT16(current, controller::update(current, 150 - (current - 100), false));
+}
+
+static void testSmallChangeIgnored() {
+    controller::start(200);
+
+    hal_native::advance(CONTROLLER_INCREASE_INTERVAL * 1000);
+    TEST_ASSERT_EQUAL_INT16(200, controller::update(200, 1, false));
+}
+
+static void testRestartAtMinimum() {
+    controller::start(0);
+
+    // a stopped car restarts only once the headroom allows the minimum current
+    hal_native::advance(CONTROLLER_INCREASE_INTERVAL * 1000);
+    TEST_ASSERT_EQUAL_INT16(0, controller::update(0, VIRIDIAN_MIN_RANGE_CURRENT - 1, false));
+    hal_native::advance(CONTROLLER_INCREASE_INTERVAL * 1000);
+    TEST_ASSERT_EQUAL_INT16(VIRIDIAN_MIN_RANGE_CURRENT, controller::update(0, VIRIDIAN_MIN_RANGE_CURRENT + 20, false));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testBackOffNegativeHeadroom);
+    RUN_TEST(testBackOffBelowRange);
+    RUN_TEST(testBackOffAdps);
+    RUN_TEST(testBackOffIgnoresSlewLimit);
+    RUN_TEST(testIncreaseSlewLimited);
+    RUN_TEST(testSmallChangeIgnored);
+    RUN_TEST(testRestartAtMinimum);
+    return UNITY_END();
+}
@@ -0,0 +1,109 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <unity.h>
+
+#include "forecast/forecast.h"
+#include "hal/native/hal_native.h"
+
+// Forecast of the house load: smoothing, trend, and the baselines of the quarters of an hour
+
+// time between two frames in historic mode (ms)
+static const uint32_t FRAME_PERIOD = 1500;
+
+// frames of the house load, the power follows the current at 230V
+static void addFrames(const uint16_t count, const deciamps_t start, const deciamps_t step) {
+    for (uint16_t i = 0; i < count; i++) {
+        deciamps_t current = start + i * step;
+        hal_native::advance(FRAME_PERIOD * 1000UL);
+        forecast::addFrame(current, (uint32_t)current * 23);
+    }
+}
+
+void setUp() {
+    hal_native::reset();
+    hal_native::setQuiet(true);
+
+    for (uint16_t i = 0; i < EEPROM.length(); i++) {
+        EEPROM.write(i, 0xFF);
+    }
+    forecast::initialize();
+}
+
+void tearDown() {
+}
+
+static void testNoFrame() {
+    TEST_ASSERT_EQUAL_INT16(0, forecast::margin());
+}
+
+static void testConstantLoad() {
+    addFrames(50, 80, 0);
+
+    TEST_ASSERT_EQUAL_INT16(0, forecast::margin());
+    TEST_ASSERT_EQUAL_INT16(80, forecast::currentPeak());
+    TEST_ASSERT_INT_WITHIN(FORECAST_POWER_UNIT, 80 * 23, forecast::powerPeak());
+}
+
+static void testRisingLoad() {
+    // 0.2 A more at each frame: the peak is ahead of the last measure, within the maximum margin
+    addFrames(30, 50, 2);
+
+    deciamps_t margin = forecast::margin();
+    TEST_ASSERT_GREATER_THAN(0, margin);
+    TEST_ASSERT_LESS_OR_EQUAL(FORECAST_MAX_MARGIN, margin);
+    TEST_ASSERT_GREATER_THAN(50 + 29 * 2, forecast::currentPeak());
+}
+
+static void testSteepRiseLimited() {
+    addFrames(20, 50, 30);
+
+    TEST_ASSERT_EQUAL_INT16(FORECAST_MAX_MARGIN, forecast::margin());
+}
+
+static void testFallingLoad() {
+    addFrames(30, 200, -5);
+
+    // a falling trend keeps no margin, and does not lower the peak below the level
+    TEST_ASSERT_EQUAL_INT16(0, forecast::margin());
+    TEST_ASSERT_GREATER_OR_EQUAL(200 - 29 * 5, forecast::currentPeak());
+}
+
+static void testBaselineLearned() {
+    // a peak of 20 A in the quarter of 18:00 to 18:15
+    forecast::setTime(18 * 60);
+    TEST_ASSERT_TRUE(forecast::timeSet());
+    addFrames(60, 50, 0);
+    addFrames(10, 200, 0);
+    addFrames(600, 50, 0);
+
+    // the next day, from 17:45 the baseline of the next quarter is kept free
+    forecast::setTime(17 * 60 + 50);
+    addFrames(20, 50, 0);
+    TEST_ASSERT_EQUAL_INT16(200, forecast::currentPeak());
+    TEST_ASSERT_EQUAL_INT16(FORECAST_MAX_MARGIN, forecast::margin());
+}
+
+static void testBaselineWithoutTime() {
+    forecast::setTime(18 * 60);
+    addFrames(10, 200, 0);
+    addFrames(600, 50, 0);
+
+    // the baselines are not used until the time of the day is set again
+    forecast::initialize();
+    addFrames(20, 50, 0);
+    TEST_ASSERT_FALSE(forecast::timeSet());
+    TEST_ASSERT_EQUAL_INT16(50, forecast::currentPeak());
+    TEST_ASSERT_EQUAL_INT16(0, forecast::margin());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testNoFrame);
+    RUN_TEST(testConstantLoad);
+    RUN_TEST(testRisingLoad);
+    RUN_TEST(testSteepRiseLimited);
+    RUN_TEST(testFallingLoad);
+    RUN_TEST(testBaselineLearned);
+    RUN_TEST(testBaselineWithoutTime);
+    return UNITY_END();
+}
@@ -0,0 +1,66 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "hal/native/hal_native.h"
+#include "inputs/inputs.h"
+#include "viridian/viridian.h"
+
+// Options, variables and charging signals read from the sampled inputs
+
+void setUp() {
+    hal_native::reset();
+    hal_native::setQuiet(true);
+    inputs::initialize();
+}
+
+void tearDown() {
+}
+
+static void testOptions() {
+    // the pins are pulled up, an option is set by a low level
+    TEST_ASSERT_EQUAL_UINT8(INPUT_PULLUP, hal_native::getPinMode(INPUTS_OPTION_GREATER_ISOUSC));
+    TEST_ASSERT_FALSE(inputs::readOption(INPUTS_OPTION_GREATER_ISOUSC));
+
+    hal_native::setPin(INPUTS_OPTION_GREATER_ISOUSC, LOW);
+    TEST_ASSERT_TRUE(inputs::readOption(INPUTS_OPTION_GREATER_ISOUSC));
+    TEST_ASSERT_FALSE(inputs::readOption(INPUTS_OPTION_MARGIN_ADD_1A));
+}
+
+static void testVariables() {
+    hal_native::setAnalog(0, 512);
+    hal_native::setAnalog(1, 1023);
+
+    // by channel or by pin, as analogRead()
+    TEST_ASSERT_EQUAL_INT(512, inputs::readVariable(0));
+    TEST_ASSERT_EQUAL_INT(512, inputs::readVariable(INPUTS_VARIABLE_FIRST_PIN));
+    TEST_ASSERT_EQUAL_INT(1023, inputs::readVariable(INPUTS_VARIABLE_FIRST_PIN + 1));
+}
+
+static void testChargingChanged() {
+    TEST_ASSERT_FALSE(inputs::chargingChanged());
+
+    // the change of a charging signal is reported once
+    hal_native::setPin(INPUTS_OPTION_CHARGING_CAR, LOW);
+    TEST_ASSERT_TRUE(inputs::chargingChanged());
+    TEST_ASSERT_FALSE(inputs::chargingChanged());
+
+    // also for the other chargers, if they are built
+    hal_native::setPin(INPUTS_CHARGING_CAR_PINS[1], LOW);
+    TEST_ASSERT_EQUAL(VIRIDIAN_CHARGERS > 1, inputs::chargingChanged());
+
+    // not for the free pins of the chargers that are not built
+    hal_native::setPin(INPUTS_CHARGING_CAR_PINS[VIRIDIAN_CHARGERS], LOW);
+    TEST_ASSERT_FALSE(inputs::chargingChanged());
+
+    // not for the options
+    hal_native::setPin(INPUTS_OPTION_GREATER_ISOUSC, LOW);
+    TEST_ASSERT_FALSE(inputs::chargingChanged());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testOptions);
+    RUN_TEST(testVariables);
+    RUN_TEST(testChargingChanged);
+    return UNITY_END();
+}
@@ -0,0 +1,145 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <unity.h>
+
+#include "chargers/chargers.h"
+#include "hal/native/hal_native.h"
+#include "inputs/inputs.h"
+#include "overrun/overrun.h"
+#include "phases/phases.h"
+#include "teleinfo/teleinfo.h"
+
+// Cut of the charge on the overrun lines, before the end of the frame
+
+// allowed current of the subscription, and the charge before the overrun
+static const deciamps_t LIMIT = 450;
+static const deciamps_t CHARGE = 240;
+
+// feed historic lines with their checksum, without ending the frame
+static void feedLine(const char* label, const char* value) {
+    char line[32];
+    uint8_t sum = 0;
+
+    snprintf(line, sizeof(line), "%s %s", label, value);
+    for (char* c = line; *c != '\0'; c++) {
+        sum += (uint8_t)*c;
+    }
+    snprintf(line, sizeof(line), "%c%s %s %c%c", TELEINFO_LF, label, value, (sum & 0x3F) + 0x20, TELEINFO_CR);
+
+    hal_native::feedMeter(line, strlen(line));
+    while (hal_native::meterPending() > 0) {
+        teleinfo::process();
+    }
+}
+
+static void startFrame() {
+    char stx = TELEINFO_STX;
+    hal_native::feedMeter(&stx, 1);
+}
+
+static deciamps_t charge() {
+    return chargers::getChargingCurrent();
+}
+
+void setUp() {
+    hal_native::reset();
+    hal_native::setQuiet(true);
+    // past the hold-off of the previous test
+    hal_native::advance((OVERRUN_HOLD_OFF + 1) * 1000UL);
+
+    for (uint16_t i = 0; i < EEPROM.length(); i++) {
+        EEPROM.write(i, 0xFF);
+    }
+
+    phases::configure();
+    chargers::initialize(NULL, 0);
+    chargers::setChargingCurrent(CHARGE);
+    teleinfo::initialize();
+    teleinfo::setMode(TELEINFO_MODE_HISTORIC);
+    overrun::setLimit(LIMIT);
+    overrun::takeCut();
+}
+
+void tearDown() {
+}
+
+static void testCutOnLine() {
+    uint16_t cuts = overrun::cuts();
+
+    // 47 A for 45 A allowed: 2 A and the margin are cut as soon as the line is validated
+    startFrame();
+    feedLine("ISOUSC", "45");
+    feedLine("ADPS", "047");
+    TEST_ASSERT_EQUAL_INT16(CHARGE - 20 - OVERRUN_MARGIN, charge());
+    TEST_ASSERT_EQUAL_UINT16(cuts + 1, overrun::cuts());
+
+    // reported once
+    TEST_ASSERT_TRUE(overrun::takeCut());
+    TEST_ASSERT_FALSE(overrun::takeCut());
+}
+
+static void testHoldOff() {
+    startFrame();
+    feedLine("ADPS", "047");
+    TEST_ASSERT_EQUAL_INT16(CHARGE - 20 - OVERRUN_MARGIN, charge());
+
+    // the next lines still measure the charge before the cut: the same overrun does not cut again
+    hal_native::advance(1500000);
+    feedLine("ADPS", "047");
+    TEST_ASSERT_EQUAL_INT16(CHARGE - 20 - OVERRUN_MARGIN, charge());
+
+    // a larger one cuts from the charge before the first cut
+    feedLine("ADPS", "050");
+    TEST_ASSERT_EQUAL_INT16(CHARGE - 50 - OVERRUN_MARGIN, charge());
+
+    // after the hold-off, the measure includes the cut: the excess is cut from the current charge
+    // (with a line in between, not to switch to the standard mode)
+    hal_native::advance(OVERRUN_HOLD_OFF * 1000UL / 2);
+    feedLine("IINST", "045");
+    hal_native::advance(OVERRUN_HOLD_OFF * 1000UL / 2);
+    feedLine("ADPS", "046");
+    TEST_ASSERT_EQUAL_INT16(CHARGE - 50 - OVERRUN_MARGIN - 10 - OVERRUN_MARGIN, charge());
+}
+
+static void testBelowLimit() {
+    // with the greater ISOUSC option, the limit is above the subscription: main handles the ADPS
+    startFrame();
+    feedLine("ADPS", "045");
+    TEST_ASSERT_EQUAL_INT16(CHARGE, charge());
+    TEST_ASSERT_FALSE(overrun::takeCut());
+}
+
+static void testStopped() {
+    // an excess above the charge stops it
+    startFrame();
+    feedLine("ADPS", "070");
+    TEST_ASSERT_EQUAL_INT16(0, charge());
+}
+
+static void testOtherPhase() {
+    // the charger is on phase 2: the overrun of phase 1 is not cut
+    hal_native::setPin(INPUTS_OPTION_CHARGER_PHASE_2, LOW);
+    phases::configure();
+
+    startFrame();
+    feedLine("ADIR1", "047");
+    TEST_ASSERT_EQUAL_INT16(CHARGE, charge());
+    feedLine("ADIR2", "047");
+    TEST_ASSERT_EQUAL_INT16(CHARGE - 20 - OVERRUN_MARGIN, charge());
+
+    hal_native::setPin(INPUTS_OPTION_CHARGER_PHASE_2, HIGH);
+    phases::configure();
+}
+
+int main() {
+    // the subscriptions are kept by teleinfo::initialize()
+    overrun::initialize();
+
+    UNITY_BEGIN();
+    RUN_TEST(testCutOnLine);
+    RUN_TEST(testHoldOff);
+    RUN_TEST(testBelowLimit);
+    RUN_TEST(testStopped);
+    RUN_TEST(testOtherPhase);
+    return UNITY_END();
+}
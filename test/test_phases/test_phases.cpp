@@ -0,0 +1,112 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "hal/native/hal_native.h"
+#include "inputs/inputs.h"
+#include "phases/phases.h"
+
+// Detection of the charger phase from the DAC steps
+// the detected phase is kept from a test to the next one, each test moves it to another phase
+
+static teleinfo_t frame;
+
+// a step of the charging current, and the change of the phase currents it gave (A)
+static void step(const deciamps_t change, const int8_t change1, const int8_t change2, const int8_t change3) {
+    phases::onFrame(frame);
+    phases::onCommand(change);
+
+    hal_native::advance(PHASES_DETECT_DELAY * 1000UL);
+    frame.IINST1 += change1;
+    frame.IINST2 += change2;
+    frame.IINST3 += change3;
+    phases::onFrame(frame);
+}
+
+void setUp() {
+    hal_native::reset();
+    hal_native::setQuiet(true);
+    phases::configure();
+
+    frame = teleinfo_t();
+    frame.phases = 3;
+    frame.IINST1 = 10;
+    frame.IINST2 = 10;
+    frame.IINST3 = 10;
+}
+
+void tearDown() {
+}
+
+static void testDetectPhase() {
+    TEST_ASSERT_EQUAL_UINT8(PHASES_UNKNOWN, phases::chargerPhase());
+
+    for (uint8_t i = 0; i < PHASES_DETECT_STEPS; i++) {
+        step(60, 0, 6, 0);
+        step(-60, 0, -6, 0);
+    }
+    TEST_ASSERT_EQUAL_UINT8(2, phases::chargerPhase());
+}
+
+static void testDetectMinimumStep() {
+    // the smallest step taken stands out of the tolerance on the phases that did not change
+    for (uint8_t i = 0; i < PHASES_DETECT_STEPS; i++) {
+        step(PHASES_DETECT_MIN_STEP, 0, 0, PHASES_DETECT_MIN_STEP / DECIAMPS_PER_AMP);
+    }
+    TEST_ASSERT_EQUAL_UINT8(3, phases::chargerPhase());
+}
+
+static void testSmallStepIgnored() {
+    for (uint8_t i = 0; i < PHASES_DETECT_STEPS * 2; i++) {
+        step(PHASES_DETECT_MIN_STEP - 1, 2, 0, 0);
+    }
+    TEST_ASSERT_EQUAL_UINT8(3, phases::chargerPhase());
+}
+
+static void testAmbiguousStepIgnored() {
+    // another load changed at the same time on a second phase
+    for (uint8_t i = 0; i < PHASES_DETECT_STEPS * 2; i++) {
+        step(60, 6, 6, 0);
+    }
+    TEST_ASSERT_EQUAL_UINT8(3, phases::chargerPhase());
+}
+
+static void testLateStepIgnored() {
+    for (uint8_t i = 0; i < PHASES_DETECT_STEPS; i++) {
+        phases::onFrame(frame);
+        phases::onCommand(60);
+        hal_native::advance((PHASES_DETECT_TIMEOUT + 1) * 1000UL);
+        frame.IINST1 += 6;
+        phases::onFrame(frame);
+    }
+    TEST_ASSERT_EQUAL_UINT8(3, phases::chargerPhase());
+}
+
+static void testConfiguredPhase() {
+    // the options set the phase, no detection then
+    hal_native::setPin(INPUTS_OPTION_CHARGER_PHASE_1, LOW);
+    phases::configure();
+    TEST_ASSERT_EQUAL_UINT8(1, phases::chargerPhase());
+
+    hal_native::setPin(INPUTS_OPTION_CHARGER_PHASE_1, HIGH);
+    hal_native::setPin(INPUTS_OPTION_CHARGER_PHASE_2, LOW);
+    phases::configure();
+    TEST_ASSERT_EQUAL_UINT8(2, phases::chargerPhase());
+    for (uint8_t i = 0; i < PHASES_DETECT_STEPS; i++) {
+        step(60, 6, 0, 0);
+    }
+    TEST_ASSERT_EQUAL_UINT8(2, phases::chargerPhase());
+
+    hal_native::setPin(INPUTS_OPTION_CHARGER_PHASE_2, HIGH);
+    phases::configure();
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testDetectPhase);
+    RUN_TEST(testDetectMinimumStep);
+    RUN_TEST(testSmallStepIgnored);
+    RUN_TEST(testAmbiguousStepIgnored);
+    RUN_TEST(testLateStepIgnored);
+    RUN_TEST(testConfiguredPhase);
+    return UNITY_END();
+}
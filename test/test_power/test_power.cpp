@@ -0,0 +1,116 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "hal/native/hal_native.h"
+#include "power/power.h"
+
+// Filter of the apparent power and headroom in the power domain
+// the filtered power is kept from a test to the next one: each test starts with a rise, which is taken at once
+
+static teleinfo_t frame(const uint8_t isousc, const uint32_t papp) {
+    teleinfo_t frame;
+    frame.phases = 1;
+    frame.ISOUSC = isousc;
+    frame.setPresent(TELEINFO_FIELD_ISOUSC);
+    frame.PAPP = papp;
+    frame.setPresent(TELEINFO_FIELD_PAPP);
+    return frame;
+}
+
+void setUp() {
+    hal_native::reset();
+    hal_native::setQuiet(true);
+    teleinfo::initialize();
+    teleinfo::setMode(TELEINFO_MODE_HISTORIC);
+}
+
+void tearDown() {
+}
+
+static void testFilter() {
+    power::onFrame(frame(45, 3000));
+    TEST_ASSERT_EQUAL_UINT32(3000, power::filtered());
+
+    // a fall is smoothed, by a quarter of the difference at each frame
+    power::onFrame(frame(45, 2000));
+    TEST_ASSERT_EQUAL_UINT32(2750, power::filtered());
+    for (uint8_t i = 0; i < 40; i++) {
+        power::onFrame(frame(45, 2000));
+    }
+    TEST_ASSERT_INT_WITHIN(1, 2000, power::filtered());
+
+    // a rise is taken at once
+    power::onFrame(frame(45, 4000));
+    TEST_ASSERT_EQUAL_UINT32(4000, power::filtered());
+
+    // a frame without PAPP does not change it
+    teleinfo_t withoutPapp;
+    withoutPapp.phases = 1;
+    power::onFrame(withoutPapp);
+    TEST_ASSERT_EQUAL_UINT32(4000, power::filtered());
+}
+
+static void testHistoricHeadroom() {
+    power::onFrame(frame(45, 5000));
+
+    // 45 A * 230 V = 10350 VA, 5350 VA free = 23.26 A
+    TEST_ASSERT_EQUAL_INT16(5350L * DECIAMPS_PER_AMP / POWER_NOMINAL_VOLTAGE, power::headroom(frame(45, 5000), 100));
+    // 10350 * 90% = 9315 VA, 4315 VA free
+    TEST_ASSERT_EQUAL_INT16(4315L * DECIAMPS_PER_AMP / POWER_NOMINAL_VOLTAGE, power::headroom(frame(45, 5000), 90));
+}
+
+static void testStandardHeadroom() {
+    teleinfo::setMode(TELEINFO_MODE_STANDARD);
+    power::onFrame(frame(45, 6000));
+
+    // ISOUSC 45 is PREF 9 kVA: 3000 VA free
+    TEST_ASSERT_EQUAL_INT16(3000L * DECIAMPS_PER_AMP / POWER_NOMINAL_VOLTAGE, power::headroom(frame(45, 6000), 100));
+}
+
+static void testNegativeHeadroom() {
+    power::onFrame(frame(30, 7000));
+
+    // 6900 - 7000 VA = -0.43 A, rounded down to -0.5 A, on the safe side
+    TEST_ASSERT_EQUAL_INT16(-5, power::headroom(frame(30, 7000), 100));
+}
+
+static void testAvailable() {
+    teleinfo_t single = frame(45, 8000);
+    power::onFrame(single);
+    TEST_ASSERT_EQUAL(POWER_HEADROOM != 0, power::available(single));
+
+    // not on three-phase meters, nor without PAPP
+    teleinfo_t threePhase = single;
+    threePhase.phases = 3;
+    TEST_ASSERT_FALSE(power::available(threePhase));
+
+    teleinfo_t withoutPapp;
+    withoutPapp.phases = 1;
+    TEST_ASSERT_FALSE(power::available(withoutPapp));
+}
+
+static void testSaggingVoltage() {
+    // 40 A at 220 V: PAPP converted at the nominal voltage is below the current
+    teleinfo_t sagging = frame(45, 40 * 220);
+    sagging.IINST = 40;
+    sagging.setPresent(TELEINFO_FIELD_IINST);
+    power::onFrame(sagging);
+
+    // the historic meter cuts on the current: the headroom is the one of IINST
+    TEST_ASSERT_EQUAL_INT16(50, power::headroom(sagging, 100));
+
+    // the standard meter cuts on the power
+    teleinfo::setMode(TELEINFO_MODE_STANDARD);
+    TEST_ASSERT_EQUAL_INT16((9000L - 40 * 220) * DECIAMPS_PER_AMP / POWER_NOMINAL_VOLTAGE, power::headroom(sagging, 100));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testFilter);
+    RUN_TEST(testHistoricHeadroom);
+    RUN_TEST(testStandardHeadroom);
+    RUN_TEST(testNegativeHeadroom);
+    RUN_TEST(testAvailable);
+    RUN_TEST(testSaggingVoltage);
+    return UNITY_END();
+}
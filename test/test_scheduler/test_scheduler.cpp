@@ -0,0 +1,180 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "hal/native/hal_native.h"
+#include "scheduler/scheduler.h"
+
+// Order and time of the runs of the scheduler tasks
+
+// tasks run, in order, with the time of their run
+static const uint8_t RUNS_SIZE = 32;
+static char runs[RUNS_SIZE];
+static uint32_t runTimes[RUNS_SIZE];
+static uint8_t runCount;
+
+static void record(const char task) {
+    if (runCount < RUNS_SIZE) {
+        runs[runCount] = task;
+        runTimes[runCount] = millis();
+        runCount++;
+    }
+}
+
+static void runA() {
+    record('a');
+}
+
+static void runB() {
+    record('b');
+}
+
+static void runC() {
+    record('c');
+}
+
+// run the scheduler as loop() would, once per ms
+static void runFor(const uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+        scheduler::run();
+        hal_native::advance(1000);
+    }
+}
+
+void setUp() {
+    hal_native::reset();
+    hal_native::setQuiet(true);
+    scheduler::initialize();
+    memset(runs, 0, sizeof(runs));
+    runCount = 0;
+}
+
+void tearDown() {
+}
+
+static void testDeadlineOrder() {
+    scheduler_task_t a = scheduler::add(runA);
+    scheduler_task_t b = scheduler::add(runB);
+    scheduler_task_t c = scheduler::add(runC);
+
+    scheduler::runIn(a, 300);
+    scheduler::runIn(b, 100);
+    scheduler::runIn(c, 200);
+    runFor(1000);
+
+    TEST_ASSERT_EQUAL_STRING("bca", runs);
+    TEST_ASSERT_INT_WITHIN(SCHEDULER_TICK_MS, 100, runTimes[0]);
+    TEST_ASSERT_INT_WITHIN(SCHEDULER_TICK_MS, 200, runTimes[1]);
+    TEST_ASSERT_INT_WITHIN(SCHEDULER_TICK_MS, 300, runTimes[2]);
+}
+
+static void testNotRunEarly() {
+    // deadlines more than a turn of the wheel ahead share their slot with earlier ones
+    scheduler_task_t a = scheduler::add(runA);
+    scheduler_task_t b = scheduler::add(runB);
+
+    scheduler::runIn(a, SCHEDULER_WHEEL_SLOTS * SCHEDULER_TICK_MS * 3 + 50);
+    scheduler::runIn(b, 50);
+    runFor(SCHEDULER_WHEEL_SLOTS * SCHEDULER_TICK_MS * 3);
+
+    TEST_ASSERT_EQUAL_STRING("b", runs);
+    TEST_ASSERT_TRUE(scheduler::isScheduled(a));
+
+    runFor(100);
+    TEST_ASSERT_EQUAL_STRING("ba", runs);
+    TEST_ASSERT_GREATER_OR_EQUAL(SCHEDULER_WHEEL_SLOTS * SCHEDULER_TICK_MS * 3 + 50, runTimes[1]);
+    TEST_ASSERT_FALSE(scheduler::isScheduled(a));
+}
+
+static void testPeriodicAndEvents() {
+    scheduler_task_t a = scheduler::add(runA);
+    scheduler_task_t b = scheduler::add(runB);
+
+    scheduler::runEvery(a, 100);
+    runFor(250);
+    // an event runs the task at the next run, before the next deadline
+    scheduler::runNow(b);
+    runFor(100);
+
+    TEST_ASSERT_EQUAL_STRING("aaba", runs);
+    TEST_ASSERT_EQUAL_UINT32(250, runTimes[2]);
+    TEST_ASSERT_TRUE(scheduler::isScheduled(a));
+}
+
+static void testCancel() {
+    scheduler_task_t a = scheduler::add(runA);
+    scheduler_task_t b = scheduler::add(runB);
+
+    scheduler::runIn(a, 100);
+    scheduler::runEvery(b, 50);
+    runFor(60);
+    scheduler::cancel(a);
+    scheduler::cancel(b);
+    runFor(200);
+
+    TEST_ASSERT_EQUAL_STRING("b", runs);
+}
+
+static void testLateRun() {
+    // a run late by more than a turn of the wheel still runs the due tasks, and only them
+    scheduler_task_t a = scheduler::add(runA);
+    scheduler_task_t b = scheduler::add(runB);
+    scheduler_task_t c = scheduler::add(runC);
+
+    scheduler::runIn(a, 40);
+    scheduler::runIn(b, 20);
+    scheduler::runIn(c, 5000);
+    hal_native::advance(SCHEDULER_WHEEL_SLOTS * SCHEDULER_TICK_MS * 2 * 1000UL);
+    scheduler::run();
+
+    TEST_ASSERT_EQUAL_UINT8(2, runCount);
+    TEST_ASSERT_TRUE(scheduler::isScheduled(c));
+}
+
+static void testIdleTime() {
+    scheduler_task_t a = scheduler::add(runA);
+
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFF, scheduler::idleTime());
+    scheduler::runIn(a, 500);
+    TEST_ASSERT_INT_WITHIN(SCHEDULER_TICK_MS, 500, scheduler::idleTime());
+    scheduler::runNow(a);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler::idleTime());
+}
+
+static void testMillisWrap() {
+    // millis() wraps 10s after the start
+    while (millis() < 0xFFFFFFFF - 10000) {
+        uint32_t remaining = 0xFFFFFFFF - 10000 - millis();
+        hal_native::advance(remaining < 4000000 ? remaining * 1000 : 4000000000UL);
+    }
+    scheduler::initialize();
+
+    scheduler_task_t a = scheduler::add(runA);
+    scheduler_task_t b = scheduler::add(runB);
+    scheduler::runEvery(a, 1000);
+    scheduler::runIn(b, 15000);
+    TEST_ASSERT_INT_WITHIN(SCHEDULER_TICK_MS, 1000, scheduler::idleTime());
+
+    // the periodic task keeps its period across the wrap, the one-shot runs after it
+    runFor(20500);
+    TEST_ASSERT_EQUAL_UINT8(21, runCount);
+    TEST_ASSERT_EQUAL_CHAR('b', runs[15]);
+    for (uint8_t i = 1; i < runCount; i++) {
+        if (runs[i] == 'a' && runs[i - 1] == 'a') {
+            TEST_ASSERT_EQUAL_UINT32(1000, runTimes[i] - runTimes[i - 1]);
+        }
+    }
+    TEST_ASSERT_LESS_THAN(20000, millis());
+    TEST_ASSERT_INT_WITHIN(SCHEDULER_TICK_MS, 500, scheduler::idleTime());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testDeadlineOrder);
+    RUN_TEST(testNotRunEarly);
+    RUN_TEST(testPeriodicAndEvents);
+    RUN_TEST(testCancel);
+    RUN_TEST(testLateRun);
+    RUN_TEST(testIdleTime);
+    RUN_TEST(testMillisWrap);
+    return UNITY_END();
+}
@@ -0,0 +1,243 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "hal/native/hal_native.h"
+#include "teleinfo/teleinfo.h"
+
+// Parsing of teleinfo frames fed to the in-memory byte source, in both modes
+
+static char frame[512];
+
+// start a frame
+static void startFrame() {
+    frame[0] = TELEINFO_STX;
+    frame[1] = '\0';
+}
+
+// add a line with its checksum, or with a wrong one
+// historic mode: the separator before the checksum is not part of it, standard mode: it is
+static void addLine(const char* label, const char* value, const char separator, const bool validChecksum = true) {
+    char* line = frame + strlen(frame);
+    sprintf(line, "%c%s%c%s%c", TELEINFO_LF, label, separator, value, separator);
+
+    uint8_t sum = 0;
+    size_t end = strlen(line) - (separator == TELEINFO_HISTORIC_SEPARATOR ? 1 : 0);
+    for (size_t i = 1; i < end; i++) {
+        sum += (uint8_t)line[i];
+    }
+    char checksum = (sum & 0x3F) + 0x20;
+    if (!validChecksum) {
+        checksum = checksum == 0x20 ? 0x21 : checksum - 1;
+    }
+
+    sprintf(line + strlen(line), "%c%c", checksum, TELEINFO_CR);
+}
+
+// end the frame and parse it, returns true if it was published
+static bool parseFrame() {
+    sprintf(frame + strlen(frame), "%c", TELEINFO_ETX);
+    hal_native::feedMeter(frame, strlen(frame));
+
+    bool published = false;
+    while (hal_native::meterPending() > 0) {
+        published |= teleinfo::process();
+    }
+
+    return published;
+}
+
+// values given to the subscriber
+static uint8_t notifications;
+static teleinfo_field_t notifiedField;
+static uint32_t notifiedValue;
+
+static void onField(const teleinfo_field_t field, const uint32_t value) {
+    notifications++;
+    notifiedField = field;
+    notifiedValue = value;
+}
+
+void setUp() {
+    hal_native::reset();
+    hal_native::setQuiet(true);
+    teleinfo::initialize();
+}
+
+void tearDown() {
+}
+
+static void testHistoricFrame() {
+    teleinfo::setMode(TELEINFO_MODE_HISTORIC);
+
+    startFrame();
+    addLine("ADCO", "041876097115", TELEINFO_HISTORIC_SEPARATOR);
+    addLine("ISOUSC", "45", TELEINFO_HISTORIC_SEPARATOR);
+    addLine("IINST", "012", TELEINFO_HISTORIC_SEPARATOR);
+    addLine("PAPP", "02760", TELEINFO_HISTORIC_SEPARATOR);
+    uint16_t sequence = teleinfo::frameSequence();
+    TEST_ASSERT_TRUE(parseFrame());
+
+    const teleinfo_t &read = teleinfo::read();
+    TEST_ASSERT_EQUAL_UINT16(sequence + 1, teleinfo::frameSequence());
+    TEST_ASSERT_EQUAL_UINT8(45, read.ISOUSC);
+    TEST_ASSERT_EQUAL_UINT8(12, read.IINST);
+    TEST_ASSERT_EQUAL_UINT32(2760, read.PAPP);
+    TEST_ASSERT_EQUAL_UINT8(1, read.phases);
+    TEST_ASSERT_TRUE(read.has(TELEINFO_FIELD_IINST));
+    TEST_ASSERT_FALSE(read.has(TELEINFO_FIELD_ADPS));
+}
+
+static void testHistoricThreePhaseFrame() {
+    teleinfo::setMode(TELEINFO_MODE_HISTORIC);
+
+    startFrame();
+    addLine("ISOUSC", "20", TELEINFO_HISTORIC_SEPARATOR);
+    addLine("IINST1", "005", TELEINFO_HISTORIC_SEPARATOR);
+    addLine("IINST2", "018", TELEINFO_HISTORIC_SEPARATOR);
+    addLine("IINST3", "002", TELEINFO_HISTORIC_SEPARATOR);
+    TEST_ASSERT_TRUE(parseFrame());
+
+    const teleinfo_t &read = teleinfo::read();
+    TEST_ASSERT_EQUAL_UINT8(3, read.phases);
+    TEST_ASSERT_EQUAL_UINT8(18, read.IINST2);
+}
+
+static void testHistoricChecksumRejected() {
+    teleinfo::setMode(TELEINFO_MODE_HISTORIC);
+
+    startFrame();
+    addLine("ISOUSC", "45", TELEINFO_HISTORIC_SEPARATOR);
+    addLine("IINST", "012", TELEINFO_HISTORIC_SEPARATOR, false);
+    uint16_t sequence = teleinfo::frameSequence();
+    TEST_ASSERT_FALSE(parseFrame());
+    TEST_ASSERT_EQUAL_UINT16(sequence, teleinfo::frameSequence());
+
+    // the next valid frame is published
+    startFrame();
+    addLine("ISOUSC", "45", TELEINFO_HISTORIC_SEPARATOR);
+    addLine("IINST", "013", TELEINFO_HISTORIC_SEPARATOR);
+    TEST_ASSERT_TRUE(parseFrame());
+    TEST_ASSERT_EQUAL_UINT8(13, teleinfo::read().IINST);
+}
+
+static void testHistoricInterruptedFrame() {
+    teleinfo::setMode(TELEINFO_MODE_HISTORIC);
+
+    startFrame();
+    addLine("ISOUSC", "45", TELEINFO_HISTORIC_SEPARATOR);
+    sprintf(frame + strlen(frame), "%c", TELEINFO_EOT);
+    addLine("IINST", "012", TELEINFO_HISTORIC_SEPARATOR);
+    TEST_ASSERT_FALSE(parseFrame());
+}
+
+static void testStandardFrame() {
+    teleinfo::setMode(TELEINFO_MODE_STANDARD);
+
+    startFrame();
+    addLine("ADSC", "041876097115", TELEINFO_STANDARD_SEPARATOR);
+    // a line with a date field before its value
+    addLine("DATE", "H081225223518\t", TELEINFO_STANDARD_SEPARATOR);
+    addLine("IRMS1", "009", TELEINFO_STANDARD_SEPARATOR);
+    addLine("PREF", "09", TELEINFO_STANDARD_SEPARATOR);
+    addLine("SINSTS", "02070", TELEINFO_STANDARD_SEPARATOR);
+    TEST_ASSERT_TRUE(parseFrame());
+
+    // standard labels are mapped on the historic fields, the subscribed power in kVA on ISOUSC in A
+    const teleinfo_t &read = teleinfo::read();
+    TEST_ASSERT_EQUAL_UINT8(9 * TELEINFO_STANDARD_AMPS_PER_KVA, read.ISOUSC);
+    TEST_ASSERT_EQUAL_UINT8(9, read.IINST);
+    TEST_ASSERT_EQUAL_UINT32(2070, read.PAPP);
+    TEST_ASSERT_EQUAL_UINT8(1, read.phases);
+}
+
+static void testStandardChecksumRejected() {
+    teleinfo::setMode(TELEINFO_MODE_STANDARD);
+
+    startFrame();
+    addLine("IRMS1", "009", TELEINFO_STANDARD_SEPARATOR);
+    addLine("PREF", "09", TELEINFO_STANDARD_SEPARATOR, false);
+    uint16_t sequence = teleinfo::frameSequence();
+    TEST_ASSERT_FALSE(parseFrame());
+    TEST_ASSERT_EQUAL_UINT16(sequence, teleinfo::frameSequence());
+}
+
+static void testStandardHistoricChecksum() {
+    // a checksum computed without the last separator, as in historic mode, is rejected in standard mode
+    teleinfo::setMode(TELEINFO_MODE_STANDARD);
+
+    startFrame();
+    addLine("IRMS1", "009", TELEINFO_HISTORIC_SEPARATOR);
+    char* separator = strchr(frame, TELEINFO_HISTORIC_SEPARATOR);
+    while (separator != NULL) {
+        *separator = TELEINFO_STANDARD_SEPARATOR;
+        separator = strchr(separator, TELEINFO_HISTORIC_SEPARATOR);
+    }
+    TEST_ASSERT_FALSE(parseFrame());
+}
+
+static void testPresenceBits() {
+    teleinfo::setMode(TELEINFO_MODE_HISTORIC);
+
+    startFrame();
+    addLine("ISOUSC", "45", TELEINFO_HISTORIC_SEPARATOR);
+    addLine("ADPS", "047", TELEINFO_HISTORIC_SEPARATOR);
+    TEST_ASSERT_TRUE(parseFrame());
+    TEST_ASSERT_TRUE(teleinfo::read().has(TELEINFO_FIELD_ADPS));
+
+    // the fields of the previous frame are not carried over
+    startFrame();
+    addLine("ISOUSC", "45", TELEINFO_HISTORIC_SEPARATOR);
+    addLine("IINST", "030", TELEINFO_HISTORIC_SEPARATOR);
+    TEST_ASSERT_TRUE(parseFrame());
+    TEST_ASSERT_FALSE(teleinfo::read().has(TELEINFO_FIELD_ADPS));
+    TEST_ASSERT_EQUAL_UINT8(0, teleinfo::read().ADPS);
+    TEST_ASSERT_TRUE(teleinfo::read().has(TELEINFO_FIELD_ISOUSC));
+}
+
+static void testUntrackedLabel() {
+    teleinfo::setMode(TELEINFO_MODE_HISTORIC);
+
+    // an unknown label does not drop the frame
+    startFrame();
+    addLine("ISOUSC", "45", TELEINFO_HISTORIC_SEPARATOR);
+    addLine("XYZZY", "123", TELEINFO_HISTORIC_SEPARATOR);
+    TEST_ASSERT_TRUE(parseFrame());
+    TEST_ASSERT_EQUAL_UINT8(45, teleinfo::read().ISOUSC);
+}
+
+static void testSubscriber() {
+    // the subscriptions are kept by teleinfo::initialize(), subscribe in this test only
+    TEST_ASSERT_TRUE(teleinfo::subscribe(TELEINFO_FIELD_ISOUSC, onField));
+    notifications = 0;
+
+    // the subscriber gets the value in the unit of the historic label, once the line is validated
+    teleinfo::setMode(TELEINFO_MODE_STANDARD);
+    startFrame();
+    addLine("IRMS1", "009", TELEINFO_STANDARD_SEPARATOR);
+    addLine("PREF", "12", TELEINFO_STANDARD_SEPARATOR);
+    TEST_ASSERT_TRUE(parseFrame());
+    TEST_ASSERT_EQUAL_UINT8(1, notifications);
+    TEST_ASSERT_EQUAL(TELEINFO_FIELD_ISOUSC, notifiedField);
+    TEST_ASSERT_EQUAL_UINT32(12 * TELEINFO_STANDARD_AMPS_PER_KVA, notifiedValue);
+
+    // not on an invalid line
+    startFrame();
+    addLine("PREF", "12", TELEINFO_STANDARD_SEPARATOR, false);
+    parseFrame();
+    TEST_ASSERT_EQUAL_UINT8(1, notifications);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testHistoricFrame);
+    RUN_TEST(testHistoricThreePhaseFrame);
+    RUN_TEST(testHistoricChecksumRejected);
+    RUN_TEST(testHistoricInterruptedFrame);
+    RUN_TEST(testStandardFrame);
+    RUN_TEST(testStandardChecksumRejected);
+    RUN_TEST(testStandardHistoricChecksum);
+    RUN_TEST(testPresenceBits);
+    RUN_TEST(testUntrackedLabel);
+    RUN_TEST(testSubscriber);
+    return UNITY_END();
+}
@@ -0,0 +1,98 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "hal/native/hal_native.h"
+#include "timeseries/timeseries.h"
+
+// Round-trip of the zigzag varints and of the delta encoding of the samples
+
+void setUp() {
+    hal_native::reset();
+    hal_native::setQuiet(true);
+}
+
+void tearDown() {
+}
+
+static void testVarintRoundTrip() {
+    const int32_t values[] = { 0, 1, -1, 63, -64, 64, -65, 8191, -8192, 8192, 1000000, -1000000, 0x7FFFFFFF, -0x7FFFFFFF - 1 };
+
+    for (uint8_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        uint8_t data[8];
+        memset(data, 0xAA, sizeof(data));
+
+        uint8_t written = timeseries::writeVarint(data, values[i]);
+        int32_t value = 0;
+        uint8_t read = timeseries::readVarint(data, value);
+
+        TEST_ASSERT_EQUAL_INT32(values[i], value);
+        TEST_ASSERT_EQUAL_UINT8(written, read);
+        TEST_ASSERT_LESS_OR_EQUAL(5, written);
+    }
+}
+
+static void testVarintLength() {
+    uint8_t data[8];
+
+    // zigzag: small values take a byte, whatever their sign
+    TEST_ASSERT_EQUAL_UINT8(1, timeseries::writeVarint(data, 0));
+    TEST_ASSERT_EQUAL_UINT8(1, timeseries::writeVarint(data, 63));
+    TEST_ASSERT_EQUAL_UINT8(1, timeseries::writeVarint(data, -64));
+    TEST_ASSERT_EQUAL_UINT8(2, timeseries::writeVarint(data, 64));
+    TEST_ASSERT_EQUAL_UINT8(2, timeseries::writeVarint(data, -65));
+    TEST_ASSERT_EQUAL_UINT8(5, timeseries::writeVarint(data, -0x7FFFFFFF - 1));
+}
+
+static void testSampleRoundTrip() {
+    timeseries_sample_t previous = { 12, 2760, 160, 3 << TIMESERIES_STATE_SHIFT };
+    timeseries_sample_t sample = { 9, 2070, 140, TIMESERIES_FLAG_OVERCURRENT | 4 << TIMESERIES_STATE_SHIFT };
+
+    uint8_t data[TIMESERIES_SAMPLE_MAX_SIZE];
+    uint8_t written = timeseries::encode(data, sample, previous);
+
+    timeseries_sample_t decoded = previous;
+    TEST_ASSERT_EQUAL_UINT8(written, timeseries::decode(data, decoded));
+    TEST_ASSERT_EQUAL_UINT8(sample.current, decoded.current);
+    TEST_ASSERT_EQUAL_UINT32(sample.power, decoded.power);
+    TEST_ASSERT_EQUAL_INT16(sample.command, decoded.command);
+    TEST_ASSERT_EQUAL_UINT8(sample.flags, decoded.flags);
+}
+
+static void testSampleUnchanged() {
+    // only the header is stored for a sample like the previous one
+    timeseries_sample_t sample = { 12, 2760, 160, 3 << TIMESERIES_STATE_SHIFT };
+
+    uint8_t data[TIMESERIES_SAMPLE_MAX_SIZE];
+    TEST_ASSERT_EQUAL_UINT8(1, timeseries::encode(data, sample, sample));
+
+    timeseries_sample_t decoded = sample;
+    TEST_ASSERT_EQUAL_UINT8(1, timeseries::decode(data, decoded));
+    TEST_ASSERT_EQUAL_UINT32(sample.power, decoded.power);
+}
+
+static void testSampleExtremes() {
+    // the first sample of a block is the difference with a zero sample
+    timeseries_sample_t zero = { 0, 0, 0, 0 };
+    timeseries_sample_t sample = { 255, 0xFFFFFFFF, VIRIDIAN_MAX_RANGE_CURRENT, TIMESERIES_FLAG_NO_METER | 7 << TIMESERIES_STATE_SHIFT };
+
+    uint8_t data[TIMESERIES_SAMPLE_MAX_SIZE];
+    uint8_t written = timeseries::encode(data, sample, zero);
+    TEST_ASSERT_LESS_OR_EQUAL(TIMESERIES_SAMPLE_MAX_SIZE, written);
+
+    timeseries_sample_t decoded = zero;
+    TEST_ASSERT_EQUAL_UINT8(written, timeseries::decode(data, decoded));
+    TEST_ASSERT_EQUAL_UINT8(255, decoded.current);
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFF, decoded.power);
+    TEST_ASSERT_EQUAL_INT16(VIRIDIAN_MAX_RANGE_CURRENT, decoded.command);
+    TEST_ASSERT_EQUAL_UINT8(sample.flags, decoded.flags);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testVarintRoundTrip);
+    RUN_TEST(testVarintLength);
+    RUN_TEST(testSampleRoundTrip);
+    RUN_TEST(testSampleUnchanged);
+    RUN_TEST(testSampleExtremes);
+    return UNITY_END();
+}
@@ -0,0 +1,137 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "calibration/calibration.h"
+#include "hal/native/hal_native.h"
+#include "viridian/viridian.h"
+
+// Mapping of the charging current to the DAC value sent to the car, and its bounds
+
+static calibration chargerCalibration;
+static viridian charger;
+
+// run the ramp of the DAC until it reaches its target
+static void settle() {
+    for (uint16_t i = 0; i < 200; i++) {
+        hal_native::advance(DAC_MCP4725_RAMP_PERIOD * 1000);
+        charger.update();
+    }
+}
+
+void setUp() {
+    hal_native::reset();
+    hal_native::setQuiet(true);
+    chargerCalibration.initialize(0);
+    charger.initialize(0, chargerCalibration, 0);
+}
+
+void tearDown() {
+}
+
+static void testDacTableBounds() {
+    // the ends of the working range are the IC equivalent voltages, corrected by the measured offset
+    const double perDeciamp = (VIRIDIAN_MAX_RANGE_ICV - VIRIDIAN_MIN_RANGE_ICV) / (VIRIDIAN_MAX_RANGE_CURRENT - VIRIDIAN_MIN_RANGE_CURRENT);
+    const double minimum = (VIRIDIAN_MIN_RANGE_ICV + VIRIDIAN_MEASURED_OFFSET * perDeciamp) / VIRIDIAN_DAC_MAX_V * VIRIDIAN_DAC_MAX_Q;
+    const double maximum = (VIRIDIAN_MAX_RANGE_ICV + VIRIDIAN_MEASURED_OFFSET * perDeciamp) / VIRIDIAN_DAC_MAX_V * VIRIDIAN_DAC_MAX_Q;
+
+    TEST_ASSERT_INT_WITHIN(1, (int)minimum, viridian::dacValue(VIRIDIAN_MIN_RANGE_CURRENT));
+    TEST_ASSERT_INT_WITHIN(1, (int)maximum, viridian::dacValue(VIRIDIAN_MAX_RANGE_CURRENT));
+    TEST_ASSERT_LESS_OR_EQUAL(VIRIDIAN_DAC_MAX_Q, viridian::dacValue(VIRIDIAN_MAX_RANGE_CURRENT));
+}
+
+static void testDacTableIncreasing() {
+    for (deciamps_t current = VIRIDIAN_MIN_RANGE_CURRENT + 1; current <= VIRIDIAN_MAX_RANGE_CURRENT; current++) {
+        TEST_ASSERT_GREATER_OR_EQUAL(viridian::dacValue(current - 1), viridian::dacValue(current));
+    }
+    // one amp is always a different command
+    for (deciamps_t current = VIRIDIAN_MIN_RANGE_CURRENT + DECIAMPS_PER_AMP; current <= VIRIDIAN_MAX_RANGE_CURRENT; current++) {
+        TEST_ASSERT_GREATER_THAN(viridian::dacValue(current - DECIAMPS_PER_AMP), viridian::dacValue(current));
+    }
+}
+
+static void testCurrentInRange() {
+    charger.setChargingCurrent(160);
+    settle();
+
+    TEST_ASSERT_EQUAL_INT16(160, charger.getChargingCurrent());
+    TEST_ASSERT_TRUE(charger.currentChanged());
+    TEST_ASSERT_EQUAL_UINT16(viridian::dacValue(160), hal_native::dacValue());
+}
+
+static void testCurrentAboveRange() {
+    charger.setChargingCurrent(VIRIDIAN_MAX_RANGE_CURRENT + 50);
+    settle();
+
+    TEST_ASSERT_EQUAL_INT16(VIRIDIAN_MAX_RANGE_CURRENT, charger.getChargingCurrent());
+    TEST_ASSERT_EQUAL_UINT16(viridian::dacValue(VIRIDIAN_MAX_RANGE_CURRENT), hal_native::dacValue());
+}
+
+static void testCurrentBelowRange() {
+    charger.setChargingCurrent(160);
+    settle();
+
+    // below the working range, the charge is stopped at once
+    charger.setChargingCurrent(VIRIDIAN_MIN_RANGE_CURRENT - 1);
+    TEST_ASSERT_EQUAL_INT16(0, charger.getChargingCurrent());
+    TEST_ASSERT_EQUAL_UINT16(0, hal_native::dacValue());
+}
+
+static void testIncreaseRamped() {
+    charger.setChargingCurrent(VIRIDIAN_MAX_RANGE_CURRENT);
+
+    // a start goes straight to the minimum of the range, then ramps up
+    TEST_ASSERT_EQUAL_UINT16(viridian::dacValue(VIRIDIAN_MIN_RANGE_CURRENT), hal_native::dacValue());
+    hal_native::advance(DAC_MCP4725_RAMP_PERIOD * 1000);
+    charger.update();
+    TEST_ASSERT_GREATER_THAN(viridian::dacValue(VIRIDIAN_MIN_RANGE_CURRENT), hal_native::dacValue());
+    TEST_ASSERT_LESS_THAN(viridian::dacValue(VIRIDIAN_MAX_RANGE_CURRENT), hal_native::dacValue());
+}
+
+static void testDacFailure() {
+    charger.setChargingCurrent(160);
+    settle();
+    charger.resetChange();
+
+    // the DAC stops answering during an increase: the charge is stopped
+    hal_native::setI2CError(2);
+    charger.setChargingCurrent(200);
+    hal_native::advance(DAC_MCP4725_RAMP_PERIOD * 1000);
+    charger.update();
+    TEST_ASSERT_EQUAL_INT16(0, charger.getChargingCurrent());
+    TEST_ASSERT_TRUE(charger.currentChanged());
+
+    // and no charge is started while it fails
+    charger.setChargingCurrent(160);
+    TEST_ASSERT_EQUAL_INT16(0, charger.getChargingCurrent());
+
+    // the DAC answers again, it is only written after the retry period
+    hal_native::setI2CError(0);
+    uint32_t writes = hal_native::dacWrites();
+    for (uint32_t elapsed = DAC_MCP4725_RAMP_PERIOD; elapsed < DAC_MCP4725_RETRY_PERIOD; elapsed += DAC_MCP4725_RAMP_PERIOD) {
+        hal_native::advance(DAC_MCP4725_RAMP_PERIOD * 1000);
+        charger.update();
+    }
+    TEST_ASSERT_EQUAL_UINT32(writes, hal_native::dacWrites());
+
+    hal_native::advance(DAC_MCP4725_RAMP_PERIOD * 1000);
+    charger.update();
+    TEST_ASSERT_EQUAL_UINT16(0, hal_native::dacValue());
+
+    // then the charge can start again
+    charger.setChargingCurrent(160);
+    settle();
+    TEST_ASSERT_EQUAL_INT16(160, charger.getChargingCurrent());
+    TEST_ASSERT_EQUAL_UINT16(viridian::dacValue(160), hal_native::dacValue());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testDacTableBounds);
+    RUN_TEST(testDacTableIncreasing);
+    RUN_TEST(testCurrentInRange);
+    RUN_TEST(testCurrentAboveRange);
+    RUN_TEST(testCurrentBelowRange);
+    RUN_TEST(testIncreaseRamped);
+    RUN_TEST(testDacFailure);
+    return UNITY_END();
+}
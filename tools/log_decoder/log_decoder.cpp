@@ -0,0 +1,155 @@
+#include <Arduino.h>
+
+#include "logger/logger.h"
+
+// Decoder of the tokenized logs of the logger
+// reads the binary stream sent by the Arduino and prints one line per message
+//
+// usage: log_decoder [file]
+//   without file, or with -: read the standard input (e.g. a serial port dumped with cat)
+
+typedef struct decoder_message_t decoder_message_t;
+struct decoder_message_t {
+    const char* name;
+    const char* text;
+};
+
+#define DECODER_MESSAGE(id, text) { #id, text },
+static const decoder_message_t DECODER_MESSAGES[LOGGER_MESSAGE_COUNT] = {
+    LOGGER_MESSAGES(DECODER_MESSAGE)
+};
+#undef DECODER_MESSAGE
+
+// bytes skipped while looking for the start of a message
+static uint32_t skipped;
+
+// read an argument and print it, returns false if the stream is not a valid argument
+static bool decodeArgument(FILE* input) {
+    int type = fgetc(input);
+    if (type == EOF) {
+        return false;
+    }
+
+    uint8_t size = type & LOGGER_SIZE_MASK;
+
+    if ((type & LOGGER_TYPE_MASK) == LOGGER_TYPE_STRING) {
+        int length = fgetc(input);
+        if (length == EOF || length > LOGGER_STRING_MAX_LENGTH) {
+            return false;
+        }
+
+        char value[LOGGER_STRING_MAX_LENGTH + 1];
+        if (fread(value, 1, length, input) != (size_t)length) {
+            return false;
+        }
+        value[length] = '\0';
+        fputs(value, stdout);
+        return true;
+    }
+
+    if (size != 1 && size != 2 && size != 4) {
+        return false;
+    }
+
+    // little endian
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < size; i++) {
+        int c = fgetc(input);
+        if (c == EOF) {
+            return false;
+        }
+        value |= (uint32_t)c << (8 * i);
+    }
+
+    switch (type & LOGGER_TYPE_MASK) {
+        case LOGGER_TYPE_UNSIGNED:
+            printf("%u", value);
+            return true;
+        case LOGGER_TYPE_SIGNED: {
+            // sign extension from the size of the value
+            uint8_t shift = 32 - 8 * size;
+            printf("%d", (int32_t)(value << shift) >> shift);
+            return true;
+        }
+        case LOGGER_TYPE_FLOAT: {
+            if (size != sizeof(float)) {
+                return false;
+            }
+            float single;
+            memcpy(&single, &value, sizeof(single));
+            // 2 decimals, as String(float) on the Arduino
+            printf("%.2f", single);
+            return true;
+        }
+        case LOGGER_TYPE_CHAR:
+            fputc(value, stdout);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// decode the message following a sync byte, returns false if it is not a valid message
+static bool decodeMessage(FILE* input) {
+    int id = fgetc(input);
+    if (id == EOF || id >= LOGGER_MESSAGE_COUNT) {
+        return false;
+    }
+
+    const char* text = DECODER_MESSAGES[id].text;
+    while (*text != '\0') {
+        if (text[0] == '{' && text[1] == '}') {
+            if (!decodeArgument(input)) {
+                printf(" <truncated>\n");
+                return false;
+            }
+            text += 2;
+        } else {
+            fputc(*text, stdout);
+            text++;
+        }
+    }
+
+    fputc('\n', stdout);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    FILE* input = stdin;
+
+    if (argc > 2) {
+        fprintf(stderr, "usage: %s [file]\n", argv[0]);
+        return 1;
+    }
+
+    if (argc == 2 && strcmp(argv[1], "-") != 0) {
+        input = fopen(argv[1], "rb");
+        if (input == NULL) {
+            fprintf(stderr, "cannot open %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+    int c;
+    while ((c = fgetc(input)) != EOF) {
+        if (c != LOGGER_SYNC) {
+            // not the start of a message: the stream was joined in the middle of a message
+            skipped++;
+            continue;
+        }
+
+        if (skipped > 0) {
+            printf("<%u bytes skipped>\n", skipped);
+            skipped = 0;
+        }
+
+        decodeMessage(input);
+        fflush(stdout);
+    }
+
+    if (skipped > 0) {
+        printf("<%u bytes skipped>\n", skipped);
+    }
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <Arduino.h>
+
+#include <unistd.h>
+
+#include "simulator.h"
+
+// Simulation of a charge session with the firmware of the board, prints its results
+//
+// usage: simulator [options]
+//   -d hours      duration (24)
+//   -s HH:MM      time of the day at the start (18:00)
+//   -i amps       subscription of the meter, ISOUSC (30)
+//   -g -c -m      options of the board: greater ISOUSC, PI controller, 1A more margin
+//   -a minutes    arrival of the car after the start (30)
+//   -l minutes    departure of the car after the start (end of the simulation)
+//   -e kWh        energy the car needs, 0 for no limit (40)
+//   -L ms         dead time of the car before it follows the pilot (2000)
+//   -r A/s        ramp rate of the car (10)
+//   -M amps       maximum current of the car (32)
+//   -k ratio      current drawn by the car over its pilot (1.0)
+//   -h file.csv   house load: seconds since the start,amps (synthetic day by default)
+//   -S seed       seed of the synthetic day (1)
+//   -t file.csv   trace of each frame: time,house,car,pilot,iinst,adps,command
+//   -v            logs of the firmware on stdout, decode them with tools/log_decoder
+
+static const char SIMULATOR_USAGE[] = "usage: %s [-d hours] [-s HH:MM] [-i amps] [-g] [-c] [-m] [-a minutes] [-l minutes] [-e kWh]\n"
+    "    [-L ms] [-r A/s] [-M amps] [-k ratio] [-h house.csv] [-S seed] [-t trace.csv] [-v]\n";
+
+int main(int argc, char** argv) {
+    simulator_config_t config;
+    simulator::defaults(config);
+
+    const char* house = NULL;
+    const char* trace = NULL;
+    bool departure = false;
+    unsigned int hours, minutes;
+    int option;
+
+    while ((option = getopt(argc, argv, "d:s:i:gcma:l:e:L:r:M:k:h:S:t:v")) != -1) {
+        switch (option) {
+            case 'd':
+                config.duration = atof(optarg) * 3600;
+                break;
+            case 's':
+                if (sscanf(optarg, "%u:%u", &hours, &minutes) != 2 || hours > 23 || minutes > 59) {
+                    fprintf(stderr, "invalid time %s\n", optarg);
+                    return 1;
+                }
+                config.startTime = hours * 3600 + minutes * 60;
+                break;
+            case 'i':
+                config.isousc = atoi(optarg);
+                break;
+            case 'g':
+                config.greaterIsousc = true;
+                break;
+            case 'c':
+                config.controller = true;
+                break;
+            case 'm':
+                config.marginAdd1A = true;
+                break;
+            case 'a':
+                config.arrival = atof(optarg) * 60;
+                break;
+            case 'l':
+                config.departure = atof(optarg) * 60;
+                departure = true;
+                break;
+            case 'e':
+                config.energy = atof(optarg);
+                break;
+            case 'L':
+                config.lag = atoi(optarg);
+                break;
+            case 'r':
+                config.rampRate = atof(optarg);
+                break;
+            case 'M':
+                config.maxCurrent = atof(optarg);
+                break;
+            case 'k':
+                config.ratio = atof(optarg);
+                break;
+            case 'h':
+                house = optarg;
+                break;
+            case 'S':
+                config.seed = strtoul(optarg, NULL, 10);
+                break;
+            case 't':
+                trace = optarg;
+                break;
+            case 'v':
+                config.verbose = true;
+                break;
+            default:
+                fprintf(stderr, SIMULATOR_USAGE, argv[0]);
+                return 1;
+        }
+    }
+
+    if (!departure) {
+        config.departure = config.duration;
+    }
+
+    if (house != NULL) {
+        if (!simulator::loadHouse(house, config)) {
+            return 1;
+        }
+    } else {
+        simulator::syntheticHouse(config);
+    }
+
+    if (trace != NULL) {
+        config.trace = fopen(trace, "w");
+        if (config.trace == NULL) {
+            fprintf(stderr, "cannot open %s\n", trace);
+            return 1;
+        }
+        fprintf(config.trace, "time,house,car,pilot,iinst,adps,command\n");
+    }
+
+    simulator_result_t result;
+    simulator::run(config, result);
+
+    if (config.trace != NULL) {
+        fclose(config.trace);
+    }
+
+    // the logs of the firmware are on stdout with -v
+    if (config.verbose) {
+        fflush(stdout);
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
+    simulator::print(config, result);
+    return 0;
+}
@@ -0,0 +1,431 @@
+#include <Arduino.h>
+
+#include <time.h>
+
+#include "hal/native/hal_native.h"
+#include "chargers/chargers.h"
+#include "inputs/inputs.h"
+#include "scheduler/scheduler.h"
+#include "teleinfo/teleinfo.h"
+
+#include "simulator.h"
+
+// firmware entry points, defined in main.cpp
+void setup();
+void loop();
+
+// maximum number of lines of a frame, and of pilot changes kept for the dead time of the car
+static const uint8_t SIMULATOR_MAX_LINES = 16;
+static const uint8_t SIMULATOR_PILOT_HISTORY = 32;
+
+// loops run without advancing the clock while tasks are ready, before forcing a step
+static const uint8_t SIMULATOR_MAX_SPINS = 4;
+
+// frame of the meter being sent, with the time each of its lines is fully received
+typedef struct simulator_meter_t simulator_meter_t;
+struct simulator_meter_t {
+    char bytes[512];
+    uint16_t ends[SIMULATOR_MAX_LINES];
+    uint8_t lines;
+    uint8_t sent;
+    uint64_t start;
+    bool adps;
+};
+
+typedef struct simulator_pilot_t simulator_pilot_t;
+struct simulator_pilot_t {
+    uint64_t time;
+    float amps;
+};
+
+// state of the models, only valid during run()
+static const simulator_config_t* simConfig;
+static simulator_result_t* simResult;
+static simulator_meter_t simMeter;
+static uint64_t simLast;
+static size_t simHouseIndex;
+static float simCar;
+static bool simCharging;
+static uint16_t simDac;
+static simulator_pilot_t simPilots[SIMULATOR_PILOT_HISTORY];
+static uint8_t simPilotHead;
+
+static uint32_t simRandomState;
+
+static uint32_t simRandom() {
+    // xorshift32
+    simRandomState ^= simRandomState << 13;
+    simRandomState ^= simRandomState >> 17;
+    simRandomState ^= simRandomState << 5;
+    return simRandomState;
+}
+
+static double simHostNow() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static float simHouse(const uint64_t nowUs) {
+    const std::vector<simulator_load_t> &house = simConfig->house;
+
+    // the time only moves forward
+    while (simHouseIndex + 1 < house.size() && house[simHouseIndex + 1].second * 1000000ULL <= nowUs) {
+        simHouseIndex++;
+    }
+    return house.empty() || house[simHouseIndex].second * 1000000ULL > nowUs ? 0 : house[simHouseIndex].amps;
+}
+
+static uint64_t simNextHouseChange() {
+    const std::vector<simulator_load_t> &house = simConfig->house;
+    return simHouseIndex + 1 < house.size() ? house[simHouseIndex + 1].second * 1000000ULL : UINT64_MAX;
+}
+
+// pilot current of the DAC output, the inverse of viridian::dacValue()
+static float simPilot(const uint16_t dac) {
+    if (dac < viridian::dacValue(VIRIDIAN_MIN_RANGE_CURRENT)) {
+        return 0;
+    }
+
+    deciamps_t current = VIRIDIAN_MAX_RANGE_CURRENT;
+    while (current > VIRIDIAN_MIN_RANGE_CURRENT && viridian::dacValue(current) > dac) {
+        current--;
+    }
+    return (float)current / DECIAMPS_PER_AMP;
+}
+
+// pilot current the car sees after its dead time
+static float simDelayedPilot(const uint64_t nowUs) {
+    uint64_t seen = nowUs > simConfig->lag * 1000ULL ? nowUs - simConfig->lag * 1000ULL : 0;
+
+    for (uint8_t i = 1; i <= SIMULATOR_PILOT_HISTORY; i++) {
+        const simulator_pilot_t &pilot = simPilots[(simPilotHead + SIMULATOR_PILOT_HISTORY - i) % SIMULATOR_PILOT_HISTORY];
+        if (pilot.time <= seen) {
+            return pilot.amps;
+        }
+    }
+    return 0;
+}
+
+static void simAddLine(const char* label, const char* value) {
+    simulator_meter_t &meter = simMeter;
+    char text[32];
+    uint8_t sum = 0;
+
+    snprintf(text, sizeof(text), "%s %s", label, value);
+    for (const char* c = text; *c; c++) {
+        sum += *c;
+    }
+
+    size_t length = strlen(meter.bytes);
+    snprintf(meter.bytes + length, sizeof(meter.bytes) - length, "\n%s %c\r", text, (sum & 0x3F) + 0x20);
+    meter.ends[meter.lines++] = strlen(meter.bytes);
+}
+
+// historic single-phase frame, BASE option, with ADPS while the current is above the subscription
+static void simStartFrame(const uint64_t nowUs) {
+    simulator_meter_t &meter = simMeter;
+    float amps = simHouse(nowUs) + simCar;
+    uint16_t iinst = (uint16_t)(amps + 0.5f);
+    char value[16];
+
+    meter.bytes[0] = TELEINFO_STX;
+    meter.bytes[1] = '\0';
+    meter.lines = 0;
+    meter.sent = 0;
+    meter.start = nowUs;
+
+    simAddLine("ADCO", "021728123456");
+    simAddLine("OPTARIF", "BASE");
+    snprintf(value, sizeof(value), "%02u", simConfig->isousc);
+    simAddLine("ISOUSC", value);
+    snprintf(value, sizeof(value), "%09u", (unsigned int)(simResult->energy * 1000));
+    simAddLine("BASE", value);
+    simAddLine("PTEC", "TH..");
+    snprintf(value, sizeof(value), "%03u", iinst);
+    simAddLine("IINST", value);
+    meter.adps = iinst > simConfig->isousc;
+    if (meter.adps) {
+        simAddLine("ADPS", value);
+    }
+    simAddLine("IMAX", "090");
+    snprintf(value, sizeof(value), "%05u", (unsigned int)(amps * simConfig->voltage / 10 + 0.5f) * 10);
+    simAddLine("PAPP", value);
+    simAddLine("HHPHC", "A");
+    simAddLine("MOTDETAT", "000000");
+
+    size_t length = strlen(meter.bytes);
+    meter.bytes[length] = TELEINFO_ETX;
+    meter.bytes[length + 1] = '\0';
+    meter.ends[meter.lines - 1] = length + 1;
+
+    if (meter.adps) {
+        simResult->adpsFrames++;
+    }
+
+    if (simConfig->trace != NULL) {
+        fprintf(simConfig->trace, "%.1f,%.1f,%.1f,%.1f,%u,%u,%.1f\n", nowUs / 1e6, simHouse(nowUs), simCar,
+            simPilot(simDac), iinst, meter.adps ? 1 : 0, (float)chargers::getChargingCurrent() / DECIAMPS_PER_AMP);
+    }
+}
+
+static uint64_t simNextLine() {
+    return simMeter.start + (uint64_t)simMeter.ends[simMeter.sent] * SIMULATOR_US_PER_BYTE;
+}
+
+// models of the environment, run each time the virtual clock advances
+static void simModel(const uint64_t nowUs) {
+    const simulator_config_t &config = *simConfig;
+    simulator_result_t &result = *simResult;
+    double dt = (nowUs - simLast) / 1e6;
+    float house = simHouse(simLast);
+
+    // energy and headroom over the step, with the values at its start
+    float total = house + simCar;
+    if (simCharging) {
+        float cap = config.maxCurrent < VIRIDIAN_MAX_RANGE_CURRENT / DECIAMPS_PER_AMP ? config.maxCurrent : VIRIDIAN_MAX_RANGE_CURRENT / DECIAMPS_PER_AMP;
+        float unused = config.isousc - total;
+        if (unused > cap - simCar) {
+            unused = cap - simCar;
+        }
+        if (unused > 0) {
+            result.unusedHeadroom += unused * dt / 3600;
+        }
+        result.chargeTime += dt;
+    }
+    if (total > config.isousc) {
+        result.overrunTime += dt;
+    }
+    result.energy += simCar * config.voltage * dt / 3.6e6;
+
+    // the car charges between its arrival and departure, until it took its energy
+    uint32_t second = nowUs / 1000000;
+    bool charging = second >= config.arrival && second < config.departure && (config.energy <= 0 || result.energy < config.energy);
+    if (charging != simCharging) {
+        simCharging = charging;
+        hal_native::setPin(INPUTS_CHARGING_CAR_PINS[0], charging ? HIGH : LOW);
+    }
+
+    // the pilot current follows the DAC, the car follows the pilot after its dead time at its ramp rate
+    if (hal_native::dacValue() != simDac) {
+        simDac = hal_native::dacValue();
+        simPilots[simPilotHead].time = nowUs;
+        simPilots[simPilotHead].amps = simPilot(simDac);
+        simPilotHead = (simPilotHead + 1) % SIMULATOR_PILOT_HISTORY;
+    }
+    float target = charging ? simDelayedPilot(nowUs) * config.ratio : 0;
+    if (target > config.maxCurrent) {
+        target = config.maxCurrent;
+    }
+    float step = config.rampRate * dt;
+    if (simCar < target) {
+        simCar = simCar + step < target ? simCar + step : target;
+    } else {
+        simCar = simCar - step > target ? simCar - step : target;
+    }
+
+    simLast = nowUs;
+
+    // send the lines of the meter that are received by now, the next frame follows after a gap
+    while (simNextLine() <= nowUs) {
+        uint64_t lineTime = simNextLine();
+        hal_native::feedMeter(simMeter.bytes + (simMeter.sent > 0 ? simMeter.ends[simMeter.sent - 1] : 0),
+            simMeter.ends[simMeter.sent] - (simMeter.sent > 0 ? simMeter.ends[simMeter.sent - 1] : 0));
+        simMeter.sent++;
+
+        if (simMeter.sent == simMeter.lines) {
+            // the runs of ADPS frames are the overruns
+            bool adps = simMeter.adps;
+            simStartFrame(lineTime + SIMULATOR_FRAME_GAP_US);
+            if (simMeter.adps && !adps) {
+                result.overruns++;
+            }
+        }
+    }
+}
+
+void simulator::defaults(simulator_config_t &config) {
+    config.duration = 24 * 3600;
+    config.startTime = 18 * 3600;
+    config.isousc = 30;
+    config.voltage = 230;
+    config.greaterIsousc = false;
+    config.controller = false;
+    config.marginAdd1A = false;
+    config.arrival = 30 * 60;
+    config.departure = 24 * 3600;
+    config.energy = 40;
+    config.lag = 2000;
+    config.rampRate = 10;
+    config.maxCurrent = 32;
+    config.ratio = 1;
+    config.house.clear();
+    config.seed = 1;
+    config.trace = NULL;
+    config.verbose = false;
+}
+
+bool simulator::loadHouse(const char* path, simulator_config_t &config) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+
+    char line[128];
+    config.house.clear();
+    while (fgets(line, sizeof(line), file) != NULL) {
+        simulator_load_t load;
+        double second;
+
+        // comments, headers and blank lines are skipped
+        if (sscanf(line, "%lf,%f", &second, &load.amps) != 2) {
+            continue;
+        }
+        load.second = (uint32_t)second;
+        if (!config.house.empty() && load.second < config.house.back().second) {
+            fprintf(stderr, "%s: the times must increase (%s)\n", path, line);
+            fclose(file);
+            return false;
+        }
+        config.house.push_back(load);
+    }
+
+    fclose(file);
+    return !config.house.empty();
+}
+
+void simulator::syntheticHouse(simulator_config_t &config) {
+    simRandomState = config.seed != 0 ? config.seed : 1;
+    config.house.clear();
+
+    // one step per minute: a base load with the fridge, the cooking at lunch and dinner, a kettle in
+    // the morning, and the water heater at night, with random variations
+    for (uint32_t minute = 0; minute * 60 < config.duration; minute++) {
+        uint32_t day = (config.startTime / 60 + minute) % (24 * 60);
+        float amps = 1.5f + (simRandom() % 10) / 10.0f;
+
+        // fridge, 10 minutes every half hour
+        if (day % 30 < 10) {
+            amps += 0.8f;
+        }
+        // breakfast, with the kettle
+        if (day >= 7 * 60 && day < 8 * 60) {
+            amps += 3 + (simRandom() % 4 == 0 ? 9 : 0);
+        }
+        // lunch and dinner, the oven and the hobs cycle on their thermostats
+        if ((day >= 12 * 60 && day < 13 * 60) || (day >= 19 * 60 && day < 20 * 60 + 30)) {
+            amps += 4 + (day % 5 < 3 ? 10 : 0) + simRandom() % 4;
+        }
+        // evening: lights, television, dishwasher
+        if (day >= 18 * 60 && day < 23 * 60) {
+            amps += 2 + (day >= 21 * 60 && day < 22 * 60 ? 8 : 0);
+        }
+        // water heater in the off-peak hours
+        if (day >= 23 * 60 || day < 60) {
+            amps += 10;
+        }
+
+        simulator_load_t load = { minute * 60, amps };
+        config.house.push_back(load);
+    }
+}
+
+void simulator::run(const simulator_config_t &config, simulator_result_t &result) {
+    memset(&result, 0, sizeof(result));
+    simConfig = &config;
+    simResult = &result;
+    simLast = 0;
+    simHouseIndex = 0;
+    simCar = 0;
+    simCharging = false;
+    simDac = 0;
+    memset(simPilots, 0, sizeof(simPilots));
+    simPilotHead = 0;
+
+    double hostStart = simHostNow();
+
+    // the board, with its options: the pins read low when set
+    hal_native::reset();
+    hal_native::setQuiet(!config.verbose);
+    hal_native::setPin(INPUTS_CHARGING_CAR_PINS[0], LOW);
+    hal_native::setPin(INPUTS_OPTION_GREATER_ISOUSC, config.greaterIsousc ? LOW : HIGH);
+    hal_native::setPin(INPUTS_OPTION_PI_CONTROLLER, config.controller ? LOW : HIGH);
+    hal_native::setPin(INPUTS_OPTION_MARGIN_ADD_1A, config.marginAdd1A ? LOW : HIGH);
+
+    simMeter.adps = false;
+    simStartFrame(0);
+    hal_native::onAdvance(simModel);
+
+    setup();
+
+    // the time of the day of the forecast baselines
+    char time[8];
+    snprintf(time, sizeof(time), "t%02u%02u", (unsigned int)(config.startTime / 3600 % 24), (unsigned int)(config.startTime / 60 % 60));
+    hal_native::feedSerial(time, strlen(time));
+
+    uint64_t end = (uint64_t)config.duration * 1000000;
+    deciamps_t command = chargers::getChargingCurrent();
+    uint8_t spins = 0;
+
+    while (hal_native::now() < end) {
+        loop();
+        result.events++;
+
+        if (chargers::getChargingCurrent() != command) {
+            command = chargers::getChargingCurrent();
+            result.commands++;
+        }
+
+        // next event: a line of the meter, a change of the house or of the car, a deadline of the scheduler
+        uint64_t now = hal_native::now();
+        uint64_t next = simNextLine();
+        if (simNextHouseChange() < next) {
+            next = simNextHouseChange();
+        }
+        uint64_t arrival = (uint64_t)config.arrival * 1000000;
+        uint64_t departure = (uint64_t)config.departure * 1000000;
+        if (arrival > now && arrival < next) {
+            next = arrival;
+        }
+        if (departure > now && departure < next) {
+            next = departure;
+        }
+
+        uint32_t idle = scheduler::idleTime();
+        if (idle == 0 && spins < SIMULATOR_MAX_SPINS) {
+            // run the ready tasks first
+            spins++;
+            continue;
+        }
+        spins = 0;
+        if (idle != 0xFFFFFFFF && now + (idle > 0 ? idle : 1) * 1000ULL < next) {
+            next = now + (idle > 0 ? idle : 1) * 1000ULL;
+        }
+
+        // the DAC ramps toward the command by a step every DAC_MCP4725_RAMP_PERIOD, and the car ramps too
+        deciamps_t current = chargers::get(0).getChargingCurrent();
+        bool ramping = current >= VIRIDIAN_MIN_RANGE_CURRENT && hal_native::dacValue() < viridian::dacValue(current);
+        if ((ramping || simCar != (simCharging ? simDelayedPilot(now) * config.ratio : 0)) && now + DAC_MCP4725_RAMP_PERIOD * 1000ULL < next) {
+            next = now + DAC_MCP4725_RAMP_PERIOD * 1000ULL;
+        }
+
+        if (next > end) {
+            next = end;
+        }
+        hal_native::advance(next > now ? next - now : 1);
+    }
+
+    hal_native::onAdvance(NULL);
+    result.hostTime = simHostNow() - hostStart;
+}
+
+void simulator::print(const simulator_config_t &config, const simulator_result_t &result) {
+    printf("simulated %.1f h in %.3f s (%u events, %.0fx real time)\n", config.duration / 3600.0, result.hostTime,
+        result.events, result.hostTime > 0 ? config.duration / result.hostTime : 0.0);
+    printf("energy delivered: %.2f kWh in %.1f h of charge\n", result.energy, result.chargeTime / 3600);
+    printf("unused headroom: %.1f Ah, %.2f A on average while charging\n", result.unusedHeadroom,
+        result.chargeTime > 0 ? result.unusedHeadroom * 3600 / result.chargeTime : 0.0);
+    printf("ADPS: %u frames, %u overruns, %.0f s above the subscription\n", result.adpsFrames, result.overruns, result.overrunTime);
+    printf("commands: %u\n", result.commands);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <vector>
+
+#include "viridian/viridian.h"
+
+// Discrete-event simulation of the house, the meter and the car around the firmware
+// setup() and loop() of main.cpp run on the native virtual board: the teleinfo parser reads the
+// bytes of the meter model, the DAC written by viridian is the pilot current of the car model
+// the virtual clock jumps from an event to the next one (a line of the meter, a deadline of the
+// scheduler, a step of the DAC ramp), so a day of charge runs in a fraction of a second
+//
+// the firmware state is global: run a single simulation per process
+
+// historic teleinfo: 1200 bauds, 10 bits per byte, and the gap between two frames
+static const uint32_t SIMULATOR_US_PER_BYTE = 8333;
+static const uint32_t SIMULATOR_FRAME_GAP_US = 20000;
+
+// the house load is a step function of the time since the start of the simulation
+typedef struct simulator_load_t simulator_load_t;
+struct simulator_load_t {
+    uint32_t second;
+    // current of the house, without the car
+    float amps;
+};
+
+typedef struct simulator_config_t simulator_config_t;
+struct simulator_config_t {
+    // duration of the simulation and time of the day at its start (s)
+    uint32_t duration;
+    uint32_t startTime;
+
+    // subscription of the meter (A), nominal voltage of the energy (V)
+    uint8_t isousc;
+    uint16_t voltage;
+
+    // options of the board
+    bool greaterIsousc;
+    bool controller;
+    bool marginAdd1A;
+
+    // the car is plugged and charges from arrival to departure (s), until it took its energy (kWh, 0 for no limit)
+    uint32_t arrival;
+    uint32_t departure;
+    float energy;
+    // the car follows the pilot current after a dead time (ms), at a ramp rate (A/s), up to its own maximum (A)
+    // and draws the pilot current times a ratio
+    uint32_t lag;
+    float rampRate;
+    float maxCurrent;
+    float ratio;
+
+    // house load, a synthetic day is generated when empty
+    std::vector<simulator_load_t> house;
+    uint32_t seed;
+
+    // trace of each frame as CSV, NULL for none
+    FILE* trace;
+    // logs of the firmware written to stdout, to be decoded with tools/log_decoder
+    bool verbose;
+};
+
+typedef struct simulator_result_t simulator_result_t;
+struct simulator_result_t {
+    // energy delivered to the car (kWh)
+    double energy;
+    // current the car could have taken from the subscription and did not, while charging (A.h)
+    double unusedHeadroom;
+    // duration of the charge (s)
+    double chargeTime;
+    // frames with ADPS, runs of them, and time above the subscription (s)
+    uint32_t adpsFrames;
+    uint32_t overruns;
+    double overrunTime;
+    // charging current commands of the firmware
+    uint32_t commands;
+    // events processed, and host time spent (s)
+    uint32_t events;
+    double hostTime;
+};
+
+class simulator {
+    public:
+        // defaults of the configuration: a 24h day from 18:00, a car arriving at 18:30
+        static void defaults(simulator_config_t &config);
+
+        // load the house profile from a CSV file: seconds since the start,amps
+        static bool loadHouse(const char* path, simulator_config_t &config);
+
+        // generate a synthetic day of the house load, from the time of the day at the start
+        static void syntheticHouse(simulator_config_t &config);
+
+        static void run(const simulator_config_t &config, simulator_result_t &result);
+
+        static void print(const simulator_config_t &config, const simulator_result_t &result);
+};
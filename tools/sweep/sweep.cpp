@@ -0,0 +1,413 @@
+#include <Arduino.h>
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "../simulator/simulator.h"
+
+// Sweep of the tuning constants of main.cpp over the simulator
+// each combination of the parameters is simulated on each house trace, the results are summed over the traces
+// and the Pareto front of the energy delivered against the ADPS frames and the commands is printed
+//
+// usage: sweep [-j workers] [-p name=a,b,c | -p name=min:max:step]... [-h house.csv]... [-S seeds]
+//              [-d hours] [-i amps] [-c] [-e kWh] [-o results.csv]
+//
+// the firmware state is global: each simulation runs in a process forked from a worker, which starts from
+// the state before setup(); the workers take the simulations from their own deque, and steal from the
+// others once it is empty, so the slow combinations do not leave cores idle at the end
+
+// tuning constants of main.cpp, variables on the host
+extern uint32_t MAIN_CHARGE_CYCLE;
+extern deciamps_t MAIN_INITIAL_MARGIN;
+extern uint8_t MAIN_PERCENTAGE_CHANGE_MINIMUM;
+extern uint8_t MAIN_GREATER_ISOUSC_PERCENTAGE;
+extern uint32_t MAIN_CURRENT_CHANGE_DURATION;
+extern uint32_t MAIN_INITIAL_CHARGE_DELAY;
+
+// period of the progress report on stderr (s)
+static const unsigned int SWEEP_PROGRESS_PERIOD = 2;
+
+typedef struct sweep_parameter_t sweep_parameter_t;
+struct sweep_parameter_t {
+    const char* name;
+    const char* description;
+    void (*apply)(const uint32_t value, simulator_config_t &config);
+    std::vector<uint32_t> values;
+};
+
+// deque of the simulations of a worker: a range of job indexes, the owner takes from the tail, the thieves from the head
+typedef struct sweep_deque_t sweep_deque_t;
+struct sweep_deque_t {
+    pthread_mutex_t lock;
+    uint32_t head;
+    uint32_t tail;
+};
+
+typedef struct sweep_job_t sweep_job_t;
+struct sweep_job_t {
+    simulator_result_t result;
+    bool done;
+};
+
+static void applyCycle(const uint32_t value, simulator_config_t &config) {
+    (void)config;
+    MAIN_CHARGE_CYCLE = value;
+}
+
+static void applyMargin(const uint32_t value, simulator_config_t &config) {
+    (void)config;
+    MAIN_INITIAL_MARGIN = value;
+}
+
+static void applyPercentage(const uint32_t value, simulator_config_t &config) {
+    (void)config;
+    MAIN_PERCENTAGE_CHANGE_MINIMUM = value;
+}
+
+static void applySettle(const uint32_t value, simulator_config_t &config) {
+    (void)config;
+    MAIN_CURRENT_CHANGE_DURATION = value;
+}
+
+static void applyDelay(const uint32_t value, simulator_config_t &config) {
+    (void)config;
+    MAIN_INITIAL_CHARGE_DELAY = value;
+}
+
+static void applyIsousc(const uint32_t value, simulator_config_t &config) {
+    // the multiplier is only used with the option
+    MAIN_GREATER_ISOUSC_PERCENTAGE = value;
+    config.greaterIsousc = value != 100;
+}
+
+// parameters and their default values
+static sweep_parameter_t sweepParameters[] = {
+    { "cycle", "MAIN_CHARGE_CYCLE (ms)", applyCycle, { 300000, 600000, 900000, 1200000, 1800000 } },
+    { "margin", "MAIN_INITIAL_MARGIN (dA)", applyMargin, { 5, 10, 15, 20 } },
+    { "percentage", "MAIN_PERCENTAGE_CHANGE_MINIMUM (%)", applyPercentage, { 5, 10, 15, 20 } },
+    { "settle", "MAIN_CURRENT_CHANGE_DURATION (ms)", applySettle, { 3000, 5000, 8000 } },
+    { "delay", "MAIN_INITIAL_CHARGE_DELAY (ms)", applyDelay, { 5000, 15000, 30000 } },
+    { "isousc", "MAIN_GREATER_ISOUSC_PERCENTAGE (%), 100 without the option", applyIsousc, { 100, 110, 120 } }
+};
+static const uint8_t SWEEP_PARAMETERS = sizeof(sweepParameters) / sizeof(sweepParameters[0]);
+
+static std::vector<simulator_config_t> sweepTraces;
+static uint32_t sweepCombinations;
+
+// shared between the workers
+static sweep_deque_t* sweepDeques;
+static sweep_job_t* sweepJobs;
+static uint32_t* sweepCompleted;
+
+static bool sweepParseParameter(const char* text) {
+    const char* equal = strchr(text, '=');
+    if (equal == NULL) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < SWEEP_PARAMETERS; i++) {
+        sweep_parameter_t &parameter = sweepParameters[i];
+        if (strlen(parameter.name) != (size_t)(equal - text) || strncmp(parameter.name, text, equal - text) != 0) {
+            continue;
+        }
+
+        unsigned long minimum, maximum, step;
+        parameter.values.clear();
+        if (sscanf(equal + 1, "%lu:%lu:%lu", &minimum, &maximum, &step) == 3 && step > 0) {
+            for (unsigned long value = minimum; value <= maximum; value += step) {
+                parameter.values.push_back(value);
+            }
+        } else {
+            for (const char* value = equal + 1; *value != '\0'; value = strchr(value, ',') != NULL ? strchr(value, ',') + 1 : "") {
+                parameter.values.push_back(strtoul(value, NULL, 10));
+            }
+        }
+        return !parameter.values.empty();
+    }
+
+    return false;
+}
+
+// value of each parameter for a combination, the first parameter changes the slowest
+static void sweepValues(uint32_t combination, uint32_t* values) {
+    for (int8_t i = SWEEP_PARAMETERS - 1; i >= 0; i--) {
+        values[i] = sweepParameters[i].values[combination % sweepParameters[i].values.size()];
+        combination /= sweepParameters[i].values.size();
+    }
+}
+
+// take a job from the deque of the worker, or steal one from the head of another deque
+static bool sweepTake(const uint32_t worker, const uint32_t workers, uint32_t &job) {
+    for (uint32_t i = 0; i < workers; i++) {
+        sweep_deque_t &deque = sweepDeques[(worker + i) % workers];
+        bool taken = false;
+
+        pthread_mutex_lock(&deque.lock);
+        if (deque.head < deque.tail) {
+            job = i == 0 ? --deque.tail : deque.head++;
+            taken = true;
+        }
+        pthread_mutex_unlock(&deque.lock);
+
+        if (taken) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// run in the forked process: a job is a combination on a trace
+static void sweepRun(const uint32_t job) {
+    simulator_config_t config = sweepTraces[job % sweepTraces.size()];
+    uint32_t values[SWEEP_PARAMETERS];
+
+    sweepValues(job / sweepTraces.size(), values);
+    for (uint8_t i = 0; i < SWEEP_PARAMETERS; i++) {
+        sweepParameters[i].apply(values[i], config);
+    }
+
+    simulator::run(config, sweepJobs[job].result);
+    sweepJobs[job].done = true;
+}
+
+static void sweepWorker(const uint32_t worker, const uint32_t workers) {
+    uint32_t job;
+
+    while (sweepTake(worker, workers, job)) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            sweepRun(job);
+            _exit(0);
+        }
+        if (pid > 0) {
+            waitpid(pid, NULL, 0);
+        }
+        __sync_fetch_and_add(sweepCompleted, 1);
+    }
+}
+
+// a dominates b: at least as much energy, as few ADPS frames and commands, and better on one of them
+static bool sweepDominates(const simulator_result_t &a, const simulator_result_t &b) {
+    return a.energy >= b.energy && a.adpsFrames <= b.adpsFrames && a.commands <= b.commands
+        && (a.energy > b.energy || a.adpsFrames < b.adpsFrames || a.commands < b.commands);
+}
+
+static void sweepPrintValues(FILE* output, const uint32_t combination, const char* separator) {
+    uint32_t values[SWEEP_PARAMETERS];
+
+    sweepValues(combination, values);
+    for (uint8_t i = 0; i < SWEEP_PARAMETERS; i++) {
+        fprintf(output, "%u%s", values[i], separator);
+    }
+}
+
+int main(int argc, char** argv) {
+    simulator_config_t base;
+    simulator::defaults(base);
+    // the car takes what it is given all along: the energy measures the policy
+    base.energy = 0;
+
+    std::vector<const char*> houses;
+    const char* seeds = "1";
+    const char* output = NULL;
+    long workers = sysconf(_SC_NPROCESSORS_ONLN);
+    int option;
+
+    while ((option = getopt(argc, argv, "j:p:h:S:d:i:ce:o:")) != -1) {
+        switch (option) {
+            case 'j':
+                workers = atol(optarg);
+                break;
+            case 'p':
+                if (!sweepParseParameter(optarg)) {
+                    fprintf(stderr, "invalid parameter %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'h':
+                houses.push_back(optarg);
+                break;
+            case 'S':
+                seeds = optarg;
+                break;
+            case 'd':
+                base.duration = atof(optarg) * 3600;
+                break;
+            case 'i':
+                base.isousc = atoi(optarg);
+                break;
+            case 'c':
+                base.controller = true;
+                break;
+            case 'e':
+                base.energy = atof(optarg);
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-j workers] [-p name=a,b,c | -p name=min:max:step]... [-h house.csv]... [-S seeds]\n"
+                    "    [-d hours] [-i amps] [-c] [-e kWh] [-o results.csv]\n", argv[0]);
+                for (uint8_t i = 0; i < SWEEP_PARAMETERS; i++) {
+                    fprintf(stderr, "  %s: %s\n", sweepParameters[i].name, sweepParameters[i].description);
+                }
+                return 1;
+        }
+    }
+    base.departure = base.duration;
+    if (workers < 1) {
+        workers = 1;
+    }
+
+    // the traces: the house files, or synthetic days
+    for (size_t i = 0; i < houses.size(); i++) {
+        simulator_config_t trace = base;
+        if (!simulator::loadHouse(houses[i], trace)) {
+            return 1;
+        }
+        sweepTraces.push_back(trace);
+    }
+    if (houses.empty()) {
+        for (const char* seed = seeds; *seed != '\0'; seed = strchr(seed, ',') != NULL ? strchr(seed, ',') + 1 : "") {
+            simulator_config_t trace = base;
+            trace.seed = strtoul(seed, NULL, 10);
+            simulator::syntheticHouse(trace);
+            sweepTraces.push_back(trace);
+        }
+    }
+
+    sweepCombinations = 1;
+    for (uint8_t i = 0; i < SWEEP_PARAMETERS; i++) {
+        sweepCombinations *= sweepParameters[i].values.size();
+    }
+    uint32_t jobs = sweepCombinations * sweepTraces.size();
+
+    // shared memory of the workers and of the simulations they fork
+    size_t size = workers * sizeof(sweep_deque_t) + jobs * sizeof(sweep_job_t) + sizeof(uint32_t);
+    uint8_t* shared = (uint8_t*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    sweepDeques = (sweep_deque_t*)shared;
+    sweepJobs = (sweep_job_t*)(shared + workers * sizeof(sweep_deque_t));
+    sweepCompleted = (uint32_t*)(shared + workers * sizeof(sweep_deque_t) + jobs * sizeof(sweep_job_t));
+
+    // each worker starts with a contiguous range of the jobs
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    for (long i = 0; i < workers; i++) {
+        pthread_mutex_init(&sweepDeques[i].lock, &attributes);
+        sweepDeques[i].head = (uint64_t)jobs * i / workers;
+        sweepDeques[i].tail = (uint64_t)jobs * (i + 1) / workers;
+    }
+
+    fprintf(stderr, "%u combinations on %u traces: %u simulations on %ld workers\n",
+        sweepCombinations, (unsigned int)sweepTraces.size(), jobs, workers);
+    fflush(stderr);
+
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (long i = 0; i < workers; i++) {
+        if (fork() == 0) {
+            sweepWorker(i, workers);
+            _exit(0);
+        }
+    }
+
+    // progress, until every worker is done
+    uint32_t running = workers;
+    while (running > 0) {
+        sleep(SWEEP_PROGRESS_PERIOD);
+        while (waitpid(-1, NULL, WNOHANG) > 0) {
+            running--;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        fprintf(stderr, "\r%u/%u simulations, %.0f s", __sync_fetch_and_add(sweepCompleted, 0), jobs,
+            now.tv_sec - start.tv_sec + (now.tv_nsec - start.tv_nsec) / 1e9);
+    }
+    fprintf(stderr, "\n");
+
+    // sum the traces of each combination
+    std::vector<simulator_result_t> results(sweepCombinations);
+    uint32_t failed = 0;
+    for (uint32_t combination = 0; combination < sweepCombinations; combination++) {
+        simulator_result_t &sum = results[combination];
+        memset(&sum, 0, sizeof(sum));
+
+        for (size_t trace = 0; trace < sweepTraces.size(); trace++) {
+            const sweep_job_t &job = sweepJobs[combination * sweepTraces.size() + trace];
+            if (!job.done) {
+                failed++;
+                continue;
+            }
+            sum.energy += job.result.energy;
+            sum.unusedHeadroom += job.result.unusedHeadroom;
+            sum.chargeTime += job.result.chargeTime;
+            sum.adpsFrames += job.result.adpsFrames;
+            sum.overruns += job.result.overruns;
+            sum.overrunTime += job.result.overrunTime;
+            sum.commands += job.result.commands;
+        }
+    }
+    if (failed > 0) {
+        fprintf(stderr, "%u simulations failed\n", failed);
+    }
+
+    if (output != NULL) {
+        FILE* file = fopen(output, "w");
+        if (file == NULL) {
+            fprintf(stderr, "cannot open %s\n", output);
+            return 1;
+        }
+        for (uint8_t i = 0; i < SWEEP_PARAMETERS; i++) {
+            fprintf(file, "%s,", sweepParameters[i].name);
+        }
+        fprintf(file, "energy,adps,overruns,overrun_time,commands,unused_headroom\n");
+        for (uint32_t combination = 0; combination < sweepCombinations; combination++) {
+            const simulator_result_t &result = results[combination];
+            sweepPrintValues(file, combination, ",");
+            fprintf(file, "%.3f,%u,%u,%.0f,%u,%.1f\n", result.energy, result.adpsFrames, result.overruns,
+                result.overrunTime, result.commands, result.unusedHeadroom);
+        }
+        fclose(file);
+    }
+
+    // Pareto front, by decreasing energy
+    std::vector<uint32_t> front;
+    for (uint32_t a = 0; a < sweepCombinations; a++) {
+        bool dominated = false;
+        for (uint32_t b = 0; b < sweepCombinations && !dominated; b++) {
+            dominated = sweepDominates(results[b], results[a]);
+        }
+        if (!dominated) {
+            size_t position = 0;
+            while (position < front.size() && results[front[position]].energy >= results[a].energy) {
+                position++;
+            }
+            front.insert(front.begin() + position, a);
+        }
+    }
+
+    printf("Pareto front, energy delivered against ADPS frames and commands (%u of %u combinations):\n",
+        (unsigned int)front.size(), sweepCombinations);
+    for (uint8_t i = 0; i < SWEEP_PARAMETERS; i++) {
+        printf("%s\t", sweepParameters[i].name);
+    }
+    printf("energy\tadps\tcommands\tunused\n");
+    for (size_t i = 0; i < front.size(); i++) {
+        const simulator_result_t &result = results[front[i]];
+        sweepPrintValues(stdout, front[i], "\t");
+        printf("%.2f\t%u\t%u\t%.1f\n", result.energy, result.adpsFrames, result.commands, result.unusedHeadroom);
+    }
+
+    return 0;
+}
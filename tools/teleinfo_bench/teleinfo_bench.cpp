@@ -0,0 +1,347 @@
+#include <Arduino.h>
+
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TELEINFO_BENCH_CYCLES() __rdtsc()
+#else
+#define TELEINFO_BENCH_CYCLES() 0
+#endif
+
+#include "hal/native/hal_native.h"
+#include "teleinfo/teleinfo.h"
+
+// Replay benchmark and fuzzer of the teleinfo parser
+// the captures are streamed through the in-memory byte source and teleinfo::process(),
+// which is the code running on the board, except for the interrupt driven receiver
+//
+// usage: teleinfo_bench [-f iterations] [-s seed] capture...
+//   without -f: benchmark each capture
+//   with -f: mutate the captures and check that the parser never hangs and always recovers
+
+// minimum number of bytes parsed per capture in the benchmark
+static const uint32_t BENCH_MIN_BYTES = 4000000;
+
+// maximum duration of a fuzz iteration (in s) before it is considered a hang
+static const unsigned int BENCH_FUZZ_TIMEOUT = 2;
+
+// maximum number of mutations applied to a fuzz input
+static const uint8_t BENCH_FUZZ_MAX_MUTATIONS = 8;
+
+// chars inserted by the fuzzer, the ones the parser state machine reacts to
+static const char BENCH_FUZZ_CHARS[] = { TELEINFO_STX, TELEINFO_ETX, TELEINFO_EOT, TELEINFO_LF, TELEINFO_CR, ' ', '\t', '0', '9', 'A', 0x7F };
+
+typedef struct bench_capture_t bench_capture_t;
+struct bench_capture_t {
+    const char* name;
+    char* data;
+    size_t length;
+    teleinfo_mode_t mode;
+    // first frame of the capture that was published, used to check the recovery after fuzzing
+    const char* reference;
+    size_t referenceLength;
+};
+
+typedef struct bench_result_t bench_result_t;
+struct bench_result_t {
+    uint64_t bytes;
+    uint32_t frames;
+    uint32_t published;
+    // runs of consecutive frames that were not published
+    uint32_t recoveries;
+    uint32_t recoveryFrames;
+    uint32_t maxRecoveryFrames;
+};
+
+static uint32_t randomState;
+
+// the fuzz input of the running iteration, saved if it hangs
+static const char* fuzzInput;
+static size_t fuzzLength;
+static uint32_t fuzzIteration;
+
+static uint32_t benchRandom() {
+    // xorshift32
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+static double benchNow() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static bool benchLoad(const char* name, bench_capture_t &capture) {
+    FILE* file = fopen(name, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "cannot open %s\n", name);
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    capture.name = name;
+    capture.data = (char*)malloc(length > 0 ? length : 1);
+    capture.length = fread(capture.data, 1, length, file);
+    fclose(file);
+
+    // only standard frames use tabs as separators
+    capture.mode = memchr(capture.data, TELEINFO_STANDARD_SEPARATOR, capture.length) != NULL ? TELEINFO_MODE_STANDARD : TELEINFO_MODE_HISTORIC;
+    capture.reference = NULL;
+    capture.referenceLength = 0;
+
+    return true;
+}
+
+// feed bytes to the parser, returns the number of published frames
+static uint32_t benchFeed(const char* data, size_t length) {
+    uint32_t published = 0;
+
+    while (length > 0) {
+        size_t chunk = length < HAL_NATIVE_METER_BUFFER_SIZE ? length : HAL_NATIVE_METER_BUFFER_SIZE;
+        hal_native::feedMeter(data, chunk);
+        while (hal_native::meterPending() > 0) {
+            published += teleinfo::process() ? 1 : 0;
+        }
+        data += chunk;
+        length -= chunk;
+    }
+
+    return published;
+}
+
+// replay a capture once, frame by frame
+static void benchReplay(bench_capture_t &capture, bench_result_t &result) {
+    const char* frame = capture.data;
+    const char* end = capture.data + capture.length;
+    uint32_t missed = 0;
+
+    while (frame < end) {
+        const char* etx = (const char*)memchr(frame, TELEINFO_ETX, end - frame);
+        size_t length = (etx != NULL ? etx + 1 : end) - frame;
+
+        uint32_t published = benchFeed(frame, length);
+        result.bytes += length;
+
+        if (etx != NULL) {
+            result.frames++;
+
+            if (published > 0) {
+                result.published++;
+
+                if (capture.reference == NULL) {
+                    capture.reference = frame;
+                    capture.referenceLength = length;
+                }
+
+                // end of a run of frames that were not published
+                if (missed > 0) {
+                    result.recoveries++;
+                    result.recoveryFrames += missed;
+                    if (missed > result.maxRecoveryFrames) {
+                        result.maxRecoveryFrames = missed;
+                    }
+                    missed = 0;
+                }
+            } else {
+                missed++;
+            }
+        }
+
+        frame += length;
+    }
+}
+
+static void benchmark(bench_capture_t &capture) {
+    bench_result_t result;
+    memset(&result, 0, sizeof(result));
+
+    teleinfo::initialize();
+    teleinfo::setMode(capture.mode);
+
+    double start = benchNow();
+    uint64_t startCycles = TELEINFO_BENCH_CYCLES();
+
+    do {
+        benchReplay(capture, result);
+    } while (result.bytes < BENCH_MIN_BYTES && capture.length > 0);
+
+    uint64_t cycles = TELEINFO_BENCH_CYCLES() - startCycles;
+    double duration = benchNow() - start;
+
+    printf("%s (%s mode)\n", capture.name, capture.mode == TELEINFO_MODE_HISTORIC ? "historic" : "standard");
+    printf("  %.1f Mbytes/s, %.0f frames/s, %.1f cycles/byte\n",
+        result.bytes / duration / 1e6, result.frames / duration, result.bytes > 0 ? (double)cycles / result.bytes : 0.0);
+    printf("  frames: %u, published: %u, dropped: %u\n", result.frames, result.published, result.frames - result.published);
+    printf("  error recovery: %u, mean latency %.2f frames, max %u frames\n",
+        result.recoveries, result.recoveries > 0 ? (double)result.recoveryFrames / result.recoveries : 0.0, result.maxRecoveryFrames);
+}
+
+static void fuzzSave(const char* reason) {
+    char name[64];
+    snprintf(name, sizeof(name), "fuzz_%u_%u.tic", randomState, fuzzIteration);
+
+    FILE* file = fopen(name, "wb");
+    if (file != NULL) {
+        fwrite(fuzzInput, 1, fuzzLength, file);
+        fclose(file);
+    }
+
+    fprintf(stderr, "iteration %u: %s, input saved to %s\n", fuzzIteration, reason, name);
+}
+
+static void fuzzTimeout(int signal) {
+    (void)signal;
+    fuzzSave("parser hang");
+    _exit(2);
+}
+
+static size_t fuzzMutate(const bench_capture_t &capture, char* input, size_t maxLength) {
+    // start from a random window of the capture
+    size_t start = benchRandom() % capture.length;
+    size_t length = 1 + benchRandom() % (maxLength / 2);
+    if (start + length > capture.length) {
+        length = capture.length - start;
+    }
+    memcpy(input, capture.data + start, length);
+
+    uint8_t mutations = 1 + benchRandom() % BENCH_FUZZ_MAX_MUTATIONS;
+    for (uint8_t i = 0; i < mutations && length > 0; i++) {
+        size_t position = benchRandom() % length;
+
+        switch (benchRandom() % 5) {
+            case 0:
+                // flip a bit
+                input[position] ^= 1 << (benchRandom() % 7);
+                break;
+            case 1:
+                // replace with a char the parser reacts to
+                input[position] = BENCH_FUZZ_CHARS[benchRandom() % sizeof(BENCH_FUZZ_CHARS)];
+                break;
+            case 2:
+                // delete a char
+                memmove(input + position, input + position + 1, length - position - 1);
+                length--;
+                break;
+            case 3:
+                // repeat a char, as a long value would
+                if (length < maxLength) {
+                    size_t repeat = 1 + benchRandom() % (maxLength - length);
+                    memmove(input + position + repeat, input + position, length - position);
+                    memset(input + position, input[position], repeat);
+                    length += repeat;
+                }
+                break;
+            default:
+                // truncate
+                length = position;
+                break;
+        }
+    }
+
+    return length;
+}
+
+static int fuzz(bench_capture_t* captures, int count, uint32_t iterations) {
+    const size_t maxLength = 2048;
+    char* input = (char*)malloc(maxLength);
+    int failures = 0;
+
+    signal(SIGALRM, fuzzTimeout);
+
+    // a first replay finds the reference frame of each capture
+    for (int i = 0; i < count; i++) {
+        bench_result_t result;
+        memset(&result, 0, sizeof(result));
+        teleinfo::initialize();
+        teleinfo::setMode(captures[i].mode);
+        benchReplay(captures[i], result);
+    }
+
+    for (fuzzIteration = 0; fuzzIteration < iterations; fuzzIteration++) {
+        bench_capture_t &capture = captures[benchRandom() % count];
+        if (capture.reference == NULL) {
+            continue;
+        }
+
+        fuzzInput = input;
+        fuzzLength = fuzzMutate(capture, input, maxLength);
+
+        teleinfo::setMode(capture.mode);
+        alarm(BENCH_FUZZ_TIMEOUT);
+        benchFeed(input, fuzzLength);
+
+        // the parser must be back in sync after at most one valid frame
+        benchFeed(capture.reference, capture.referenceLength);
+        uint32_t published = benchFeed(capture.reference, capture.referenceLength);
+        alarm(0);
+
+        if (published == 0) {
+            fuzzSave("no recovery after two valid frames");
+            failures++;
+        }
+    }
+
+    printf("fuzz: %u iterations, %d failures\n", iterations, failures);
+    free(input);
+    return failures > 0 ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    uint32_t fuzzIterations = 0;
+    int option;
+
+    randomState = 0x12345678;
+
+    while ((option = getopt(argc, argv, "f:s:")) != -1) {
+        switch (option) {
+            case 'f':
+                fuzzIterations = strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                randomState = strtoul(optarg, NULL, 10);
+                if (randomState == 0) {
+                    randomState = 1;
+                }
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-f iterations] [-s seed] capture...\n", argv[0]);
+                return 1;
+        }
+    }
+
+    int count = argc - optind;
+    if (count <= 0) {
+        fprintf(stderr, "usage: %s [-f iterations] [-s seed] capture...\n", argv[0]);
+        return 1;
+    }
+
+    bench_capture_t* captures = (bench_capture_t*)calloc(count, sizeof(bench_capture_t));
+    for (int i = 0; i < count; i++) {
+        if (!benchLoad(argv[optind + i], captures[i])) {
+            return 1;
+        }
+    }
+
+    // the parser logs are not part of the measure
+    hal_native::reset();
+    hal_native::setQuiet(true);
+
+    if (fuzzIterations > 0) {
+        return fuzz(captures, count, fuzzIterations);
+    }
+
+    for (int i = 0; i < count; i++) {
+        benchmark(captures[i]);
+    }
+
+    return 0;
+}
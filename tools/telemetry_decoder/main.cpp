@@ -0,0 +1,48 @@
+#include <Arduino.h>
+
+#include "telemetry_decoder.h"
+
+// Decoder of the telemetry stream, prints one line per log message or record
+//
+// usage: telemetry_decoder [file]
+//   without file, or with -: read the standard input (e.g. a serial port dumped with cat)
+
+int main(int argc, char** argv) {
+    FILE* input = stdin;
+
+    if (argc > 2) {
+        fprintf(stderr, "usage: %s [file]\n", argv[0]);
+        return 1;
+    }
+
+    if (argc == 2 && strcmp(argv[1], "-") != 0) {
+        input = fopen(argv[1], "rb");
+        if (input == NULL) {
+            fprintf(stderr, "cannot open %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+    telemetry_decoder decoder;
+    uint32_t errors = 0;
+    char text[256];
+    int c;
+
+    while ((c = fgetc(input)) != EOF) {
+        if (decoder.push(c)) {
+            if (decoder.format(text, sizeof(text))) {
+                puts(text);
+            } else {
+                printf("<unknown frame of type 0x%02x, %u bytes>\n", decoder.type(), (unsigned int)decoder.length());
+            }
+            fflush(stdout);
+        } else if (decoder.errors() != errors) {
+            // the stream was joined in the middle of a frame, or a frame was corrupted
+            errors = decoder.errors();
+            printf("<invalid frame>\n");
+        }
+    }
+
+    fprintf(stderr, "%u frames, %u invalid\n", decoder.frames(), decoder.errors());
+    return 0;
+}
@@ -0,0 +1,215 @@
+#include <Arduino.h>
+
+#include "telemetry_decoder.h"
+
+typedef struct decoder_message_t decoder_message_t;
+struct decoder_message_t {
+    const char* name;
+    const char* text;
+};
+
+#define DECODER_MESSAGE(id, text) { #id, text },
+static const decoder_message_t DECODER_MESSAGES[LOGGER_MESSAGE_COUNT] = {
+    LOGGER_MESSAGES(DECODER_MESSAGE)
+};
+#undef DECODER_MESSAGE
+
+// append to a text, keeping track of the remaining size
+#define DECODER_APPEND(...) do { \
+        int written = snprintf(text + position, size - position, __VA_ARGS__); \
+        if (written < 0 || (size_t)written >= size - position) { \
+            return false; \
+        } \
+        position += written; \
+    } while (0)
+
+telemetry_decoder::telemetry_decoder() :
+    encodedLength(0), overflow(false), decodedLength(0), frameCount(0), errorCount(0) {
+}
+
+bool telemetry_decoder::push(const uint8_t value) {
+    if (value != LOGGER_FRAME_DELIMITER) {
+        if (this->encodedLength < TELEMETRY_DECODER_MAX_SIZE) {
+            this->encoded[this->encodedLength++] = value;
+        } else {
+            this->overflow = true;
+        }
+        return false;
+    }
+
+    // an empty frame is only a delimiter, e.g. at the start of the stream
+    if (this->encodedLength == 0 && !this->overflow) {
+        return false;
+    }
+
+    bool valid = !this->overflow && this->decode();
+    this->encodedLength = 0;
+    this->overflow = false;
+
+    if (valid) {
+        this->frameCount++;
+    } else {
+        this->errorCount++;
+    }
+    return valid;
+}
+
+bool telemetry_decoder::decode() {
+    size_t length = 0;
+    size_t position = 0;
+
+    // COBS: each code is the distance to the next 0, which is not sent for the last one
+    while (position < this->encodedLength) {
+        uint8_t code = this->encoded[position++];
+        if (code == 0 || position + code - 1 > this->encodedLength) {
+            return false;
+        }
+
+        memcpy(&this->decoded[length], &this->encoded[position], code - 1);
+        length += code - 1;
+        position += code - 1;
+
+        if (code < 0xFF && position < this->encodedLength) {
+            this->decoded[length++] = 0;
+        }
+    }
+
+    // at least the type and the CRC
+    if (length < 3) {
+        return false;
+    }
+
+    uint16_t crc = LOGGER_CRC_INIT;
+    for (size_t i = 0; i < length - 2; i++) {
+        crc = logger::crc16(crc, this->decoded[i]);
+    }
+    if (crc != (this->decoded[length - 2] | (this->decoded[length - 1] << 8))) {
+        return false;
+    }
+
+    this->decodedLength = length - 2;
+    return true;
+}
+
+uint8_t telemetry_decoder::type() const {
+    return this->decoded[0];
+}
+
+const uint8_t* telemetry_decoder::data() const {
+    return &this->decoded[1];
+}
+
+size_t telemetry_decoder::length() const {
+    return this->decodedLength - 1;
+}
+
+bool telemetry_decoder::isMessage() const {
+    return this->type() < LOGGER_MESSAGE_COUNT;
+}
+
+uint32_t telemetry_decoder::frames() const {
+    return this->frameCount;
+}
+
+uint32_t telemetry_decoder::errors() const {
+    return this->errorCount;
+}
+
+bool telemetry_decoder::format(char* text, const size_t size) const {
+    size_t position = 0;
+    telemetry_frame_t frame;
+    telemetry_decision_t decision;
+    telemetry_dac_t dac;
+
+    if (this->isMessage()) {
+        return this->formatMessage(text, size);
+    }
+
+    if (this->record(TELEMETRY_RECORD_FRAME, frame)) {
+        DECODER_APPEND("%u frame: ISOUSC %u A, IINST %u/%u/%u A, PAPP %u VA, overcurrent 0x%x, %u phase(s)",
+            frame.time, frame.subscribed, frame.current[0], frame.current[1], frame.current[2],
+            frame.power, frame.overcurrent, frame.phases);
+        return true;
+    }
+
+    if (this->record(TELEMETRY_RECORD_DECISION, decision)) {
+        DECODER_APPEND("%u decision: state %u, policy %u, headroom %d dA, %d dA -> %d dA",
+            decision.time, decision.state, decision.policy, decision.headroom, decision.previous, decision.command);
+        return true;
+    }
+
+    if (this->record(TELEMETRY_RECORD_DAC, dac)) {
+        DECODER_APPEND("%u dac 0x%x: value %u, target %u, status 0x%x after %u attempt(s)", dac.time, dac.address, dac.value, dac.target, dac.status, dac.attempts);
+        return true;
+    }
+
+    return false;
+}
+
+bool telemetry_decoder::formatMessage(char* text, const size_t size) const {
+    size_t position = 0;
+    const uint8_t* data = this->data();
+    const uint8_t* end = data + this->length();
+    const char* message = DECODER_MESSAGES[this->type()].text;
+
+    while (*message != '\0') {
+        if (message[0] != '{' || message[1] != '}') {
+            DECODER_APPEND("%c", *message);
+            message++;
+            continue;
+        }
+        message += 2;
+
+        // the arguments, as in tools/log_decoder
+        if (data >= end) {
+            return false;
+        }
+        uint8_t type = *data++;
+        uint8_t argumentSize = type & LOGGER_SIZE_MASK;
+
+        if ((type & LOGGER_TYPE_MASK) == LOGGER_TYPE_STRING) {
+            if (data >= end || *data > end - data - 1) {
+                return false;
+            }
+            uint8_t length = *data++;
+            DECODER_APPEND("%.*s", length, (const char*)data);
+            data += length;
+            continue;
+        }
+
+        if ((argumentSize != 1 && argumentSize != 2 && argumentSize != 4) || argumentSize > end - data) {
+            return false;
+        }
+
+        // little endian
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < argumentSize; i++) {
+            value |= (uint32_t)*data++ << (8 * i);
+        }
+
+        switch (type & LOGGER_TYPE_MASK) {
+            case LOGGER_TYPE_UNSIGNED:
+                DECODER_APPEND("%u", value);
+                break;
+            case LOGGER_TYPE_SIGNED: {
+                // sign extension from the size of the value
+                uint8_t shift = 32 - 8 * argumentSize;
+                DECODER_APPEND("%d", (int32_t)(value << shift) >> shift);
+                break;
+            }
+            case LOGGER_TYPE_FLOAT: {
+                float single;
+                memcpy(&single, &value, sizeof(single));
+                DECODER_APPEND("%.2f", single);
+                break;
+            }
+            case LOGGER_TYPE_CHAR:
+                DECODER_APPEND("%c", (char)value);
+                break;
+            default:
+                return false;
+        }
+    }
+
+    return true;
+}
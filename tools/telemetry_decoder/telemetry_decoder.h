@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "logger/logger.h"
+#include "telemetry/telemetry.h"
+
+// Host decoder of the telemetry stream (firmware built with -D LOGGER_TELEMETRY=1)
+// the bytes are pushed as they are received, each valid frame is then available
+// as a log message, which can be formatted as text, or as a fixed layout record
+//
+//     telemetry_decoder decoder;
+//     telemetry_frame_t frame;
+//     while ((c = fgetc(input)) != EOF) {
+//         if (decoder.push(c) && decoder.record(TELEMETRY_RECORD_FRAME, frame)) {
+//             ...
+//         }
+//     }
+
+// maximum size of an encoded frame, larger ones are counted as errors
+static const size_t TELEMETRY_DECODER_MAX_SIZE = 256;
+
+class telemetry_decoder {
+    public:
+        telemetry_decoder();
+
+        // push a received byte, returns true when it ends a valid frame
+        bool push(const uint8_t value);
+
+        // the last valid frame: a log message id or a telemetry_record_t, then its data
+        uint8_t type() const;
+        const uint8_t* data() const;
+        size_t length() const;
+        bool isMessage() const;
+
+        // copy the data of the last frame into the record, if it is of the given type and layout
+        template <typename T>
+        bool record(const telemetry_record_t type, T &record) const {
+            if (this->type() != type || this->length() != sizeof(T)) {
+                return false;
+            }
+            memcpy(&record, this->data(), sizeof(T));
+            return true;
+        }
+
+        // format the last frame as a line of text, returns false if it could not be decoded
+        bool format(char* text, const size_t size) const;
+
+        // counters of the stream
+        uint32_t frames() const;
+        uint32_t errors() const;
+
+    private:
+        bool decode();
+        bool formatMessage(char* text, const size_t size) const;
+
+        uint8_t encoded[TELEMETRY_DECODER_MAX_SIZE];
+        size_t encodedLength;
+        bool overflow;
+
+        uint8_t decoded[TELEMETRY_DECODER_MAX_SIZE];
+        size_t decodedLength;
+
+        uint32_t frameCount;
+        uint32_t errorCount;
+};